@@ -0,0 +1,154 @@
+/*
+ * dmxFadeBenchmark.c
+ *
+ *      Host benchmark of the DMX fade engine. dmx.c is compiled in here with the hardware functions stubbed out,
+ *      so applyCurve and advanceFades run exactly as in the kernel, just on the build machine:
+ *
+ *          make && ./dmxFadeBenchmark
+ *
+ *      For each curve all 512 channels of a universe fade from 0 to 255 and advanceFades is timed over many
+ *      frames. The values are checked against the same curve in floating point, and the fade must not move
+ *      backwards. The times are only comparable between runs on the same machine, the Cortex-A8 is a lot
+ *      slower, so the frame budget at DMX_MAX_REFRESH_RATE is printed next to them.
+ */
+#include <stdio.h>
+#include <sys/time.h>
+
+// Intrinsics of the TI compiler
+unsigned int _disable_interrupts(void);
+void _restore_interrupts(unsigned int previousState);
+
+#include "kernel/hal/dmx/dmx.c"
+
+#define BENCHMARK_FADE_MS 10000
+#define BENCHMARK_REPETITIONS 200
+
+// Largest allowed difference to the curve computed in floating point
+#define BENCHMARK_MAX_ERROR 1
+
+static uint64_t g_nowMs;
+
+// Stubs of the hardware the DMX driver uses
+
+unsigned int _disable_interrupts(void) { return 0; }
+void _restore_interrupts(unsigned int previousState) { (void) previousState; }
+void set32(uint32_t address, uint32_t value) { (void) address; (void) value; }
+uint32_t get32(uint32_t address) { (void) address; return 0; }
+void or32(uint32_t address, uint32_t value) { (void) address; (void) value; }
+void and32(uint32_t address, uint32_t value) { (void) address; (void) value; }
+uint64_t systemTimer_getMilliseconds(void) { return g_nowMs; }
+bool uart_claim(UartModule_t module, UartOwner_t owner) { (void) module; (void) owner; return true; }
+void uart_initModule(UartModule_t module, UartConfig_t config) { (void) module; (void) config; }
+bool uart_isTransmitDone(UartModule_t module) { (void) module; return true; }
+void uart_enableBreak(UartModule_t module) { (void) module; }
+void uart_disableBreak(UartModule_t module) { (void) module; }
+void uart_transmit(UartModule_t module, const uint8_t * buffer, uint32_t size) { (void) module; (void) buffer; (void) size; }
+Timer_t * timer_create(TimerMode_t mode, ReloadType_t reloadType, uint32_t interval_us, TickCallback_t callback)
+{
+    (void) mode; (void) reloadType; (void) interval_us; (void) callback;
+    return NULL;
+}
+void timer_setTimerLoadValue(TimerNumber_t timer, uint32_t value) { (void) timer; (void) value; }
+void timer_start(Timer_t * timer) { (void) timer; }
+void timer_clearInterruptFlag(Timer_t * timer) { (void) timer; }
+
+static double expectedCurve(uint8_t curve, double progress)
+{
+    switch (curve)
+    {
+    case DMX_CURVE_EASE_IN:
+        return progress * progress;
+    case DMX_CURVE_EASE_OUT:
+        return 1 - (1 - progress) * (1 - progress);
+    case DMX_CURVE_EASE_IN_OUT:
+        return progress * progress * (3 - 2 * progress);
+    default:
+        return progress;
+    }
+}
+
+static double nowNanoseconds(void)
+{
+    struct timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec * 1e9 + time.tv_usec * 1e3;
+}
+
+/*
+ * Fades all channels of universe 0 along curve, returns 0 if the values follow the curve.
+ */
+static int benchmarkCurve(uint8_t curve)
+{
+    static const char * names[] = { "linear", "ease in", "ease out", "ease in out" };
+    DmxUniverse_t * universe = &g_universes[0];
+    uint8_t targets[DMX_UNIVERSE_SIZE - 1];
+    memset(targets, 255, sizeof(targets));
+
+    double nanoseconds = 0;
+    unsigned int frames = 0;
+    int maxError = 0;
+    unsigned int repetition;
+    for (repetition = 0; repetition < BENCHMARK_REPETITIONS; repetition++)
+    {
+        // Every channel starts at 0
+        memset(universe->buffers, 0, sizeof(universe->buffers));
+        memset(universe->fades, 0, sizeof(universe->fades));
+        universe->dirtyRangeCount = 0;
+        universe->isSwapPending = FALSE;
+        g_nowMs = 0;
+        if (dmx_fade(0, 1, targets, sizeof(targets), BENCHMARK_FADE_MS, curve) != 0)
+        {
+            printf("dmx_fade failed\n");
+            return 1;
+        }
+
+        uint8_t previousValue = 0;
+        uint32_t frameMs = 1000 / DMX_MAX_REFRESH_RATE;
+        for (g_nowMs = frameMs; universe->fadeStart < universe->fadeEnd; g_nowMs += frameMs)
+        {
+            double start = nowNanoseconds();
+            advanceFades(universe, (uint32_t) g_nowMs);
+            nanoseconds += nowNanoseconds() - start;
+            frames++;
+
+            // The swap of startFrame, the back buffer now holds the frame
+            universe->frontBuffer = 1 - universe->frontBuffer;
+            universe->isSwapPending = FALSE;
+            const uint8_t * frame = universe->buffers[universe->frontBuffer];
+
+            double progress = g_nowMs >= BENCHMARK_FADE_MS ? 1 : (double) g_nowMs / BENCHMARK_FADE_MS;
+            int error = frame[1] - (int) (255 * expectedCurve(curve, progress));
+            error = error < 0 ? -error : error;
+            maxError = error > maxError ? error : maxError;
+            if (frame[1] < previousValue || frame[DMX_UNIVERSE_SIZE - 1] != frame[1])
+            {
+                printf("%s: wrong value %u after %u ms\n", names[curve], frame[1], (unsigned int) g_nowMs);
+                return 1;
+            }
+            previousValue = frame[1];
+        }
+        if (previousValue != 255)
+        {
+            printf("%s: ended at %u\n", names[curve], previousValue);
+            return 1;
+        }
+    }
+
+    printf("%-12s %8.0f ns per frame of %u fading channels, max error %d\n", names[curve], nanoseconds / frames,
+           DMX_UNIVERSE_SIZE - 1, maxError);
+    return maxError > BENCHMARK_MAX_ERROR;
+}
+
+int main(void)
+{
+    dmx_setRefreshRate(DMX_MAX_REFRESH_RATE);
+    printf("frame budget at %u frames per second: %u us\n", DMX_MAX_REFRESH_RATE, 1000000 / DMX_MAX_REFRESH_RATE);
+
+    int failures = 0;
+    uint8_t curve;
+    for (curve = DMX_CURVE_LINEAR; curve <= DMX_CURVE_EASE_IN_OUT; curve++)
+    {
+        failures += benchmarkCurve(curve);
+    }
+    return failures != 0;
+}
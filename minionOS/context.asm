@@ -30,3 +30,27 @@ asm_continuePreviousProcess
 	LDR R14, [SP] ; Load LR from stack
 	ADD SP, SP, #4
 	MOVS PC, R14 ; Return to user process
+
+	.global asm_dataAbort
+	.global asm_prefetchAbort
+	.global isr_handleDataAbort
+	.global isr_handlePrefetchAbort
+	.global isr_terminateAfterAbort
+
+	; The aborted code is resumed at the aborted instruction itself, with all of its registers. R0-R12 are
+	; shared with the aborted mode (user or supervisor in a system call), SP and LR are the ones of abort mode.
+asm_dataAbort
+	STMFD	SP!, {R0-R12, LR}			; Save the registers of the aborted code
+	BL		isr_handleDataAbort			; R0 = 1 if the fault is resolved
+	CMP		R0, #0
+	LDMFD	SP!, {R0-R12, LR}			; Restore the registers, the flags stay
+	BEQ		isr_terminateAfterAbort
+	SUBS	PC, LR, #8					; Execute the aborted instruction again, restores CPSR from SPSR_abt
+
+asm_prefetchAbort
+	STMFD	SP!, {R0-R12, LR}
+	BL		isr_handlePrefetchAbort
+	CMP		R0, #0
+	LDMFD	SP!, {R0-R12, LR}
+	BEQ		isr_terminateAfterAbort
+	SUBS	PC, LR, #4					; Fetch the aborted instruction again
@@ -2,16 +2,16 @@
     .global isr_swi
     .global isr_irq
     .global isr_fiq
-    .global isr_pabt
-    .global isr_dabt
+    .global asm_prefetchAbort
+    .global asm_dataAbort
     .global isr_undef
 
     .sect ".intvecs"
    	B isr_reset ; reset interrupt
     B isr_undef ; undefined instruction interrupt
   	B isr_swi ; software interrupt
-    B isr_pabt ; abort (prefetch) interrupt
-    B isr_dabt ; abort (data) interrupt
+    B asm_prefetchAbort ; abort (prefetch) interrupt
+    B asm_dataAbort ; abort (data) interrupt
     .word 0 ; reserved
     .word 0 ; reserved
     B isr_irq ; IRQ interrupt
@@ -47,6 +47,10 @@
 #define CM_CLKSTCTRL_CORE   0x48
 #define CM_CLKSTST_CORE     0x4C
 
+/* WKUP_CM Registers p.471, Section 4.14.1.7, wakeup domain peripherals set */
+#define CM_ICLKEN_WKUP      0x10
+#define EN_32KSYNC          2           // interface clock of the 32 kHz sync counter
+
 /* PER_CM Registers p.498, Section 4.14.1.11, used for peripheral domain peripherals set*/
 #define CM_FCLKEN_PER       0x00
 #define CM_ICLKEN_PER       0x10
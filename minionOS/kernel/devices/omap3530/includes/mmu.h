@@ -26,6 +26,7 @@
 #define KERNEL_DOMAIN   0
 #define PT_DOMAIN       2
 #define PROCESS_DOMAIN  4
+#define MMAP_DOMAIN     6   /* client domain, so that the access permissions of mapped files are checked */
 #define MASK_ALL_DOM    0xffffffff
 #define MASK_NO_DOM     0x0
 
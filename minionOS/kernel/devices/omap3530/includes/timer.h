@@ -32,6 +32,10 @@
 #define GPTIMER10_BASE  (0x48086000)
 #define GPTIMER11_BASE  (0x48088000)
 
+/* 32 kHz synchronized counter, free running from power-on on the 32 kHz clock */
+#define SYNC_32K_COUNTER_CR (0x48320010)
+#define SYNC_32K_TICKS_PER_SECOND 32768
+
 #define GPTIMER_TIDR      (0x0000)
 #define GPTIMER_TIOCP_CFG (0x0010)
 #define GPTIMER_TISTAT    (0x0014)
@@ -25,7 +25,7 @@
 #define SYSC_OFF    (0x54)
 #define SYSS_OFF    (0x58)
 #define FCR_OFF     (0x8)
-#define TLR_OFF     (0x01)
+#define TLR_OFF     (0x1C)
 #define SCR_OFF     (0x40)
 #define TCR_OFF     (0x18)
 #define RHR_OFF     (0x0)
@@ -45,6 +45,14 @@
 #define FCR_DMA_MODE        (3)
 #define FCR_FIFO_ENABLE     (0)
 
+#define TLR_RX_FIFO_TRIG_DMA (4)
+#define TLR_TX_FIFO_TRIG_DMA (0)
+
+#define IER_RHR_IT          (0)
+#define IER_THR_IT          (1)
+#define IER_LINE_STS_IT     (2)
+
+#define SCR_RX_TRIG_GRANU1  (7)
 #define SCR_TX_TRIG_GRANU1  (6)
 #define SCR_DMA_MODE_2_1    (1)
 
@@ -62,6 +70,11 @@
 #define MDR1_MODE_SELECT_3  (2)
 
 #define LSR_TX_FIFO_E       (5)
+#define LSR_TX_SR_E         (6)
 #define LSR_RX_FIFO_E       (0)
+#define LSR_RX_OE           (1)
+
+// Interrupt types in IIR[5:1]
+#define IIR_IT_TYPE_THR     (0x1)
 
 #endif /* KERNEL_DEVICES_OMAP3530_INCLUDES_UART_H_ */
@@ -3,74 +3,522 @@
  *
  *  Created on: 22.05.2017
  *      Author: Jasmin, Mathias
+ *
+ *      A frame runs through the states break, mark after break and data. Each state arms the one-shot GP timer
+ *      for its duration, so the timing does not depend on the CPU. All started universes share the frames, so
+ *      their breaks start together and they stay in phase. At the end of the mark after break their data is
+ *      queued into the transmit rings of the UARTs one after the other and sent by the UART interrupts, the
+ *      timer then waits for the rest of the frame period. A universe whose UART is still sending the previous
+ *      frame skips the frame (an underrun), the others are not held up.
+ *
+ *      Patches go to the back buffer. The slots they change are kept as a few dirty ranges, nearby ranges
+ *      merged into one. After a swap the back buffer differs from the front buffer in exactly these ranges,
+ *      so only they are copied over before the next patch, not the whole universe.
+ *
+ *      Fades are computed at the start of each frame, before the swap, and written to the back buffer like a
+ *      patch. The progress of a fade is taken from the milliseconds of the system timer since it was posted,
+ *      so frames skipped by an underrun or a lower rate do not lengthen it. It is a 16.16 fixed point fraction,
+ *      the elapsed time times a factor computed once when the fade is posted, so a frame costs no division,
+ *      only a few multiplications per fading slot.
  */
 #include "kernel/hal/dmx/dmx.h"
 #include "kernel/hal/uart/uart.h"
-#include "kernel/hal/timer/systemTimer.h"
 #include "kernel/hal/timer/timer.h"
-#include "kernel/hal/gpio/gpio.h"
-#include <kernel/devices/omap3530/includes/gpio.h>
-#include "delay/delay.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "kernel/common/mmio.h"
+#include <string.h>
+
+// Durations in ticks of the 32 kHz timer clock (30.5 us)
+#define DMX_BREAK_TICKS 6   // 183 us, at least 92 us
+#define DMX_MAB_TICKS 1     // 31 us, at least 12 us
+
+// A slot is a start bit, 8 data bits and 2 stop bits (STOP_1_5 with 8 data bits) of 4 us
+#define DMX_SLOT_MICROSECONDS 44
+// Shortest frame period, rounded up: the next break must not start before the last slot has left the UART
+#define DMX_MIN_FRAME_TICKS (DMX_BREAK_TICKS + DMX_MAB_TICKS \
+        + (DMX_UNIVERSE_SIZE * DMX_SLOT_MICROSECONDS * CLK_32KHZ + 999999) / 1000000)
+
+// Each 32-bit pad configuration register holds two pads, the mux mode are the lowest bits of a pad
+#define PAD_MUX_MODE_MASK 0x7
+#define PAD_MUX_MODE_UART 0x0
+
+#define DMX_MAX_DIRTY_RANGES 8
+// Ranges this close are merged, copying a few unchanged slots is cheaper than keeping another range
+#define DMX_DIRTY_RANGE_MERGE_GAP 8
+
+// Progress of a fade, 16.16 fixed point
+#define FADE_PROGRESS_ONE (1 << 16)
+
+#define ATOMIC_START()              (_disable_interrupts())
+#define ATOMIC_END(previousState)   (_restore_interrupts(previousState))
+
+typedef enum
+{
+    DMX_STATE_BREAK, DMX_STATE_MARK_AFTER_BREAK, DMX_STATE_DATA
+} DmxState_t;
+
+// Slots start...end - 1
+typedef struct
+{
+    uint16_t start;
+    uint16_t end;
+} DmxRange_t;
+
+// Fade of one slot, running while durationMs is not 0
+typedef struct
+{
+    uint32_t startMs;
+    uint32_t durationMs;
+    // Progress per millisecond, 0.32 fixed point
+    uint32_t progressPerMs;
+    uint8_t startValue;
+    uint8_t targetValue;
+    uint8_t curve;
+} DmxSlotFade_t;
+
+typedef struct
+{
+    uint32_t address;
+    uint8_t shift;
+} DmxPad_t;
+
+typedef struct
+{
+    UartModule_t uart;
+    DmxPad_t txPad;
+    DmxPad_t rtsPad;
+} DmxPort_t;
+
+typedef struct
+{
+    // The front buffer is sent, the back buffer is written. They swap at the start of a frame.
+    uint8_t buffers[2][DMX_UNIVERSE_SIZE];
+    uint8_t frontBuffer;
+    bool isSwapPending;
+
+    // Slots in which the back buffer differs from the front buffer
+    DmxRange_t dirtyRanges[DMX_MAX_DIRTY_RANGES];
+    uint8_t dirtyRangeCount;
+
+    // Fading slots lie within fadeStart...fadeEnd - 1
+    DmxSlotFade_t fades[DMX_UNIVERSE_SIZE];
+    uint16_t fadeStart;
+    uint16_t fadeEnd;
+
+    bool isStarted;
+    bool isInFrame;
+    uint32_t framesInSecond;
+    DmxStatistics_t statistics;
+} DmxUniverse_t;
+
+static const DmxPort_t ports[DMX_MAX_UNIVERSES] = {
+        { UART2, { 0x48002178, 0 }, { 0x48002174, 16 } },   // CONTROL_PADCONF_UART2_TX, _UART2_RTS
+        { UART1, { 0x4800217C, 0 }, { 0x4800217C, 16 } },   // CONTROL_PADCONF_UART1_TX, _UART1_RTS
+        { UART3, { 0x480021A0, 16 }, { 0x4800219C, 16 } }   // CONTROL_PADCONF_UART3_TX_IRTX, _UART3_RTS_SD
+};
 
 static UartConfig_t config = { .baudMultiple = x16, .baudRate = 250000,
                                .stopMode = STOP_1_5, .parityMode = NO_PARITY,
                                .wordLength = LENGTH_8 };
 
-typedef enum
+static DmxUniverse_t g_universes[DMX_MAX_UNIVERSES];
+
+static Timer_t * g_timer;
+static DmxState_t g_state;
+static uint32_t g_framePeriodTicks;
+static unsigned int g_framesPerSecond;
+
+// Ticks of the frames since the frames per second were last counted
+static uint32_t g_ticksInSecond;
+
+static void armTimer(uint32_t ticks)
 {
-    UART, GPIO
-} GpioMode_t;
+    // The timer counts up from the load value and raises the interrupt on the overflow
+    timer_setTimerLoadValue(g_timer->timerNr, 0 - ticks);
+    timer_start(g_timer);
+}
 
-typedef enum{
-    Mode0 = 0x00,
-    Mode1 = 0x01,
-    Mode2 = 0x02,
-    Mode3 = 0x03,
-    Mode4 = 0x04,
-    Mode5 = 0x05,
-    Mode6 = 0x06,
-    Mode7 = 0x07,
-}MuxMode_t;
+static void countFramesPerSecond(void)
+{
+    g_ticksInSecond += g_framePeriodTicks;
+    if (g_ticksInSecond < CLK_32KHZ)
+    {
+        return;
+    }
+    g_ticksInSecond = 0;
 
-static void pad_setMode(GpioMode_t mode)
+    uint8_t i;
+    for (i = 0; i < DMX_MAX_UNIVERSES; i++)
+    {
+        g_universes[i].statistics.framesPerSecond = g_universes[i].framesInSecond;
+        g_universes[i].framesInSecond = 0;
+    }
+}
+
+static void prepareBackBuffer(DmxUniverse_t * universe);
+static void addDirtyRange(DmxUniverse_t * universe, uint16_t start, uint16_t end);
+
+/*
+ * Applies the curve to progress, both 16.16 fixed point fractions.
+ */
+static uint32_t applyCurve(uint8_t curve, uint32_t progress)
+{
+    uint32_t inverse;
+    switch (curve)
+    {
+    case DMX_CURVE_EASE_IN:
+        return (progress * progress) >> 16;
+    case DMX_CURVE_EASE_OUT:
+        inverse = FADE_PROGRESS_ONE - progress;
+        return FADE_PROGRESS_ONE - ((inverse * inverse) >> 16);
+    case DMX_CURVE_EASE_IN_OUT:
+        // p^2 * (3 - 2p) with p^2 in 0.32 fixed point, one 64 bit multiplication. Rounding p^2 first would let
+        // the value drop while p^2 stays the same and 3 - 2p falls.
+        return ((uint64_t) (progress * progress) * (3 * FADE_PROGRESS_ONE - 2 * progress)) >> 32;
+    default:
+        return progress;
+    }
+}
+
+/*
+ * Writes the values of the fading slots for the next frame to the back buffer.
+ */
+static void advanceFades(DmxUniverse_t * universe, uint32_t nowMs)
+{
+    if (universe->fadeStart >= universe->fadeEnd)
+    {
+        return;
+    }
+
+    prepareBackBuffer(universe);
+    uint8_t * backBuffer = universe->buffers[1 - universe->frontBuffer];
+    uint16_t fadeStart = universe->fadeEnd;
+    uint16_t fadeEnd = universe->fadeStart;
+    uint16_t slot;
+    for (slot = universe->fadeStart; slot < universe->fadeEnd; slot++)
+    {
+        DmxSlotFade_t * fade = &universe->fades[slot];
+        if (fade->durationMs == 0)
+        {
+            continue;
+        }
+
+        uint32_t elapsedMs = nowMs - fade->startMs;
+        if (elapsedMs >= fade->durationMs)
+        {
+            backBuffer[slot] = fade->targetValue;
+            fade->durationMs = 0;
+            continue;
+        }
+        uint32_t progress = ((uint64_t) elapsedMs * fade->progressPerMs) >> 16;
+        int32_t distance = (int32_t) fade->targetValue - fade->startValue;
+        int32_t change = (distance * (int32_t) applyCurve(fade->curve, progress)) >> 16;
+        backBuffer[slot] = fade->startValue + change;
+
+        fadeStart = slot < fadeStart ? slot : fadeStart;
+        fadeEnd = slot + 1;
+    }
+
+    // One range for all slots which faded in this frame, they lie close to each other usually
+    addDirtyRange(universe, universe->fadeStart, slot);
+    universe->isSwapPending = TRUE;
+    universe->fadeStart = fadeStart;
+    universe->fadeEnd = fadeEnd;
+}
+
+static void startFrame(void)
+{
+    uint32_t nowMs = systemTimer_getMilliseconds();
+    uint8_t i;
+    for (i = 0; i < DMX_MAX_UNIVERSES; i++)
+    {
+        DmxUniverse_t * universe = &g_universes[i];
+        universe->isInFrame = universe->isStarted && uart_isTransmitDone(ports[i].uart);
+        if (!universe->isInFrame)
+        {
+            if (universe->isStarted)
+            {
+                universe->statistics.underruns++;
+            }
+            continue;
+        }
+
+        advanceFades(universe, nowMs);
+        if (universe->isSwapPending)
+        {
+            universe->frontBuffer = 1 - universe->frontBuffer;
+            universe->isSwapPending = FALSE;
+            universe->statistics.framesUpdated++;
+        }
+        uart_enableBreak(ports[i].uart);
+    }
+
+    countFramesPerSecond();
+    g_state = DMX_STATE_BREAK;
+    armTimer(DMX_BREAK_TICKS);
+}
+
+static void handleTimer(PCB_t * currentPcb)
 {
-    switch (mode)
+    timer_clearInterruptFlag(g_timer);
+
+    uint8_t i;
+    switch (g_state)
     {
-    case UART:
-        set32(CONTROL_PADCONF_UART2_TX, Mode0 << 0);
-        set32(CONTROL_PADCONF_UART2_CTS, Mode0 << 16);
+    case DMX_STATE_BREAK:
+        // The lines return to mark
+        for (i = 0; i < DMX_MAX_UNIVERSES; i++)
+        {
+            if (g_universes[i].isInFrame)
+            {
+                uart_disableBreak(ports[i].uart);
+            }
+        }
+        g_state = DMX_STATE_MARK_AFTER_BREAK;
+        armTimer(DMX_MAB_TICKS);
         break;
-    case GPIO:
-        set32(CONTROL_PADCONF_UART2_TX, Mode4 << 0);
-        set32(CONTROL_PADCONF_UART2_CTS, Mode4 << 16);
+    case DMX_STATE_MARK_AFTER_BREAK:
+        // The rings take the whole universes, the front buffers are free again right away
+        for (i = 0; i < DMX_MAX_UNIVERSES; i++)
+        {
+            DmxUniverse_t * universe = &g_universes[i];
+            if (universe->isInFrame)
+            {
+                uart_transmit(ports[i].uart, universe->buffers[universe->frontBuffer], DMX_UNIVERSE_SIZE);
+                universe->statistics.framesSent++;
+                universe->framesInSecond++;
+            }
+        }
+        g_state = DMX_STATE_DATA;
+        armTimer(g_framePeriodTicks - DMX_BREAK_TICKS - DMX_MAB_TICKS);
+        break;
+    case DMX_STATE_DATA:
+        startFrame();
         break;
     }
 }
 
+static void setPadToUart(DmxPad_t pad)
+{
+    and32(pad.address, ~(PAD_MUX_MODE_MASK << pad.shift));
+    or32(pad.address, PAD_MUX_MODE_UART << pad.shift);
+}
 
 void dmx_init()
 {
-    pad_setMode(UART);
-    uart_initModule(UART2, config);
-    uart_updateConfig(UART2, config);
-    gpio_pinMode(146, OUTPUT);
+    dmx_setRefreshRate(DMX_DEFAULT_REFRESH_RATE);
+    g_timer = timer_create(OVERFLOW, ONE_SHOT, 1000000 / DMX_DEFAULT_REFRESH_RATE, &handleTimer);
+    if (g_timer == NULL)
+    {
+        return;
+    }
+
+    dmx_start(0);
+    startFrame();
+}
+
+int dmx_start(uint8_t universe)
+{
+    if (universe >= DMX_MAX_UNIVERSES)
+    {
+        return -1;
+    }
+    if (g_universes[universe].isStarted)
+    {
+        return 0;
+    }
+
+    const DmxPort_t * port = &ports[universe];
+    if (!uart_claim(port->uart, UART_OWNER_DMX))
+    {
+        // Used by /dev/uartN, e.g. UART3 as the console
+        return -1;
+    }
+    setPadToUart(port->txPad);
+    setPadToUart(port->rtsPad);
+    uart_initModule(port->uart, config);
+
+    // Joins at the next frame start
+    int previousState = ATOMIC_START();
+    memset(&g_universes[universe].statistics, 0, sizeof(DmxStatistics_t));
+    g_universes[universe].isStarted = TRUE;
+    ATOMIC_END(previousState);
+    return 0;
 }
 
-void dmx_send(const uint8_t * data, uint16_t size)
+static void prepareBackBuffer(DmxUniverse_t * universe)
 {
-    // Reset
-    pad_setMode(GPIO);
-    gpio_digitalWrite(146, LOW);
-    delay(1000);
+    if (universe->isSwapPending)
+    {
+        return;
+    }
 
-    // Mark
-    gpio_digitalWrite(146, HIGH);
-    delay(500);
-    gpio_digitalWrite(146, LOW);
+    // The back buffer still lacks the changes swapped in at the start of the frame
+    uint8_t * frontBuffer = universe->buffers[universe->frontBuffer];
+    uint8_t * backBuffer = universe->buffers[1 - universe->frontBuffer];
+    uint8_t i;
+    for (i = 0; i < universe->dirtyRangeCount; i++)
+    {
+        DmxRange_t range = universe->dirtyRanges[i];
+        memcpy(backBuffer + range.start, frontBuffer + range.start, range.end - range.start);
+    }
+    universe->dirtyRangeCount = 0;
+}
 
-    // Send data
-    pad_setMode(UART);
-    uart_transmit(UART2, data, size);
+static void addDirtyRange(DmxUniverse_t * universe, uint16_t start, uint16_t end)
+{
+    // Ranges overlapping or near the new one are merged into it
+    uint8_t kept = 0;
+    uint8_t i;
+    for (i = 0; i < universe->dirtyRangeCount; i++)
+    {
+        DmxRange_t range = universe->dirtyRanges[i];
+        if (range.start <= end + DMX_DIRTY_RANGE_MERGE_GAP && start <= range.end + DMX_DIRTY_RANGE_MERGE_GAP)
+        {
+            start = range.start < start ? range.start : start;
+            end = range.end > end ? range.end : end;
+        }
+        else
+        {
+            universe->dirtyRanges[kept++] = range;
+        }
+    }
+    universe->dirtyRangeCount = kept;
+
+    if (universe->dirtyRangeCount == DMX_MAX_DIRTY_RANGES)
+    {
+        // Full, one range spanning all of them
+        for (i = 0; i < universe->dirtyRangeCount; i++)
+        {
+            start = universe->dirtyRanges[i].start < start ? universe->dirtyRanges[i].start : start;
+            end = universe->dirtyRanges[i].end > end ? universe->dirtyRanges[i].end : end;
+        }
+        universe->dirtyRangeCount = 0;
+    }
+
+    universe->dirtyRanges[universe->dirtyRangeCount].start = start;
+    universe->dirtyRanges[universe->dirtyRangeCount].end = end;
+    universe->dirtyRangeCount++;
+}
+
+int dmx_patch(uint8_t universeNumber, uint16_t startSlot, const uint8_t * data, uint16_t length)
+{
+    if (universeNumber >= DMX_MAX_UNIVERSES || startSlot >= DMX_UNIVERSE_SIZE
+            || length > DMX_UNIVERSE_SIZE - startSlot)
+    {
+        return -1;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    int previousState = ATOMIC_START();
+    DmxUniverse_t * universe = &g_universes[universeNumber];
+    prepareBackBuffer(universe);
+
+    // Patches of several processes before the next frame are merged into it
+    uint8_t * backBuffer = universe->buffers[1 - universe->frontBuffer];
+    memcpy(backBuffer + startSlot, data, length);
+    addDirtyRange(universe, startSlot, startSlot + length);
+    universe->isSwapPending = TRUE;
+
+    // The patched value holds, rather than being overwritten by a fade in the next frame
+    uint16_t slot;
+    for (slot = startSlot; slot < startSlot + length; slot++)
+    {
+        universe->fades[slot].durationMs = 0;
+    }
+    ATOMIC_END(previousState);
+    return 0;
+}
+
+int dmx_fade(uint8_t universeNumber, uint16_t startSlot, const uint8_t * targets, uint16_t length,
+             uint32_t durationMs, uint8_t curve)
+{
+    // A fade shorter than a frame at the current rate sets the targets in the next frame
+    if (durationMs * g_framesPerSecond / 1000 == 0)
+    {
+        return dmx_patch(universeNumber, startSlot, targets, length);
+    }
+    if (universeNumber >= DMX_MAX_UNIVERSES || startSlot >= DMX_UNIVERSE_SIZE
+            || length > DMX_UNIVERSE_SIZE - startSlot)
+    {
+        return -1;
+    }
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    // Rounded down, the progress stays below one until the target is set once durationMs have passed
+    uint32_t progressPerMs = 0xFFFFFFFFUL / durationMs;
+    uint32_t nowMs = systemTimer_getMilliseconds();
+
+    int previousState = ATOMIC_START();
+    DmxUniverse_t * universe = &g_universes[universeNumber];
+    prepareBackBuffer(universe);
+
+    // Fades start from the latest values, which may be the ones of a running fade
+    const uint8_t * currentValues = universe->buffers[1 - universe->frontBuffer];
+    uint16_t i;
+    for (i = 0; i < length; i++)
+    {
+        DmxSlotFade_t * fade = &universe->fades[startSlot + i];
+        fade->startValue = currentValues[startSlot + i];
+        fade->targetValue = targets[i];
+        fade->curve = curve;
+        fade->startMs = nowMs;
+        fade->durationMs = durationMs;
+        fade->progressPerMs = progressPerMs;
+    }
+
+    if (universe->fadeStart >= universe->fadeEnd)
+    {
+        universe->fadeStart = startSlot;
+        universe->fadeEnd = startSlot + length;
+    }
+    else
+    {
+        universe->fadeStart = startSlot < universe->fadeStart ? startSlot : universe->fadeStart;
+        universe->fadeEnd = startSlot + length > universe->fadeEnd ? startSlot + length : universe->fadeEnd;
+    }
+    ATOMIC_END(previousState);
+    return 0;
+}
+
+void dmx_write(uint8_t universe, const uint8_t * data, uint16_t size)
+{
+    dmx_patch(universe, 0, data, size > DMX_UNIVERSE_SIZE ? DMX_UNIVERSE_SIZE : size);
+}
+
+void dmx_setRefreshRate(unsigned int framesPerSecond)
+{
+    if (framesPerSecond < 1)
+    {
+        framesPerSecond = 1;
+    }
+    else if (framesPerSecond > DMX_MAX_REFRESH_RATE)
+    {
+        framesPerSecond = DMX_MAX_REFRESH_RATE;
+    }
+    g_framesPerSecond = framesPerSecond;
+    g_framePeriodTicks = CLK_32KHZ / framesPerSecond;
+    if (g_framePeriodTicks < DMX_MIN_FRAME_TICKS)
+    {
+        g_framePeriodTicks = DMX_MIN_FRAME_TICKS;
+    }
+}
+
+void dmx_getStatistics(uint8_t universe, DmxStatistics_t * statistics)
+{
+    if (universe >= DMX_MAX_UNIVERSES)
+    {
+        memset(statistics, 0, sizeof(DmxStatistics_t));
+        return;
+    }
 
-    delay(200);
+    int previousState = ATOMIC_START();
+    *statistics = g_universes[universe].statistics;
+    ATOMIC_END(previousState);
 }
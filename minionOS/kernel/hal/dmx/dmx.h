@@ -3,23 +3,71 @@
  *
  *  Created on: 22.05.2017
  *      Author: Jasmin, Mathias
+ *
+ *      DMX512 output of up to DMX_MAX_UNIVERSES universes, one per UART. The universes are sent again and again
+ *      in the background, timed by one GP timer for all of them: break, mark after break, then the start code
+ *      and 512 channels. dmx_write and dmx_patch only fill the back buffer of a universe, which becomes the sent
+ *      universe at the start of the next frame.
  */
 
 #ifndef KERNEL_HAL_DMX_DMX_H_
 #define KERNEL_HAL_DMX_DMX_H_
 #include "global/types.h"
+#include "dmxControl.h"
+#include <inttypes.h>
+
+// Start code and 512 channels
+#define DMX_UNIVERSE_SIZE 513
 
-// DMX pins
-#define DMX_DI_PIN 6    // DI Driver Input of ST485
-#define DMX_DE_PIN 8    // DE Driver Output Enable of ST485
-#define DMX_CHANNELS 25 // 1 StartCode, 11 Channels
+// A frame is the break, the mark after break and 513 slots of 11 bits (2 stop bits) at 250 kBaud, 747 ticks of
+// the 32 kHz clock or 22.8 ms, which allows 43 frames per second
+#define DMX_MAX_REFRESH_RATE 43
+#define DMX_DEFAULT_REFRESH_RATE 30
 
-// Pad configuration addresses
-#define PADCONF_BASE 0x48002030
-#define CONTROL_PADCONF_UART2_TX 0x48002178
-#define CONTROL_PADCONF_UART2_CTS 0x48002174
+// Universe 0 is sent on UART2, 1 on UART1 and 2 on UART3. A universe takes its UART only if no /dev/uartN uses
+// it, so universe 2 cannot be started while UART3 is the console.
+#define DMX_MAX_UNIVERSES 3
 
+/*
+ * Starts sending universe 0, which is all zero until the first write.
+ */
 void dmx_init();
-void dmx_send(const uint8_t * data, uint16_t size);
+
+/*
+ * Takes the UART of the universe, switches its pad to the UART, configures it for DMX and adds the universe to
+ * the frames from the next one on. Returns 0, also if the universe is started already, or -1 if there is no
+ * such universe or its UART is owned by another driver (uart_claim).
+ */
+int dmx_start(uint8_t universe);
+
+/*
+ * Copies size bytes (start code first) to the back buffer. Slots beyond size keep their values. The data is
+ * sent from the next frame on, a write before that replaces it.
+ */
+void dmx_write(uint8_t universe, const uint8_t * data, uint16_t size);
+
+/*
+ * Copies length bytes to the slots startSlot... of the back buffer (slot 0 is the start code, slot n channel n).
+ * The other slots keep their values, so processes controlling different fixtures do not overwrite each other.
+ * Returns 0, or -1 if the slots lie outside the universe.
+ */
+int dmx_patch(uint8_t universe, uint16_t startSlot, const uint8_t * data, uint16_t length);
+
+/*
+ * Moves length slots starting with startSlot from their current values to targets within durationMs along a
+ * curve (DmxCurve_t). The values are computed at the start of every frame from then on, from the time elapsed
+ * since the call, so the fade takes durationMs whichever frames are sent. Returns 0, or -1 if the slots lie
+ * outside the universe.
+ */
+int dmx_fade(uint8_t universe, uint16_t startSlot, const uint8_t * targets, uint16_t length,
+             uint32_t durationMs, uint8_t curve);
+
+/*
+ * Sets the frames per second of all universes, clamped to 1...DMX_MAX_REFRESH_RATE. Takes effect with the
+ * next frame.
+ */
+void dmx_setRefreshRate(unsigned int framesPerSecond);
+
+void dmx_getStatistics(uint8_t universe, DmxStatistics_t * statistics);
 
 #endif /* KERNEL_HAL_DMX_DMX_H_ */
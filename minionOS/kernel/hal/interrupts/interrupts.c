@@ -14,6 +14,7 @@
 #include "systemCallArguments.h"
 #include "kernel/systemModules/processManagement/contextSwitch.h"
 #include "kernel/systemModules/mmu/mmu.h"
+#include "kernel/systemModules/memoryMapping/memoryMapping.h"
 #include "kernel/systemModules/scheduler/scheduler.h"
 #include "global/types.h"
 #include <stdio.h>
@@ -100,38 +101,62 @@ void isr_fiq(void) {
 void isr_undef(void) {
 
 }
-#pragma INTERRUPT (isr_undef, DABT)
-void isr_dabt(void) {
+/*
+ * Called by asm_dataAbort with the registers of the aborted code saved on the abort stack, in user mode or in
+ * a system call. Returns 1 if the fault is resolved, then the aborted instruction is executed again, or 0 if
+ * the process has to be terminated.
+ */
+int isr_handleDataAbort(void) {
 
     uint8_t faultStatus = mmu_getDataFaultStatus();
     uint32_t faultAddress = mmu_getDataFaultAddress();
 
     if (faultAddress == NULLPOINTER)
     {
-        processManager_terminateCurrentProcess(&g_pcb);
+        return 0;
     }
     else if (faultStatus == TRANSLATION_FAULT_SECTION)
     {
         mmu_handleSectionTranslationFault(faultAddress);
+        return 1;
     }
-
-    asm_loadContext(&g_pcb);
+    else if (faultStatus == TRANSLATION_FAULT_PAGE)
+    {
+        // first access to a page of a memory mapped file
+        return memoryMapping_handleFault(faultAddress);
+    }
+    // e.g. a write to a memory mapped file, they are mapped read-only
+    return 0;
 }
 
-#pragma INTERRUPT (isr_undef, PABT)
-void isr_pabt(void) {
+/*
+ * Same as isr_handleDataAbort, called by asm_prefetchAbort.
+ */
+int isr_handlePrefetchAbort(void) {
 
     uint8_t faultStatus = mmu_getInstructionFaultStatus();
     uint32_t faultAddress = mmu_getInstructionFaultAddress();
 
     if (faultAddress == NULLPOINTER)
     {
-       processManager_terminateCurrentProcess(&g_pcb);
+        return 0;
     }
     else if (faultStatus == TRANSLATION_FAULT_SECTION)
     {
         mmu_handleSectionTranslationFault(faultAddress);
+        return 1;
+    }
+    else if (faultStatus == TRANSLATION_FAULT_PAGE)
+    {
+        return memoryMapping_handleFault(faultAddress);
     }
+    return 0;
+}
 
+/*
+ * Jumped to by the abort handlers with an empty abort stack if the fault cannot be resolved.
+ */
+void isr_terminateAfterAbort(void) {
+    processManager_terminateCurrentProcess(&g_pcb);
     asm_loadContext(&g_pcb);
 }
@@ -14,9 +14,27 @@
 
 #define SD_SECTOR_SIZE 512
 
+// OCR bits of ACMD41: voltage window 2.7-3.6 V, host/card capacity support (HCS/CCS) and power up done
+#define SD_OCR_VOLTAGE_WINDOW 0x00FF8000
+#define SD_OCR_HIGH_CAPACITY (1u<<30)
+#define SD_OCR_POWER_UP_DONE (1u<<31)
+
+// ACMD41 is repeated until the card has finished its power up (up to one second)
+#define SD_INITIALIZATION_ATTEMPTS 4000
+
 // Card address, after initialization. Initial value = 0
 static uint32_t gCardAddress = 0;
 
+// Set for SDHC/SDXC cards, which take block numbers instead of byte addresses as transfer argument
+static uint32_t gIsHighCapacity = 0;
+
+/*
+ * Transfer argument of the block with the given number.
+ */
+static uint32_t toCardAddress(uint32_t block){
+    return gIsHighCapacity ? block : block * SD_SECTOR_SIZE;
+}
+
 /*
  * Enable functional and internal clocks for MMC module 1.
  */
@@ -49,6 +67,33 @@ void softwareResetCMDLine(void){
     }
 }
 
+/*
+ * Recovers from an error during a data transfer: resets the CMD and DAT lines of the controller and sends a CMD12,
+ * so the card leaves its sending or receiving state and accepts the next command.
+ */
+static void abortTransfer(void){
+    or32(MMCHS1_SYSCTL, (1<<MMCHS_SYSCTL_SOFTWARE_RESET_CMD_LINE) | (1<<MMCHS_SYSCTL_SOFTWARE_RESET_DAT_LINE));
+    while((get32(MMCHS1_SYSCTL) & ((1<<MMCHS_SYSCTL_SOFTWARE_RESET_CMD_LINE) | (1<<MMCHS_SYSCTL_SOFTWARE_RESET_DAT_LINE))) != 0){
+
+    }
+    set32(MMCHS1_STAT, 0xFFFFFFFF);
+
+    sdCard_sendCommand(CMD12, 0);
+
+    // CMD12 has a busy response: wait until the card has released the DAT line (or the command failed)
+    while((get32(MMCHS1_STAT) & ((1<<MMCHS_STAT_TRANSFER_COMPLETE) | (1<<MMCHS_STAT_ERROR_INTERRUPT))) == 0){
+
+    }
+    if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+        // The card was not in a transfer state any more, the lines are reset again for the next command
+        or32(MMCHS1_SYSCTL, (1<<MMCHS_SYSCTL_SOFTWARE_RESET_CMD_LINE) | (1<<MMCHS_SYSCTL_SOFTWARE_RESET_DAT_LINE));
+        while((get32(MMCHS1_SYSCTL) & ((1<<MMCHS_SYSCTL_SOFTWARE_RESET_CMD_LINE) | (1<<MMCHS_SYSCTL_SOFTWARE_RESET_DAT_LINE))) != 0){
+
+        }
+    }
+    set32(MMCHS1_STAT, 0xFFFFFFFF);
+}
+
 /*
  * Perform default capabilities initialization for MMC module 1.
  */
@@ -139,6 +184,78 @@ static uint32_t checkSDIO(void){
     return 0;
 }
 
+/*
+ * Waits until the last command has completed or failed, and clears STAT. Returns 1 if it completed.
+ */
+static uint32_t waitForCommand(void){
+    while((get32(MMCHS1_STAT) & ((1<<MMCHS_STAT_COMMAND_COMPLETE) | (1<<MMCHS_STAT_ERROR_INTERRUPT))) == 0){
+
+    }
+    uint32_t isCompleted = (get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == 0;
+    set32(MMCHS1_STAT, 0xFFFFFFFF);
+    if(!isCompleted){
+        softwareResetCMDLine();
+    }
+    return isCompleted;
+}
+
+/*
+ * Brings a card which has finished its power up into the transfer state: reads its CID (CMD2), asks it to publish
+ * its relative address (CMD3), reads its CSD (CMD9) and selects it (CMD7).
+ */
+static void identifyCard(void){
+    // Send a CMD 2 command to get information on how to access card content (CID register content)
+    sdCard_sendCommand(CMD2, 0);
+
+    // Send a CMD 3 - ask the card to publish new relative card address (RCA)
+    sdCard_sendCommand(CMD3, 0x00000000);
+
+    // Get card address from register (48 bit response)
+    uint32_t adressedCard = get32(MMCHS1_RSP10) & 0xFFFF0000; // Upper 16 + stuff bits
+    gCardAddress = (adressedCard>>16);
+
+    // Read card CSD Register
+    sdCard_sendCommand(CMD9, adressedCard);
+
+    // Send a CMD 7 = Select card (after knowing its address). Sending 0 deselects all cards.
+    sdCard_sendCommand(CMD7, adressedCard);
+}
+
+/*
+ * Initializes a card which has answered CMD8 (SD v2): ACMD41 announces that the host supports high capacity cards
+ * and is repeated until the card has finished its power up. The CCS bit of the OCR then tells whether the card is
+ * addressed in blocks (SDHC/SDXC) or in bytes.
+ */
+static uint32_t initializeSDCardV2(void){
+    uint32_t attempt;
+    for(attempt = 0; attempt < SD_INITIALIZATION_ATTEMPTS; attempt++){
+        set32(MMCHS1_STAT, 0xFFFFFFFF);
+
+        // Send CMD55, so that an ACMD command can be sent
+        sdCard_sendCommand(CMD55, 0);
+        if(!waitForCommand()){
+            continue;
+        }
+
+        sdCard_sendCommand(ACMD41, SD_OCR_HIGH_CAPACITY | SD_OCR_VOLTAGE_WINDOW);
+        if(!waitForCommand()){
+            continue;
+        }
+
+        uint32_t ocr = get32(MMCHS1_RSP10);
+        if((ocr & SD_OCR_POWER_UP_DONE) == SD_OCR_POWER_UP_DONE){
+            gIsHighCapacity = (ocr & SD_OCR_HIGH_CAPACITY) == SD_OCR_HIGH_CAPACITY;
+            identifyCard();
+            return SDv2;
+        }
+
+        delayAfterCommand();
+    }
+
+    // The card did not finish its power up
+    return 0;
+}
+
 // Check if card is SD card v2
 static uint32_t checkSDCardV2(void){
     // CMD 8
@@ -156,8 +273,7 @@ static uint32_t checkSDCardV2(void){
         if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_COMMAND_COMPLETE)) == (1<<MMCHS_STAT_COMMAND_COMPLETE))
         {
             // SD Card > v2.
-            // TODO: Handle SD card v2
-            return SDv2;
+            return initializeSDCardV2();
         }
     } while ((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_COMMAND_TIMEOUT_INTERRUPT)) != (1<<MMCHS_STAT_COMMAND_TIMEOUT_INTERRUPT));
 
@@ -174,8 +290,8 @@ static uint32_t checkSDCardV1(void){
         // Send CMD55, so that an ACMD command can be sent
         sdCard_sendCommand(CMD55, 0);
 
-        // ACMD41, must be preceeded by a CMD55
-        sdCard_sendCommand(ACMD41, 0);
+        // ACMD41, must be preceeded by a CMD55. Byte addressed cards ignore HCS, so it is not set
+        sdCard_sendCommand(ACMD41, SD_OCR_VOLTAGE_WINDOW);
 
         // ACMD41 END
         delayAfterCommand();
@@ -188,22 +304,8 @@ static uint32_t checkSDCardV1(void){
                     // Line is busy
                     break;
                 } else {
-                    // Send a CMD 2 command to get information on how to access card content (CID register content)
-                    sdCard_sendCommand(CMD2, 0);
-
-                    // Send a CMD 3 - ask the card to publish new relative card address (RCA)
-                    sdCard_sendCommand(CMD3, 0x00000000);
-
-                    // Get card address from register (48 bit response)
-                    uint32_t adressedCard = get32(MMCHS1_RSP10) & 0xFFFF0000; // Upper 16 + stuff bits
-                    gCardAddress = (adressedCard>>16);
-
-                    // Read card CSD Register
-                    sdCard_sendCommand(CMD9, adressedCard);
-
-                    // Send a CMD 7 = Select card (after knowing its address). Sending 0 deselects all cards.
-                    sdCard_sendCommand(CMD7, adressedCard);
-
+                    gIsHighCapacity = 0;
+                    identifyCard();
                     return SDv1;
                 }
             }
@@ -308,10 +410,17 @@ int32_t sdCard_initialize_Ch1(void){
     return detectAndInitializeSdCard();
 }
 
+/*
+ * Returns whether the card is addressed in blocks (SDHC/SDXC). Valid after sdCard_initialize_Ch1.
+ */
+uint32_t sdCard_isHighCapacity(void){
+    return gIsHighCapacity;
+}
+
 /*
  * A block is fixed to 512 bytes. Buffer must be of size 512. Returns how many bytes have been read (0 for error).
  */
-uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t address){
+uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t block){
     // Check if dat lines are in use
     while((get32(MMCHS1_PSTATE) & (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)) == (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)){
         // DATA lines are in use
@@ -326,7 +435,7 @@ uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t address){
     // Reset STAT register (cancelling any errors)
     set32(MMCHS1_STAT, 0xFFFFFFFF);
 
-    sdCard_sendCommand(CMD17, address);
+    sdCard_sendCommand(CMD17, toCardAddress(block));
 
     // Check if there was an error sending the command. If yes, return
     if((get32(MMCHS1_STAT) & (1<<15)) == (1<<15)){
@@ -336,14 +445,22 @@ uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t address){
         // Check if the Buffer Write Ready bit is set
         volatile uint32_t i = 0;
         if((REG(MMCHS1_STAT) & (1<<5)) == (1<<5)){
-            for(i=0; i < SD_SECTOR_SIZE; i+=4){ // 512 bytes, 4 bytes are read
-                // Read data.
-                volatile uint32_t read_data = get32(MMCHS1_DATA);
-                buffer[i+3] = read_data >> 24;
-                buffer[i+2] = read_data >> 16;
-                buffer[i+1] = read_data >> 8;
-                buffer[i+0] = read_data;
-                //delayAfterCommand();
+            if(((uint32_t)buffer & 0x3) == 0){
+                // Word aligned destination: store the data words directly instead of splitting them into bytes
+                uint32_t * wordBuffer = (uint32_t *)buffer;
+                for(i=0; i < SD_SECTOR_SIZE/4; i++){
+                    wordBuffer[i] = get32(MMCHS1_DATA);
+                }
+            } else {
+                for(i=0; i < SD_SECTOR_SIZE; i+=4){ // 512 bytes, 4 bytes are read
+                    // Read data.
+                    volatile uint32_t read_data = get32(MMCHS1_DATA);
+                    buffer[i+3] = read_data >> 24;
+                    buffer[i+2] = read_data >> 16;
+                    buffer[i+1] = read_data >> 8;
+                    buffer[i+0] = read_data;
+                    //delayAfterCommand();
+                }
             }
         } else {
             // Error occured
@@ -356,6 +473,88 @@ uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t address){
     return SD_SECTOR_SIZE;
 }
 
+/*
+ * Reads count consecutive 512 byte blocks, starting at firstBlock, with one CMD18 (the controller terminates the
+ * transfer with an automatic CMD12). A single block is read with CMD17. Returns how many bytes have been read
+ * (the complete blocks before an error).
+ */
+uint32_t sdCard_read512ByteBlocks(uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(count == 0){
+        return 0;
+    }
+    if(count == 1){
+        return sdCard_read512ByteBlock(buffer, firstBlock);
+    }
+
+    // Check if dat lines are in use
+    while((get32(MMCHS1_PSTATE) & (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)) == (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)){
+        // DATA lines are in use
+    }
+
+    // CMD 7, select card
+    sdCard_sendCommand(CMD7, gCardAddress<<16);
+
+    // Send a CMD 16 setting block length
+    sdCard_sendCommand(CMD16, 0x00000200);
+
+    // Reset STAT register (cancelling any errors)
+    set32(MMCHS1_STAT, 0xFFFFFFFF);
+
+    // Number of blocks (31:16) and block size
+    set32(MMCHS1_BLK, (count<<16) | SD_SECTOR_SIZE);
+
+    sdCard_sendCommand(CMD18, toCardAddress(firstBlock));
+
+    // Check if there was an error sending the command. If yes, return
+    if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+        abortTransfer();
+        return 0;
+    }
+
+    volatile uint32_t block = 0;
+    volatile uint32_t i = 0;
+    for(block = 0; block < count; block++){
+        // Wait until the controller holds the next block
+        while((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_BUFFER_READ_READY)) != (1<<MMCHS_STAT_BUFFER_READ_READY)){
+            if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+                abortTransfer();
+                return block * SD_SECTOR_SIZE;
+            }
+        }
+
+        uint8_t * blockBuffer = buffer + block * SD_SECTOR_SIZE;
+        if(((uint32_t)blockBuffer & 0x3) == 0){
+            uint32_t * wordBuffer = (uint32_t *)blockBuffer;
+            for(i=0; i < SD_SECTOR_SIZE/4; i++){
+                wordBuffer[i] = get32(MMCHS1_DATA);
+            }
+        } else {
+            for(i=0; i < SD_SECTOR_SIZE; i+=4){
+                uint32_t readData = get32(MMCHS1_DATA);
+                blockBuffer[i+3] = readData >> 24;
+                blockBuffer[i+2] = readData >> 16;
+                blockBuffer[i+1] = readData >> 8;
+                blockBuffer[i+0] = readData;
+            }
+        }
+
+        // Reset buffer read ready
+        set32(MMCHS1_STAT, (1<<MMCHS_STAT_BUFFER_READ_READY));
+    }
+
+    // Wait until the automatic CMD12 has ended the transfer
+    while((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_TRANSFER_COMPLETE)) != (1<<MMCHS_STAT_TRANSFER_COMPLETE)){
+        if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+            abortTransfer();
+            break;
+        }
+    }
+    set32(MMCHS1_STAT, (1<<MMCHS_STAT_TRANSFER_COMPLETE));
+
+    // The data has arrived completely, an error of the stop command does not change it
+    return count * SD_SECTOR_SIZE;
+}
+
 /*
  * Set mmci_cmd to 1 for 80 clock cycles. This is impossible, because clock cannot be set that slow. Works anyway.
  * spruf98y.pdf Page 3182
@@ -377,6 +576,82 @@ void sdCard_setTransactionBlockCount(uint32_t blockNumber){
     or32(MMCHS1_BLK, last16MSBitsBlockNumber);
 }
 
+/*
+ * Writes count consecutive 512 byte blocks, starting at firstBlock. A single block is written with CMD24, multiple
+ * blocks with CMD25 (the controller terminates the transfer with an automatic CMD12). Returns how many bytes have
+ * been written (0 for error).
+ */
+uint32_t sdCard_write512ByteBlocks(const uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(count == 0){
+        return 0;
+    }
+
+    // Check if dat lines are in use
+    while((get32(MMCHS1_PSTATE) & (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)) == (1<<MMCHS_PSTATE_COMMAND_INHIBIT_DATA_LINE)){
+        // DATA lines are in use
+    }
+
+    // CMD 7, select card
+    sdCard_sendCommand(CMD7, gCardAddress<<16);
+
+    // Send a CMD 16 setting block length
+    sdCard_sendCommand(CMD16, 0x00000200);
+
+    // Reset STAT register (cancelling any errors)
+    set32(MMCHS1_STAT, 0xFFFFFFFF);
+
+    // Number of blocks (31:16) and block size
+    set32(MMCHS1_BLK, (count<<16) | SD_SECTOR_SIZE);
+
+    sdCard_sendCommand((count == 1) ? CMD24 : CMD25, toCardAddress(firstBlock));
+
+    // Check if there was an error sending the command. If yes, return
+    if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+        abortTransfer();
+        return 0;
+    }
+
+    volatile uint32_t block = 0;
+    volatile uint32_t i = 0;
+    for(block = 0; block < count; block++){
+        // Wait until the controller accepts the next block
+        while((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_BUFFER_WRITE_READY)) != (1<<MMCHS_STAT_BUFFER_WRITE_READY)){
+            if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+                // The card is still waiting for data: stop the transfer before returning
+                abortTransfer();
+                return block * SD_SECTOR_SIZE;
+            }
+        }
+
+        const uint8_t * blockBuffer = buffer + block * SD_SECTOR_SIZE;
+        if(((uint32_t)blockBuffer & 0x3) == 0){
+            const uint32_t * wordBuffer = (const uint32_t *)blockBuffer;
+            for(i=0; i < SD_SECTOR_SIZE/4; i++){
+                set32(MMCHS1_DATA, wordBuffer[i]);
+            }
+        } else {
+            for(i=0; i < SD_SECTOR_SIZE; i+=4){
+                set32(MMCHS1_DATA, ((uint32_t)blockBuffer[i+3] << 24) | ((uint32_t)blockBuffer[i+2] << 16)
+                                   | ((uint32_t)blockBuffer[i+1] << 8) | blockBuffer[i+0]);
+            }
+        }
+
+        // Reset buffer write ready
+        set32(MMCHS1_STAT, (1<<MMCHS_STAT_BUFFER_WRITE_READY));
+    }
+
+    // Wait until the card has finished programming
+    while((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_TRANSFER_COMPLETE)) != (1<<MMCHS_STAT_TRANSFER_COMPLETE)){
+        if((get32(MMCHS1_STAT) & (1<<MMCHS_STAT_ERROR_INTERRUPT)) == (1<<MMCHS_STAT_ERROR_INTERRUPT)){
+            abortTransfer();
+            return 0;
+        }
+    }
+    set32(MMCHS1_STAT, (1<<MMCHS_STAT_TRANSFER_COMPLETE));
+
+    return count * SD_SECTOR_SIZE;
+}
+
 /*
  * Sets the block size in bytes. Maximum size is 0x400 (1024 bytes).
  */
@@ -446,6 +721,13 @@ void sdCard_sendCommand(SDCardCommands_t command, uint32_t argument){
         set32(MMCHS1_ARG, argument); // Card address (upper 16 bits) + stuff bits
         set32(MMCHS1_CMD, 0x09090000);
         break;
+    case CMD12:
+        // Enable CERR, CIE, CCRC, CC, TC, CTO and CEB events
+        set32(MMCHS1_IE, 0x100f0003);
+        set32(MMCHS1_ARG, 0x00000000);
+        // Send CMD12: abort command, index and CRC check, 48 bit response with busy
+        set32(MMCHS1_CMD, 0x0cdb0000);
+        break;
     case CMD16:
         set32(MMCHS1_IE, 0x100f0001);
         set32(MMCHS1_ARG, 0x00000200);
@@ -453,7 +735,7 @@ void sdCard_sendCommand(SDCardCommands_t command, uint32_t argument){
         break;
     case CMD17:
         set32(MMCHS1_BLK, 0x00010200);
-        set32(MMCHS1_ARG, argument); // Set block to read (byte address!)
+        set32(MMCHS1_ARG, argument); // Set block to read (byte address, block number for high capacity cards)
 
         // Enable interrupts
         set32(MMCHS1_IE,
@@ -473,13 +755,69 @@ void sdCard_sendCommand(SDCardCommands_t command, uint32_t argument){
 
         set32(MMCHS1_CMD, (17<<24) | (1<<21) | (1<<20) | (1<<19) | (0x2<<16) | (0<<5) | (1<<4)| (0<<2)| (0<<1));
         break;
+    case CMD18:
+        // Block count and size are set by the caller
+        set32(MMCHS1_ARG, argument); // Set first block to read (byte address, block number for high capacity cards)
+
+        // Enable interrupts
+        set32(MMCHS1_IE,
+              (1<<MMCHS_IE_COMMAND_COMPLETED_IE) |
+              (1<<MMCHS_IE_TRANSFER_COMPLETED_IE) |
+              (1<<MMCHS_IE_BUFFER_READ_READY_IE) |
+              (1<<MMCHS_IE_COMMAND_TIMEOUT_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_CRC_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_END_BIT_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_INDEX_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_TIMEOUT_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_CRC_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_END_BIT_ERROR_IE) |
+              (1<<MMCHS_IE_AUTO_CMD12_ERROR_IE) |
+              (1<<MMCHS_IE_CARD_ERROR_IE) |
+              (1<<MMCHS_IE_BAD_ACCESS_TO_DATA_SPACE_IE));
+
+        // Multiple blocks, card to host, block count enabled, automatic CMD12 after the last block
+        set32(MMCHS1_CMD, (18<<24) | (1<<21) | (1<<20) | (1<<19) | (0x2<<16) | (1<<5) | (1<<4) | (1<<2) | (1<<1));
+        break;
+    case CMD24:
+    case CMD25:
+        // Block count and size are set by the caller
+        set32(MMCHS1_ARG, argument); // Set first block to write (byte address, block number for high capacity cards)
+
+        // Enable interrupts
+        set32(MMCHS1_IE,
+              (1<<MMCHS_IE_COMMAND_COMPLETED_IE) |
+              (1<<MMCHS_IE_TRANSFER_COMPLETED_IE) |
+              (1<<MMCHS_IE_BUFFER_WRITE_READY_IE) |
+              (1<<MMCHS_IE_COMMAND_TIMEOUT_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_CRC_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_END_BIT_ERROR_IE) |
+              (1<<MMCHS_IE_COMMAND_INDEX_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_TIMEOUT_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_CRC_ERROR_IE) |
+              (1<<MMCHS_IE_DATA_END_BIT_ERROR_IE) |
+              (1<<MMCHS_IE_AUTO_CMD12_ERROR_IE) |
+              (1<<MMCHS_IE_CARD_ERROR_IE) |
+              (1<<MMCHS_IE_BAD_ACCESS_TO_DATA_SPACE_IE));
+
+        if(command == CMD24){
+            // Single block, card to host direction bit cleared (write)
+            set32(MMCHS1_CMD, (24<<24) | (1<<21) | (1<<20) | (1<<19) | (0x2<<16) | (0<<5) | (0<<4) | (0<<2) | (0<<1));
+        } else {
+            // Multiple blocks, block count enabled, automatic CMD12 after the last block
+            set32(MMCHS1_CMD, (25<<24) | (1<<21) | (1<<20) | (1<<19) | (0x2<<16) | (1<<5) | (0<<4) | (1<<2) | (1<<1));
+        }
+        break;
     case ACMD41:
+        // Operating conditions (OCR bits) requested by the host
+        set32(MMCHS1_ARG, argument);
         // Enable CTO, CC, CEB
         set32(MMCHS1_IE, 0x00050001);
         // Set command plus response type
         set32(MMCHS1_CMD, (0x29<<24)|(0x02<<16));
         break;
     case CMD55:
+        // Card address (upper 16 bits), 0 during initialization
+        set32(MMCHS1_ARG, argument);
         // Enable events
         set32(MMCHS1_IE, 0x100f0001);
         // Send CMD55
@@ -31,9 +31,13 @@ typedef enum {
     CMD7,
     CMD8,
     CMD9,
+    CMD12,
     CMD16,
     CMD17,
+    CMD18,
     CMD23,
+    CMD24,
+    CMD25,
     ACMD41,
     CMD55
     // and so on, until CMD63. TODO: finish implementation
@@ -221,8 +225,14 @@ typedef enum {
 
 #define MMCHS_1024_BYTE_BLOCK_SIZE 0x400
 
+/*
+ * Initializes the module and detects the card. Returns its type (SDCardTypes_t). SD v1 and v2 cards (including
+ * SDHC and SDXC) are brought into the transfer state, other cards are only detected.
+ */
 int32_t sdCard_initialize_Ch1(void);
 
+uint32_t sdCard_isHighCapacity(void);
+
 void sdCard_sendInitializationSequence_Ch1(void);
 
 void sdCard_setTransactionBlockSize(uint32_t blockSize);
@@ -230,6 +240,11 @@ void sdCard_setTransactionBlockCount(uint32_t blockNumber);
 
 void sdCard_sendCommand(SDCardCommands_t command, uint32_t argument);
 
-uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t address);
+// Transfers are given block numbers, which are converted to byte addresses for cards addressed in bytes
+uint32_t sdCard_read512ByteBlock(uint8_t * buffer, uint32_t block);
+
+uint32_t sdCard_read512ByteBlocks(uint8_t * buffer, uint32_t firstBlock, uint32_t count);
+
+uint32_t sdCard_write512ByteBlocks(const uint8_t * buffer, uint32_t firstBlock, uint32_t count);
 
 #endif /* OMAP3530SDCARD_H_ */
@@ -27,6 +27,8 @@ static TimerCallbackSubscription_t g_registeredCallbacks[MAX_CALLBACKS] = { 0 };
 static Timer_t * g_systemTimer;
 
 uint32_t g_current_ms = 0;
+// Upper half of the 64-bit milliseconds, g_current_ms wraps after 49 days
+static uint32_t g_current_ms_high = 0;
 
 void systemTimer_init(uint32_t interval_us)
 {
@@ -72,9 +74,26 @@ void systemTimer_disableSubscription(SubscriptionId_t subscriptionId){
     g_registeredCallbacks[subscriptionId].enabled = FALSE;
 }
 
+uint64_t systemTimer_getMilliseconds(void)
+{
+    unsigned int previousState = _disable_interrupts();
+    uint64_t milliseconds = ((uint64_t) g_current_ms_high << 32) | g_current_ms;
+    _restore_interrupts(previousState);
+    return milliseconds;
+}
+
+void systemTimer_expediteSubscription(SubscriptionId_t subscriptionId){
+    // Due at the next tick, the interval starts again from there
+    g_registeredCallbacks[subscriptionId].lastCallbackTime = g_current_ms - g_registeredCallbacks[subscriptionId].interval_ms;
+}
+
 static void systemtimer_handler(PCB_t * currentPcb)
 {
     g_current_ms++;
+    if (g_current_ms == 0)
+    {
+        g_current_ms_high++;
+    }
     int i = 0;
     for (i = 0; i < MAX_CALLBACKS; i++)
     {
@@ -22,4 +22,8 @@ SubscriptionId_t systemTimer_subscribeCallback(uint32_t interval_ms,
 
 void systemTimer_enableSubscription(SubscriptionId_t subscriptionId);
 void systemTimer_disableSubscription(SubscriptionId_t subscriptionId);
+void systemTimer_expediteSubscription(SubscriptionId_t subscriptionId);
+
+// Milliseconds since the system timer was started
+uint64_t systemTimer_getMilliseconds(void);
 #endif /* KERNEL_HAL_TIMER_SYSTEMTIMER_H_ */
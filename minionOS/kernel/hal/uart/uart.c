@@ -3,6 +3,7 @@
 #include "kernel/devices/omap3530/includes/uart.h"
 #include <inttypes.h>
 #include <stdbool.h>
+#include <string.h>
 #include "delay/delay.h"
 #include "kernel/hal/interrupts/interrupts.h"
 #include "kernel/devices/omap3530/includes/interrupts.h"
@@ -57,6 +58,40 @@ typedef struct {
 static Uart_t modules[3] = { createUart(UART1_BASE), createUart(UART2_BASE),
         createUart(UART3_BASE) };
 
+static const uint8_t irqs[3] = { UART1_IRQ, UART2_IRQ, UART3_IRQ };
+
+#define ATOMIC_START()              (_disable_interrupts())
+#define ATOMIC_END(previousState)   (_restore_interrupts(previousState))
+
+#define TX_FIFO_SIZE        64
+// Free spaces in the transmit FIFO which raise the THR interrupt
+#define TX_TRIGGER_SPACES   32
+
+// Single producer (receive interrupt, moves tail) / single consumer (uart_receive, moves head), no locking needed
+typedef struct {
+    uint8_t data[UART_RX_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+} RxRing_t;
+
+// Single producer (uart_transmit, moves tail) / single consumer (interrupt or uart_flush, moves head)
+typedef struct {
+    uint8_t data[UART_TX_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+} TxRing_t;
+
+static RxRing_t rxRings[3];
+static TxRing_t txRings[3];
+static bool isRxInterruptEnabled[3];
+static UartReceiveCallback_t receiveCallbacks[3];
+static UartStatistics_t uartStatistics[3];
+static UartOwner_t owners[3];
+static uint32_t configCounts[3];
+// Set once uart_initModule has set up the FIFO and the interrupt. Until then, e.g. for the console left
+// configured by the boot loader, bytes are written to THR one by one (polled).
+static bool isInterruptDriven[3];
+
 static void setupProtocolBaudAndInterrupt(Uart_t uart, UartConfig_t config);
 
 static uint16_t calcDivisor(uint64_t baudRate, UartBaudMultiple_t baudMultiple) {
@@ -81,7 +116,7 @@ static void doSwReset(Uart_t uart) {
     while (!bitRead(*uart.SYSS, 0));
 }
 
-static void setupFifoAndDma(Uart_t uart) {
+static void setupFifoAndDma(Uart_t uart, uint8_t rxTriggerLevel) {
     // 17.5.1.1.2 FIFOs and DMA Settings
     // 1. Switch to register configuration mode B to access the UARTi.EFR_REG register
     uint8_t savedLcr = *uart.LCR;
@@ -95,20 +130,17 @@ static void setupFifoAndDma(Uart_t uart) {
     uint8_t savedTcrTlr = bitRead(*uart.MCR, MCR_TCR_TLR);
     bitSet(*uart.MCR, MCR_TCR_TLR);
     // 5. Enable FIFO, load the new FIFO triggers (part 1 of 3) and the new DMA mode (part 1 of 2)
-    bitClear(*uart.FCR, FCR_RX_FIFO_TRIG_1);
-    bitClear(*uart.FCR, FCR_RX_FIFO_TRIG_2);
-
-    bitClear(*uart.FCR, FCR_TX_FIFO_TRIG_1);
-    bitClear(*uart.FCR, FCR_TX_FIFO_TRIG_2);
-
-    bitClear(*uart.FCR, FCR_DMA_MODE);
-
-    bitSet(*uart.FCR, FCR_FIFO_ENABLE);
+    // With a granularity of 1 byte, the receive trigger level is TLR[7:4] : FCR[7:6] and the transmit trigger
+    // level (free spaces) TLR[3:0] : FCR[5:4]. FCR is write-only (reading the address returns IIR), so it is
+    // written as a whole. DMA mode is 0.
+    *uart.FCR = ((rxTriggerLevel & 0x3) << FCR_RX_FIFO_TRIG_1) | ((TX_TRIGGER_SPACES & 0x3) << FCR_TX_FIFO_TRIG_1)
+            | (1 << FCR_FIFO_ENABLE);
     // 6. Switch to register configuration mode B to access the UARTi.EFR_REG register
     *uart.LCR = 0x00BF;
     // 7. Load the new FIFO triggers (part 2 of 3)
-    *uart.TLR = 0x0000;
+    *uart.TLR = ((rxTriggerLevel >> 2) << TLR_RX_FIFO_TRIG_DMA) | ((TX_TRIGGER_SPACES >> 2) << TLR_TX_FIFO_TRIG_DMA);
     // 8. Load the new FIFO triggers (part 3 of 3) and the new DMA mode (part 2 of 2)
+    bitSet(*uart.SCR, SCR_RX_TRIG_GRANU1);
     bitSet(*uart.SCR, SCR_TX_TRIG_GRANU1);
     bitSet(*uart.SCR, SCR_DMA_MODE_2_1);
     // 9. Restore the UARTi.EFR_REG[4] ENHANCED_EN value saved in Step 2a
@@ -122,9 +154,13 @@ static void setupFifoAndDma(Uart_t uart) {
 }
 
 
+static void setupInterrupts(UartModule_t module, UartConfig_t config);
+
 void uart_updateConfig(UartModule_t module, UartConfig_t config){
     Uart_t uartModule = modules[module];
+    configCounts[module]++;
     setupProtocolBaudAndInterrupt(uartModule, config);
+    setupInterrupts(module, config);
 }
 
 static void setupProtocolBaudAndInterrupt(Uart_t uart, UartConfig_t config) {
@@ -158,7 +194,9 @@ static void setupProtocolBaudAndInterrupt(Uart_t uart, UartConfig_t config) {
     *uart.LCR = 0x0;
     delay(15);
     // 9. Load the new interrupt configuration
-    //bitSet(*uart.IER, 0); // RHR
+    if (config.rxTriggerLevel > 0) {
+        *uart.IER = (1 << IER_RHR_IT) | (1 << IER_LINE_STS_IT);
+    }
     // 10. Switch to register configuration mode B to access the UARTi.EFR_REG register
     *uart.LCR = 0x00BF;
     delay(15);
@@ -270,35 +308,152 @@ static void setupHwFlowControl(Uart_t uart) {
     *uart.LCR = savedLcr;
 }
 
-uint8_t data[150];
+/*
+ * Moves the received bytes from the FIFO into the receive ring.
+ */
+static void receiveBytes(UartModule_t module)
+{
+    Uart_t uartModule = modules[module];
+    RxRing_t* ring = &rxRings[module];
+    UartStatistics_t* moduleStatistics = &uartStatistics[module];
+
+    uint32_t bytesReceived = 0;
+    // Reading LSR clears its error flags, so every read is checked for an overrun
+    uint8_t lineStatus = *uartModule.LSR;
+    while (true) {
+        if (bitRead(lineStatus, LSR_RX_OE)) {
+            moduleStatistics->fifoOverruns++;
+        }
+        if (!bitRead(lineStatus, LSR_RX_FIFO_E)) {
+            break;
+        }
+
+        uint8_t c = *uartModule.RHR;
+        uint16_t nextTail = (ring->tail + 1) & (UART_RX_RING_SIZE - 1);
+        if (nextTail == ring->head) {
+            moduleStatistics->ringOverruns++;
+        } else {
+            ring->data[ring->tail] = c;
+            ring->tail = nextTail;
+        }
+        bytesReceived++;
+        lineStatus = *uartModule.LSR;
+    }
+
+    moduleStatistics->bytesReceived += bytesReceived;
+    if (bytesReceived > 0 && receiveCallbacks[module] != 0) {
+        receiveCallbacks[module](module);
+    }
+}
+
+/*
+ * Moves up to freeSpace bytes from the transmit ring into the FIFO. The THR interrupt is switched off
+ * once the ring is empty, and switched on again by uart_transmit.
+ */
+static void fillTxFifo(UartModule_t module, uint32_t freeSpace)
+{
+    Uart_t uartModule = modules[module];
+    TxRing_t* ring = &txRings[module];
+    while (freeSpace > 0 && ring->head != ring->tail) {
+        *uartModule.THR = ring->data[ring->head];
+        ring->head = (ring->head + 1) & (UART_TX_RING_SIZE - 1);
+        freeSpace--;
+    }
+    if (ring->head == ring->tail) {
+        bitClear(*uartModule.IER, IER_THR_IT);
+    }
+}
+
+/*
+ * Raised when the receive FIFO reaches the trigger level, on a receive timeout, on line errors (e.g. overrun)
+ * and when the transmit FIFO has TX_TRIGGER_SPACES free spaces.
+ */
 static void isr_handler(uint32_t source, PCB_t * currentPcb)
 {
     UartModule_t module = uart_getModuleFromIrqSource(source);
-    //Uart_t uartModule = modules[module];
-    //g_timer[timerNumber].callback(currentPcb);
+    Uart_t uartModule = modules[module];
+    // Reading IIR clears a THR interrupt, so it is read once
+    uint8_t interruptType = uart_getInterruptType(module);
+
+    if (isRxInterruptEnabled[module]) {
+        receiveBytes(module);
+    }
 
-    uint8_t isrTypeUart = uart_getInterruptType(module);
-    uart_read(module, &data);
+    // The FIFO is known to have room for the trigger level after a THR interrupt, and for all of it when empty
+    uint32_t freeSpace = 0;
+    if (bitRead(*uartModule.LSR, LSR_TX_FIFO_E)) {
+        freeSpace = TX_FIFO_SIZE;
+    } else if (interruptType == IIR_IT_TYPE_THR) {
+        freeSpace = TX_TRIGGER_SPACES;
+    }
+    fillTxFifo(module, freeSpace);
+}
+
+static void setupInterrupts(UartModule_t module, UartConfig_t config) {
+    // Transmission always uses the interrupt, reception only with a trigger level
+    isRxInterruptEnabled[module] = config.rxTriggerLevel > 0;
+    interrupts_registerHandler(&isr_handler, irqs[module]);
+    if (txRings[module].head != txRings[module].tail) {
+        // Setting up the protocol has cleared IER
+        bitSet(*modules[module].IER, IER_THR_IT);
+    }
 }
 
 void uart_initModule(UartModule_t module, UartConfig_t config) {
     Uart_t uartModule = modules[module];
+    if (config.rxTriggerLevel > UART_RX_TRIGGER_LEVEL_MAX) {
+        config.rxTriggerLevel = UART_RX_TRIGGER_LEVEL_MAX;
+    }
+
+    // Pending output is sent with the old configuration. The reset drops the receive FIFO, so the
+    // receive ring starts empty as well.
+    if (txRings[module].head != txRings[module].tail) {
+        uart_flush(module);
+    }
+    interrupts_disableIrqSource(irqs[module]);
+    rxRings[module].head = rxRings[module].tail;
+
+    configCounts[module]++;
     doSwReset(uartModule);
-    setupFifoAndDma(uartModule);
+    setupFifoAndDma(uartModule, config.rxTriggerLevel);
     setupProtocolBaudAndInterrupt(uartModule, config);
     setupHwFlowControl(uartModule);
+    setupInterrupts(module, config);
+    isInterruptDriven[module] = true;
+}
+
+bool uart_claim(UartModule_t module, UartOwner_t owner) {
+    int previousState = ATOMIC_START();
+    bool isClaimed = owners[module] == UART_OWNER_NONE || owners[module] == owner;
+    if (isClaimed) {
+        owners[module] = owner;
+    }
+    ATOMIC_END(previousState);
+    return isClaimed;
+}
 
-//    switch(module){
-//    case UART1:
-//        interrupts_registerHandler(&isr_handler, UART1_IRQ);
-//        break;
-//    case UART2:
-//        interrupts_registerHandler(&isr_handler, UART2_IRQ);
-//        break;
-//    case UART3:
-//        interrupts_registerHandler(&isr_handler, UART3_IRQ);
-//        break;
-//    }
+void uart_release(UartModule_t module, UartOwner_t owner) {
+    int previousState = ATOMIC_START();
+    if (owners[module] == owner) {
+        owners[module] = UART_OWNER_NONE;
+    }
+    ATOMIC_END(previousState);
+}
+
+uint32_t uart_getConfigCount(UartModule_t module) {
+    return configCounts[module];
+}
+
+void uart_setReceiveCallback(UartModule_t module, UartReceiveCallback_t callback) {
+    receiveCallbacks[module] = callback;
+}
+
+bool uart_isReceiveInterruptEnabled(UartModule_t module) {
+    return isRxInterruptEnabled[module];
+}
+
+void uart_getStatistics(UartModule_t module, UartStatistics_t* statistics) {
+    *statistics = uartStatistics[module];
 }
 
 static bool isReadyToTransmit(Uart_t uartModule) {
@@ -307,12 +462,54 @@ static bool isReadyToTransmit(Uart_t uartModule) {
 
 void uart_transmit(UartModule_t module, const uint8_t* buffer, uint32_t bufferSize) {
     Uart_t uartModule = modules[module];
-    int i;
-    for (i = 0; i < bufferSize; i++) {
-        while (!isReadyToTransmit(uartModule));
-        *uartModule.THR = buffer[i];
-        delay(15);
+    TxRing_t* ring = &txRings[module];
+    uint32_t i;
+    if (!isInterruptDriven[module]) {
+        for (i = 0; i < bufferSize; i++) {
+            while (!isReadyToTransmit(uartModule));
+            *uartModule.THR = buffer[i];
+        }
+        return;
+    }
+
+    // Interrupts are masked while bytes are queued (producers in interrupts, e.g. the console echo, queue bytes
+    // as well) and while the FIFO is filled, but not while waiting for the FIFO when the ring is full
+    i = 0;
+    while (i < bufferSize) {
+        int previousState = ATOMIC_START();
+        while (i < bufferSize) {
+            uint16_t nextTail = (ring->tail + 1) & (UART_TX_RING_SIZE - 1);
+            if (nextTail == ring->head) {
+                break;
+            }
+            ring->data[ring->tail] = buffer[i++];
+            ring->tail = nextTail;
+        }
+        // The interrupt clears the bit once it finds the ring empty
+        bitSet(*uartModule.IER, IER_THR_IT);
+        if (i < bufferSize && isReadyToTransmit(uartModule)) {
+            // The interrupt cannot drain the ring if the caller has interrupts masked (system calls, timer callbacks)
+            fillTxFifo(module, TX_FIFO_SIZE);
+        }
+        ATOMIC_END(previousState);
+    }
+}
+
+void uart_flush(UartModule_t module) {
+    Uart_t uartModule = modules[module];
+    while (txRings[module].head != txRings[module].tail) {
+        int previousState = ATOMIC_START();
+        if (isReadyToTransmit(uartModule)) {
+            fillTxFifo(module, TX_FIFO_SIZE);
+        }
+        ATOMIC_END(previousState);
     }
+    // Wait for the last byte to leave the shift register
+    while (!uart_isTransmitDone(module));
+}
+
+bool uart_isTransmitDone(UartModule_t module) {
+    return txRings[module].head == txRings[module].tail && bitRead(*modules[module].LSR, LSR_TX_SR_E);
 }
 
 static bool hasReceived(Uart_t uartModule) {
@@ -324,7 +521,30 @@ bool uart_resetFifo(UartModule_t module){
     return bitSet(*uartModule.FCR, 1);
 }
 
-uint32_t uart_receive(UartModule_t module, uint8_t* buffer, uint32_t bufferSize) {    // TODO buffer overflow?
+static uint32_t takeFromRing(RxRing_t* ring, uint8_t* buffer, uint32_t bufferSize) {
+    uint16_t head = ring->head;
+    uint16_t tail = ring->tail;
+    uint32_t bytesRead = 0;
+    // At most two pieces: up to the end of the ring and from its start
+    while (bytesRead < bufferSize && head != tail) {
+        uint16_t end = tail > head ? tail : UART_RX_RING_SIZE;
+        uint32_t size = end - head;
+        if (size > bufferSize - bytesRead) {
+            size = bufferSize - bytesRead;
+        }
+        memcpy(buffer + bytesRead, &ring->data[head], size);
+        bytesRead += size;
+        head = (head + size) & (UART_RX_RING_SIZE - 1);
+    }
+    ring->head = head;
+    return bytesRead;
+}
+
+uint32_t uart_receive(UartModule_t module, uint8_t* buffer, uint32_t bufferSize) {
+    if (isRxInterruptEnabled[module]) {
+        return takeFromRing(&rxRings[module], buffer, bufferSize);
+    }
+
     Uart_t uartModule = modules[module];
     int i;
     for (i = 0; i < bufferSize && hasReceived(uartModule); i++) {
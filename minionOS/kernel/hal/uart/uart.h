@@ -35,19 +35,90 @@ typedef enum {
     x13
 } UartBaudMultiple_t;
 
+// Received bytes are buffered in a ring per module, filled by the receive interrupt
+#define UART_RX_RING_SIZE 256   // must be a power of two
+
+// Bytes to send are queued in a ring per module, drained into the FIFO by the THR interrupt
+#define UART_TX_RING_SIZE 1024  // must be a power of two
+
+// Receive FIFO trigger levels (bytes), 0 disables the receive interrupt (uart_receive polls the FIFO then)
+#define UART_RX_TRIGGER_LEVEL_MAX       63
+#define UART_RX_TRIGGER_LEVEL_DEFAULT   8
+
 typedef struct {
     UartParityMode_t parityMode;
     UartStopMode_t stopMode;
     UartWordLength_t wordLength;
     uint64_t baudRate;
     UartBaudMultiple_t baudMultiple;
+    // Bytes in the receive FIFO which raise the receive interrupt. Fewer bytes raise it after a timeout of
+    // 4 characters, so a low level is only needed for low latency with a busy line.
+    uint8_t rxTriggerLevel;
 } UartConfig_t;
 
+typedef struct {
+    uint32_t bytesReceived;
+    // Bytes lost because the receive ring was full / the hardware FIFO overflowed before the interrupt was served
+    uint32_t ringOverruns;
+    uint32_t fifoOverruns;
+} UartStatistics_t;
+
+// Called from the receive interrupt after bytes have been added to the receive ring
+typedef void (*UartReceiveCallback_t)(UartModule_t module);
+
+// Driver using a module. Only its owner programs the module and sends on it.
+typedef enum {
+    UART_OWNER_NONE,
+    UART_OWNER_DEVICE,      // /dev/uart1.../dev/uart3
+    UART_OWNER_DMX
+} UartOwner_t;
+
+/*
+ * Makes owner the owner of the module if the module has none. Returns false if another driver owns it.
+ */
+bool uart_claim(UartModule_t module, UartOwner_t owner);
+
+/*
+ * Gives the module up if owner owns it.
+ */
+void uart_release(UartModule_t module, UartOwner_t owner);
+
+/*
+ * Number of times the module has been configured (uart_initModule, uart_updateConfig), so that a driver
+ * caching the configuration notices when another driver has changed it.
+ */
+uint32_t uart_getConfigCount(UartModule_t module);
+
+/*
+ * Returns up to bufferSize received bytes. With the receive interrupt, they are taken from the receive ring,
+ * otherwise from the hardware FIFO. Returns 0 if nothing has been received.
+ */
 
 uint32_t uart_receive(UartModule_t module, uint8_t* buffer, uint32_t bufferSize);
 
+void uart_setReceiveCallback(UartModule_t module, UartReceiveCallback_t callback);
+
+bool uart_isReceiveInterruptEnabled(UartModule_t module);
+
+void uart_getStatistics(UartModule_t module, UartStatistics_t* statistics);
+
+/*
+ * Queues the bytes for sending and returns. Only when the transmit ring is full, it waits for the FIFO to take
+ * bytes from the ring, with interrupts enabled unless the caller has masked them. Before uart_initModule has
+ * set up the interrupt, the bytes are sent polled, one at a time.
+ */
 void uart_transmit(UartModule_t module, const uint8_t* buffer, uint32_t bufferSize);
 
+/*
+ * Waits until all queued bytes have been sent, e.g. before changing the line (break) or the configuration.
+ */
+void uart_flush(UartModule_t module);
+
+/*
+ * Returns true if all queued bytes have been sent, without waiting.
+ */
+bool uart_isTransmitDone(UartModule_t module);
+
 void uart_enableBreak(UartModule_t module);
 
 void uart_disableBreak(UartModule_t module);
@@ -62,6 +133,8 @@ void uart_write(UartModule_t module, uint8_t c);
 
 void uart_read(UartModule_t module, uint8_t * c);
 
+uint8_t uart_getInterruptType(UartModule_t module);
+
 extern UartModule_t uart_getModuleFromIrqSource(uint8_t source);
 
 #endif
@@ -0,0 +1,261 @@
+/*
+ * asyncIo.c
+ *
+ *      Every process with rings has a context holding the frames of its rings and buffer area. The kernel
+ *      accesses them through the frames (mapped 1:1 for the kernel), not through the address space of the
+ *      process. A context works on one request at a time, in pieces which do not cross a page of the buffer area.
+ *      The pieces of the timer ticks are at most ASYNC_IO_BYTES_PER_TICK bytes and end at a sector boundary of the
+ *      file. Reads bypass the page cache, which would read a whole page on a miss, and a write of a whole sector
+ *      goes into the block cache without reading the sector first (or taking the direct multi-sector write).
+ */
+
+#include "asyncIo.h"
+#include "kernel/systemModules/mmu/mmu.h"
+#include "kernel/systemModules/memoryMapping/memoryMapping.h"
+#include "kernel/systemModules/filesystem/vfs.h"
+#include "kernel/systemModules/filesystem/processFiles.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ASYNC_IO_MAX_PAGES 16
+#define ASYNC_IO_TICK_INTERVAL_MS 1
+
+typedef struct {
+    // Frame 0 holds the rings, the others the buffer area
+    uint32_t frames[ASYNC_IO_MAX_PAGES];
+    uint32_t numberOfPages;
+    AsyncIoRing_t* ring;
+
+    // Address of the rings in the process
+    uint32_t vAddress;
+
+    // Request in progress, copied from the ring so that the process cannot change it meanwhile, and an own
+    // reference to its VFS file
+    AsyncIoRequest_t request;
+    int file;
+    unsigned int bytesDone;
+    int isBusy;
+
+    int isUsed;
+} AsyncIoContext_t;
+
+// Indexed by process id
+static AsyncIoContext_t g_contexts[MAX_ALLOWED_PROCESSES + 1];
+
+// Context to work on at the next tick
+static unsigned int g_nextContext;
+
+static void completeRequest(AsyncIoContext_t* context, int result) {
+    AsyncIoRing_t* ring = context->ring;
+    AsyncIoCompletion_t* completion = &ring->completions[ring->completionTail % ASYNC_IO_RING_ENTRIES];
+    completion->userData = context->request.userData;
+    completion->result = result;
+    ring->completionTail++;
+
+    if (context->isBusy) {
+        vfs_close(context->file);
+        context->isBusy = 0;
+    }
+}
+
+static int isBufferInArea(AsyncIoContext_t* context, const AsyncIoRequest_t* request) {
+    uint32_t start = context->vAddress + SMALL_PAGE_SIZE;
+    uint32_t end = context->vAddress + context->numberOfPages * SMALL_PAGE_SIZE;
+    uint32_t buffer = (uint32_t) request->buffer;
+    return buffer >= start && buffer <= end && request->bufferSize <= end - buffer;
+}
+
+/*
+ * Takes the next request from the ring. A request which cannot be started is completed right away.
+ * Returns 0 if there is no request or no room for its completion.
+ */
+static int takeRequest(AsyncIoContext_t* context, ProcessId_t processId) {
+    AsyncIoRing_t* ring = context->ring;
+    if (ring->requestHead == ring->requestTail
+            || ring->completionTail - ring->completionHead >= ASYNC_IO_RING_ENTRIES) {
+        return 0;
+    }
+
+    memcpy(&context->request, &ring->requests[ring->requestHead % ASYNC_IO_RING_ENTRIES], sizeof(AsyncIoRequest_t));
+    ring->requestHead++;
+    context->bytesDone = 0;
+
+    AsyncIoRequest_t* request = &context->request;
+    if (request->operation > ASYNC_IO_WRITE || !isBufferInArea(context, request)) {
+        completeRequest(context, ASYNC_IO_INVALID_REQUEST);
+        return 1;
+    }
+
+    int file = processFiles_get(scheduler_getProcess(processId), request->fileDescriptor);
+    if (!isValidFile(file)) {
+        completeRequest(context, INVALID_FILE_DESCRIPTOR);
+        return 1;
+    }
+
+    // Keeps the file open if the process closes its descriptor before the request is done
+    context->file = vfs_dup(file);
+    context->isBusy = 1;
+    return 1;
+}
+
+/*
+ * Transfers the next piece of the current request, at most maxBytes. In the timer interrupt (isTick), the piece
+ * ends at the next sector boundary of the file and reads do not go through the page cache.
+ * Returns 0 if there was nothing to do.
+ */
+static int workOnRequest(AsyncIoContext_t* context, ProcessId_t processId, unsigned int maxBytes, int isTick) {
+    if (!context->isBusy && !takeRequest(context, processId)) {
+        return 0;
+    }
+    if (!context->isBusy) {
+        return 1;
+    }
+
+    AsyncIoRequest_t* request = &context->request;
+    unsigned int bytesLeft = request->bufferSize - context->bytesDone;
+    if (bytesLeft == 0) {
+        completeRequest(context, 0);
+        return 1;
+    }
+
+    // The page of the buffer area holding the next byte, the piece ends with the page
+    uint32_t areaOffset = (uint32_t) request->buffer + context->bytesDone - context->vAddress;
+    unsigned int offsetInPage = areaOffset % SMALL_PAGE_SIZE;
+    uint8_t* data = (uint8_t*) context->frames[areaOffset / SMALL_PAGE_SIZE] + offsetInPage;
+
+    unsigned int size = bytesLeft;
+    if (size > maxBytes) {
+        size = maxBytes;
+    }
+    if (size > SMALL_PAGE_SIZE - offsetInPage) {
+        size = SMALL_PAGE_SIZE - offsetInPage;
+    }
+
+    if (isTick) {
+        // Streams have no position, their pieces are not aligned
+        int filePosition = (request->operation == ASYNC_IO_READ_AT) ? (int) (request->offset + context->bytesDone)
+                : vfs_lseek(context->file, 0, SEEK_CUR);
+        if (filePosition >= 0 && size > ASYNC_IO_BYTES_PER_TICK - filePosition % ASYNC_IO_BYTES_PER_TICK) {
+            size = ASYNC_IO_BYTES_PER_TICK - filePosition % ASYNC_IO_BYTES_PER_TICK;
+        }
+    }
+
+    int result;
+    switch (request->operation) {
+    case ASYNC_IO_READ:
+        result = isTick ? vfs_readUncached(context->file, data, size) : vfs_read(context->file, data, size);
+        break;
+    case ASYNC_IO_READ_AT:
+        result = isTick ? vfs_preadUncached(context->file, data, size, request->offset + context->bytesDone)
+                : vfs_pread(context->file, data, size, request->offset + context->bytesDone);
+        break;
+    default:
+        result = vfs_write(context->file, data, size);
+        break;
+    }
+
+    if (result < 0) {
+        // Bytes transferred before the error are reported rather than the error
+        completeRequest(context, context->bytesDone > 0 ? (int) context->bytesDone : result);
+        return 1;
+    }
+
+    context->bytesDone += result;
+    if ((unsigned int) result < size || context->bytesDone == request->bufferSize) {
+        // End of the file, or a device with no more data for now
+        completeRequest(context, context->bytesDone);
+    }
+    return 1;
+}
+
+/*
+ * Gives the tick to the next context with work, so that every process with requests gets its turn.
+ */
+static void handleTick(PCB_t* currentPcb) {
+    unsigned int i;
+    for (i = 0; i <= MAX_ALLOWED_PROCESSES; ++i) {
+        unsigned int processId = g_nextContext;
+        g_nextContext = (g_nextContext + 1) % (MAX_ALLOWED_PROCESSES + 1);
+
+        AsyncIoContext_t* context = &g_contexts[processId];
+        if (context->isUsed && workOnRequest(context, processId, ASYNC_IO_BYTES_PER_TICK, 1)) {
+            return;
+        }
+    }
+}
+
+void asyncIo_init(void) {
+    SubscriptionId_t subscription = systemTimer_subscribeCallback(ASYNC_IO_TICK_INTERVAL_MS, &handleTick);
+    systemTimer_enableSubscription(subscription);
+}
+
+static void freeFrames(AsyncIoContext_t* context) {
+    uint32_t i;
+    for (i = 0; i < context->numberOfPages; ++i) {
+        mmu_freeFrame(context->frames[i]);
+    }
+}
+
+AsyncIoRing_t* asyncIo_setup(PCB_t* process, unsigned int bufferSize, uint8_t** buffer) {
+    AsyncIoContext_t* context = &g_contexts[process->processId];
+    if (context->isUsed || bufferSize > ASYNC_IO_MAX_BUFFER_SIZE) {
+        return NULL;
+    }
+
+    context->numberOfPages = 0;
+    uint32_t numberOfPages = 1 + (bufferSize + SMALL_PAGE_SIZE - 1) / SMALL_PAGE_SIZE;
+    while (context->numberOfPages < numberOfPages) {
+        uint32_t frame = mmu_allocateFrame();
+        if (frame == 0) {
+            freeFrames(context);
+            return NULL;
+        }
+        // Frames may have held pages of other processes' files
+        memset((void*) frame, 0, SMALL_PAGE_SIZE);
+        context->frames[context->numberOfPages++] = frame;
+    }
+
+    void* vAddress = memoryMapping_mapFrames(process, context->frames, context->numberOfPages, RWRW);
+    if (vAddress == NULL) {
+        freeFrames(context);
+        return NULL;
+    }
+
+    context->ring = (AsyncIoRing_t*) context->frames[0];
+    context->vAddress = (uint32_t) vAddress;
+    context->isBusy = 0;
+    context->isUsed = 1;
+
+    *buffer = (uint8_t*) vAddress + SMALL_PAGE_SIZE;
+    return (AsyncIoRing_t*) vAddress;
+}
+
+int asyncIo_wait(PCB_t* process, unsigned int minCompletions) {
+    AsyncIoContext_t* context = &g_contexts[process->processId];
+    if (!context->isUsed) {
+        return -1;
+    }
+
+    AsyncIoRing_t* ring = context->ring;
+    while (ring->completionTail - ring->completionHead < minCompletions
+            && workOnRequest(context, process->processId, SMALL_PAGE_SIZE, 0)) {
+    }
+    return ring->completionTail - ring->completionHead;
+}
+
+void asyncIo_release(PCB_t* process) {
+    AsyncIoContext_t* context = &g_contexts[process->processId];
+    if (!context->isUsed) {
+        return;
+    }
+
+    // The mapping of the rings has been removed with the other mappings of the process
+    if (context->isBusy) {
+        vfs_close(context->file);
+        context->isBusy = 0;
+    }
+    freeFrames(context);
+    context->isUsed = 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * asyncIo.h
+ *
+ *      Asynchronous file I/O. A process posts read and write requests into a submission ring shared with the
+ *      kernel (AsyncIoRing_t) and collects the results from a completion ring. The kernel works on the requests
+ *      in the background, a piece on every system timer tick, so the process continues computing meanwhile.
+ *      Buffers of requests lie in a buffer area shared with the kernel as well, so that the kernel reaches them
+ *      while any process is running.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_ASYNCIO_ASYNCIO_H_
+#define KERNEL_SYSTEMMODULES_ASYNCIO_ASYNCIO_H_
+
+#include <inttypes.h>
+#include "asyncIoRing.h"
+#include "kernel/systemModules/processManagement/contextSwitch.h"
+
+// Bytes transferred per system timer tick, the requests of all processes take turns. The ticks run in the timer
+// interrupt, which must not wait for more than one polled transfer of the SD card, so a piece is at most one sector.
+#define ASYNC_IO_BYTES_PER_TICK 512
+
+/*
+ * Starts working on requests in the background, called once at boot after the system timer is initialized.
+ */
+void asyncIo_init(void);
+
+/*
+ * Creates the rings of the process and a buffer area of bufferSize bytes, both mapped into the process.
+ * Returns the address of the rings and sets *buffer to the buffer area, which follows the rings. Returns NULL
+ * if the process has rings already, bufferSize is larger than ASYNC_IO_MAX_BUFFER_SIZE or there is no memory.
+ */
+AsyncIoRing_t* asyncIo_setup(PCB_t* process, unsigned int bufferSize, uint8_t** buffer);
+
+/*
+ * Waits until at least minCompletions completions are available in the ring of the process. Outstanding
+ * requests are worked on right away instead of in the background while waiting. Returns the number of
+ * available completions, which is less than minCompletions if there are no more requests, or a negative
+ * number if the process has no rings.
+ */
+int asyncIo_wait(PCB_t* process, unsigned int minCompletions);
+
+/*
+ * Drops the rings and the pending requests of the process, called when the process exits.
+ */
+void asyncIo_release(PCB_t* process);
+
+#endif /* KERNEL_SYSTEMMODULES_ASYNCIO_ASYNCIO_H_ */
@@ -0,0 +1,461 @@
+/*
+ * blockCache.c
+ *
+ *      System calls run with IRQs masked, so the prefetcher (running in the system timer IRQ) never
+ *      interrupts a file system operation and the cache needs no further locking.
+ *
+ *      Dirty sectors are never written back in the IRQ handler, where a flush of the whole cache would hold
+ *      up all other interrupts. There a dirty sector is not evicted, the least recently used clean one is.
+ *      The periodic sync writes back with blockCache_flushSector, one sector per tick.
+ */
+
+#include "blockCache.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "global/types.h"
+#include <string.h>
+
+#define INVALID_SECTOR_ADDRESS 0xFFFFFFFF
+
+// Maximum number of pending prefetch requests
+#define PREFETCH_QUEUE_SIZE 8
+
+// Sectors read from storage per system timer tick. The reads are polled in the IRQ handler, so another
+// interrupt waits for at most one of them.
+#define PREFETCH_SECTORS_PER_TICK 1
+
+#define PREFETCH_INTERVAL_MS 1
+
+// Maximum number of sectors written in one transfer when flushing
+#define MAX_SECTORS_PER_WRITE 8
+
+// Runs of at least this many sectors bypass the cache when written
+#define DIRECT_WRITE_MIN_SECTORS 8
+
+typedef struct {
+    BlockDevice_t * device;
+    uint32_t address;
+    uint32_t lastUsed;
+
+    // Set if the sector was loaded by the prefetcher and has not been used yet
+    uint16_t isPrefetched;
+
+    // Set if the sector was modified and not yet written to storage
+    uint16_t isDirty;
+} BlockCacheEntry_t;
+
+typedef struct {
+    BlockDevice_t * device;
+    uint32_t address;
+    uint32_t count;
+} PrefetchRequest_t;
+
+static BlockCacheEntry_t g_entries[BLOCK_CACHE_ENTRIES];
+static uint8_t g_data[BLOCK_CACHE_ENTRIES][BLOCK_CACHE_SECTOR_SIZE];
+
+// Incremented on every access, used for LRU eviction
+static uint32_t g_useCounter;
+
+// Consecutive dirty sectors are copied here, to be written in one transfer
+static uint8_t g_writeBuffer[MAX_SECTORS_PER_WRITE * BLOCK_CACHE_SECTOR_SIZE];
+
+static PrefetchRequest_t g_prefetchQueue[PREFETCH_QUEUE_SIZE];
+static uint32_t g_prefetchQueueHead;
+static uint32_t g_prefetchQueueLength;
+
+static BlockCacheStatistics_t g_statistics;
+
+static SubscriptionId_t g_prefetchSubscription;
+
+static void prefetchTick(PCB_t * currentPcb);
+
+extern uint32_t asm_isInInterrupt(void);
+
+/*
+ * Transfer count sectors starting at the byte address between buf and the device. Return the number of bytes transferred.
+ */
+static uint32_t readFromDevice(BlockDevice_t * device, uint8_t * buf, uint32_t address, uint32_t count){
+    return blockDevice_read(device, buf, address / BLOCK_CACHE_SECTOR_SIZE, count) * BLOCK_CACHE_SECTOR_SIZE;
+}
+
+static uint32_t writeToDevice(BlockDevice_t * device, const uint8_t * buf, uint32_t address, uint32_t count){
+    return blockDevice_write(device, buf, address / BLOCK_CACHE_SECTOR_SIZE, count) * BLOCK_CACHE_SECTOR_SIZE;
+}
+
+/*
+ * Returns the index of the entry caching the sector at address of the device, or -1 if the sector is not cached.
+ */
+static int findEntry(BlockDevice_t * device, uint32_t address){
+    int i;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        if(g_entries[i].address == address && g_entries[i].device == device){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Order of sectors when flushing: by device, then by address.
+ */
+static int isSectorBefore(BlockCacheEntry_t * entry1, BlockCacheEntry_t * entry2){
+    if(entry1->device != entry2->device){
+        return entry1->device < entry2->device;
+    }
+    return entry1->address < entry2->address;
+}
+
+/*
+ * Returns the index of the least recently used entry, of the clean ones only if onlyClean is set. Returns -1
+ * if there is no such entry.
+ */
+static int findLeastRecentlyUsed(uint16_t onlyClean){
+    int victim = -1;
+    int i;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        if(onlyClean && g_entries[i].isDirty){
+            continue;
+        }
+        if(victim < 0 || g_entries[i].lastUsed < g_entries[victim].lastUsed){
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/*
+ * Returns a free entry, or evicts the least recently used one. In the IRQ handler only clean entries are
+ * evicted. Returns -1 if the entry to evict is dirty and cannot be written back.
+ */
+static int allocateEntry(void){
+    int i;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        if(g_entries[i].address == INVALID_SECTOR_ADDRESS){
+            return i;
+        }
+    }
+
+    int victim = findLeastRecentlyUsed(asm_isInInterrupt());
+    if(victim < 0){
+        // All entries are dirty
+        return -1;
+    }
+    if(g_entries[victim].isDirty){
+        // Write back all dirty sectors at once, rather than just the victim
+        blockCache_flush();
+        if(g_entries[victim].isDirty){
+            // Do not lose modified data
+            return -1;
+        }
+    }
+
+    if(g_entries[victim].isPrefetched){
+        g_statistics.prefetchWasted++;
+    }
+    g_entries[victim].address = INVALID_SECTOR_ADDRESS;
+    g_entries[victim].isPrefetched = FALSE;
+    return victim;
+}
+
+/*
+ * Marks an entry as used by a reader.
+ */
+static void touchEntry(int entry){
+    g_entries[entry].lastUsed = ++g_useCounter;
+    if(g_entries[entry].isPrefetched){
+        g_entries[entry].isPrefetched = FALSE;
+        g_statistics.prefetchHits++;
+    }
+    g_statistics.hits++;
+}
+
+/*
+ * Removes the sectors [address, address+count) from the pending prefetch requests, because they have
+ * been read synchronously in the meantime. Only the front of a request is trimmed, which is the common
+ * case for sequential readers catching up with the prefetcher.
+ */
+static void dropQueuedSectors(BlockDevice_t * device, uint32_t address, uint32_t count){
+    uint32_t endAddress = address + count * BLOCK_CACHE_SECTOR_SIZE;
+    uint32_t i;
+    for(i = 0; i < g_prefetchQueueLength; i++){
+        PrefetchRequest_t * request = &g_prefetchQueue[(g_prefetchQueueHead + i) % PREFETCH_QUEUE_SIZE];
+        while(request->count > 0 && request->device == device && request->address >= address && request->address < endAddress){
+            request->address += BLOCK_CACHE_SECTOR_SIZE;
+            request->count--;
+        }
+    }
+}
+
+void blockCache_init(void){
+    blockCache_invalidate();
+    memset(&g_statistics, 0, sizeof(g_statistics));
+
+    g_prefetchSubscription = systemTimer_subscribeCallback(PREFETCH_INTERVAL_MS, prefetchTick);
+    systemTimer_enableSubscription(g_prefetchSubscription);
+}
+
+uint32_t blockCache_readSector(BlockDevice_t * device, uint8_t * buf, uint32_t address){
+    int entry = findEntry(device, address);
+    if(entry < 0){
+        g_statistics.misses++;
+        dropQueuedSectors(device, address, 1);
+
+        entry = allocateEntry();
+        if(entry < 0){
+            // Read without caching
+            return readFromDevice(device, buf, address, 1);
+        }
+        if(readFromDevice(device, g_data[entry], address, 1) != BLOCK_CACHE_SECTOR_SIZE){
+            return 0;
+        }
+        g_entries[entry].device = device;
+        g_entries[entry].address = address;
+        g_entries[entry].lastUsed = ++g_useCounter;
+    } else {
+        touchEntry(entry);
+    }
+
+    memcpy(buf, g_data[entry], BLOCK_CACHE_SECTOR_SIZE);
+    return BLOCK_CACHE_SECTOR_SIZE;
+}
+
+uint32_t blockCache_readSectors(BlockDevice_t * device, uint8_t * buf, uint32_t address, uint32_t count){
+    uint32_t bytesRead = 0;
+    uint32_t i = 0;
+    while(i < count){
+        int entry = findEntry(device, address + bytesRead);
+        if(entry >= 0){
+            touchEntry(entry);
+            memcpy(buf + bytesRead, g_data[entry], BLOCK_CACHE_SECTOR_SIZE);
+            bytesRead += BLOCK_CACHE_SECTOR_SIZE;
+            i++;
+            continue;
+        }
+
+        // Read the run of uncached sectors at once, straight into the caller's buffer
+        uint32_t runLength = 1;
+        while(i + runLength < count && findEntry(device, address + bytesRead + runLength * BLOCK_CACHE_SECTOR_SIZE) < 0){
+            runLength++;
+        }
+        g_statistics.misses += runLength;
+        dropQueuedSectors(device, address + bytesRead, runLength);
+
+        uint32_t result = readFromDevice(device, buf + bytesRead, address + bytesRead, runLength);
+        bytesRead += result;
+        if(result != runLength * BLOCK_CACHE_SECTOR_SIZE){
+            break;
+        }
+        i += runLength;
+    }
+    return bytesRead;
+}
+
+uint32_t blockCache_writeSector(BlockDevice_t * device, const uint8_t * buf, uint32_t address){
+    int entry = findEntry(device, address);
+    if(entry < 0){
+        dropQueuedSectors(device, address, 1);
+        entry = allocateEntry();
+        if(entry < 0){
+            return 0;
+        }
+        g_entries[entry].device = device;
+        g_entries[entry].address = address;
+    }
+
+    memcpy(g_data[entry], buf, BLOCK_CACHE_SECTOR_SIZE);
+    g_entries[entry].lastUsed = ++g_useCounter;
+    g_entries[entry].isPrefetched = FALSE;
+    g_entries[entry].isDirty = TRUE;
+    return BLOCK_CACHE_SECTOR_SIZE;
+}
+
+uint32_t blockCache_writeSectors(BlockDevice_t * device, const uint8_t * buf, uint32_t address, uint32_t count){
+    uint32_t i;
+
+    if(count < DIRECT_WRITE_MIN_SECTORS){
+        uint32_t bytesWritten = 0;
+        for(i = 0; i < count; i++){
+            uint32_t result = blockCache_writeSector(device, buf + bytesWritten, address + bytesWritten);
+            bytesWritten += result;
+            if(result != BLOCK_CACHE_SECTOR_SIZE){
+                break;
+            }
+        }
+        return bytesWritten;
+    }
+
+    // Cached copies are outdated by this write
+    for(i = 0; i < count; i++){
+        int entry = findEntry(device, address + i * BLOCK_CACHE_SECTOR_SIZE);
+        if(entry >= 0){
+            g_entries[entry].address = INVALID_SECTOR_ADDRESS;
+            g_entries[entry].isPrefetched = FALSE;
+            g_entries[entry].isDirty = FALSE;
+        }
+    }
+    dropQueuedSectors(device, address, count);
+
+    uint32_t bytesWritten = writeToDevice(device, buf, address, count);
+    g_statistics.sectorsWritten += bytesWritten / BLOCK_CACHE_SECTOR_SIZE;
+    g_statistics.writeTransfers++;
+    return bytesWritten;
+}
+
+uint32_t blockCache_flush(void){
+    // Indices of the dirty entries, sorted by device and address
+    int dirtyEntries[BLOCK_CACHE_ENTRIES];
+    int numberOfDirtyEntries = 0;
+    int i, j;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        if(g_entries[i].isDirty){
+            j = numberOfDirtyEntries++;
+            while(j > 0 && isSectorBefore(&g_entries[i], &g_entries[dirtyEntries[j - 1]])){
+                dirtyEntries[j] = dirtyEntries[j - 1];
+                j--;
+            }
+            dirtyEntries[j] = i;
+        }
+    }
+
+    uint32_t result = 0;
+    i = 0;
+    while(i < numberOfDirtyEntries){
+        BlockDevice_t * device = g_entries[dirtyEntries[i]].device;
+        uint32_t address = g_entries[dirtyEntries[i]].address;
+
+        // Find the run of consecutive sectors starting here
+        int runLength = 1;
+        while(i + runLength < numberOfDirtyEntries && runLength < MAX_SECTORS_PER_WRITE
+                && g_entries[dirtyEntries[i + runLength]].device == device
+                && g_entries[dirtyEntries[i + runLength]].address == address + runLength * BLOCK_CACHE_SECTOR_SIZE){
+            runLength++;
+        }
+
+        uint32_t bytesWritten;
+        if(runLength == 1){
+            bytesWritten = writeToDevice(device, g_data[dirtyEntries[i]], address, 1);
+        } else {
+            for(j = 0; j < runLength; j++){
+                memcpy(g_writeBuffer + j * BLOCK_CACHE_SECTOR_SIZE, g_data[dirtyEntries[i + j]], BLOCK_CACHE_SECTOR_SIZE);
+            }
+            bytesWritten = writeToDevice(device, g_writeBuffer, address, runLength);
+        }
+        g_statistics.writeTransfers++;
+
+        if(bytesWritten == runLength * BLOCK_CACHE_SECTOR_SIZE){
+            for(j = 0; j < runLength; j++){
+                g_entries[dirtyEntries[i + j]].isDirty = FALSE;
+            }
+            g_statistics.sectorsWritten += runLength;
+        } else {
+            result = 1;
+        }
+        i += runLength;
+    }
+
+    return result;
+}
+
+uint32_t blockCache_flushSector(void){
+    int entry = -1;
+    int i;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        if(g_entries[i].isDirty && (entry < 0 || g_entries[i].lastUsed < g_entries[entry].lastUsed)){
+            entry = i;
+        }
+    }
+    if(entry < 0){
+        return 0;
+    }
+
+    uint32_t bytesWritten = writeToDevice(g_entries[entry].device, g_data[entry], g_entries[entry].address, 1);
+    g_statistics.writeTransfers++;
+    if(bytesWritten != BLOCK_CACHE_SECTOR_SIZE){
+        return 0;
+    }
+    g_entries[entry].isDirty = FALSE;
+    g_statistics.sectorsWritten++;
+    return 1;
+}
+
+void blockCache_prefetch(BlockDevice_t * device, uint32_t address, uint32_t count){
+    // Skip the part which is already cached
+    while(count > 0 && findEntry(device, address) >= 0){
+        address += BLOCK_CACHE_SECTOR_SIZE;
+        count--;
+    }
+
+    // Never prefetch more than half of the cache, otherwise prefetched sectors evict each other
+    if(count > BLOCK_CACHE_ENTRIES / 2){
+        count = BLOCK_CACHE_ENTRIES / 2;
+    }
+
+    if(count == 0 || g_prefetchQueueLength == PREFETCH_QUEUE_SIZE){
+        return;
+    }
+
+    PrefetchRequest_t * request = &g_prefetchQueue[(g_prefetchQueueHead + g_prefetchQueueLength) % PREFETCH_QUEUE_SIZE];
+    request->device = device;
+    request->address = address;
+    request->count = count;
+    g_prefetchQueueLength++;
+}
+
+void blockCache_invalidate(void){
+    int i;
+    for(i = 0; i < BLOCK_CACHE_ENTRIES; i++){
+        g_entries[i].address = INVALID_SECTOR_ADDRESS;
+        g_entries[i].isPrefetched = FALSE;
+        g_entries[i].isDirty = FALSE;
+    }
+    g_prefetchQueueHead = 0;
+    g_prefetchQueueLength = 0;
+}
+
+void blockCache_getStatistics(BlockCacheStatistics_t * statistics){
+    *statistics = g_statistics;
+}
+
+/*
+ * Loads queued sectors into the cache, PREFETCH_SECTORS_PER_TICK at most. Sectors which are cached already
+ * are skipped without counting. Called by the system timer.
+ */
+static void prefetchTick(PCB_t * currentPcb){
+    uint32_t sectorsRead = 0;
+
+    while(g_prefetchQueueLength > 0 && sectorsRead < PREFETCH_SECTORS_PER_TICK){
+        PrefetchRequest_t * request = &g_prefetchQueue[g_prefetchQueueHead];
+        if(request->count == 0){
+            g_prefetchQueueHead = (g_prefetchQueueHead + 1) % PREFETCH_QUEUE_SIZE;
+            g_prefetchQueueLength--;
+            continue;
+        }
+
+        BlockDevice_t * device = request->device;
+        uint32_t address = request->address;
+        request->address += BLOCK_CACHE_SECTOR_SIZE;
+        request->count--;
+
+        if(findEntry(device, address) >= 0){
+            continue;
+        }
+
+        int entry = allocateEntry();
+        if(entry < 0){
+            // No entry can be freed, give up on this request
+            request->count = 0;
+            continue;
+        }
+        // A failed read takes its time as well
+        sectorsRead++;
+        if(readFromDevice(device, g_data[entry], address, 1) != BLOCK_CACHE_SECTOR_SIZE){
+            // Storage error, give up on this request
+            request->count = 0;
+            continue;
+        }
+        g_entries[entry].device = device;
+        g_entries[entry].address = address;
+        g_entries[entry].lastUsed = ++g_useCounter;
+        g_entries[entry].isPrefetched = TRUE;
+        g_statistics.prefetched++;
+    }
+}
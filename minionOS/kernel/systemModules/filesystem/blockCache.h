@@ -0,0 +1,96 @@
+/*
+ * blockCache.h
+ *
+ *      Small sector cache sitting between the FAT layer and the block devices. Sectors are addressed by
+ *      device and byte address on the device, all devices share the cache.
+ *      The cache is write-back: written sectors are only marked dirty and written to storage on
+ *      blockCache_flush (or when a dirty sector is evicted outside of interrupt handlers), with consecutive
+ *      dirty sectors coalesced into multi-sector writes.
+ *      Besides caching sectors on demand, sectors can be queued for prefetching. Queued sectors
+ *      are loaded in the background by a system timer callback (while user processes run), so
+ *      that sequential readers find their data ready.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKCACHE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKCACHE_H_
+
+#include <inttypes.h>
+#include "blockDevice.h"
+
+#define BLOCK_CACHE_SECTOR_SIZE 512
+
+// Number of cached sectors (16 KB)
+#define BLOCK_CACHE_ENTRIES 32
+
+typedef struct {
+    // Sectors found in the cache / read from storage
+    uint32_t hits;
+    uint32_t misses;
+
+    // Sectors loaded by the prefetcher
+    uint32_t prefetched;
+    // Prefetched sectors that were used before being evicted
+    uint32_t prefetchHits;
+    // Prefetched sectors that were evicted without being used
+    uint32_t prefetchWasted;
+
+    // Sectors written to storage and the number of write transfers used for them
+    uint32_t sectorsWritten;
+    uint32_t writeTransfers;
+} BlockCacheStatistics_t;
+
+/*
+ * Initializes the cache and subscribes the background prefetcher to the system timer.
+ */
+void blockCache_init(void);
+
+/*
+ * Reads the sector at the given byte address, either from the cache or from storage. A sector read
+ * from storage is put into the cache. Returns the number of bytes read.
+ */
+uint32_t blockCache_readSector(BlockDevice_t * device, uint8_t * buf, uint32_t address);
+
+/*
+ * Reads count consecutive sectors into buf. Cached sectors are copied, all others are read from storage
+ * directly into buf without being cached. Returns the number of bytes read.
+ */
+uint32_t blockCache_readSectors(BlockDevice_t * device, uint8_t * buf, uint32_t address, uint32_t count);
+
+/*
+ * Writes the sector at the given byte address into the cache and marks it dirty. Returns the number of bytes written.
+ */
+uint32_t blockCache_writeSector(BlockDevice_t * device, const uint8_t * buf, uint32_t address);
+
+/*
+ * Writes count consecutive sectors. Short runs go into the cache like blockCache_writeSector, long runs are
+ * written to storage directly in one transfer (replacing any cached copies). Returns the number of bytes written.
+ */
+uint32_t blockCache_writeSectors(BlockDevice_t * device, const uint8_t * buf, uint32_t address, uint32_t count);
+
+/*
+ * Writes all dirty sectors (of all devices) to storage. Returns 0 on success, or 1 if a sector could not be written
+ * (it stays dirty).
+ */
+uint32_t blockCache_flush(void);
+
+/*
+ * Writes the least recently used dirty sector to storage, for writing back in steps of one sector from an
+ * interrupt handler. Returns 1 if a sector was written, 0 if none is dirty or the write failed (the sector
+ * stays dirty).
+ */
+uint32_t blockCache_flushSector(void);
+
+/*
+ * Queues count consecutive sectors starting at the given byte address for prefetching.
+ * Sectors which are already cached are skipped.
+ */
+void blockCache_prefetch(BlockDevice_t * device, uint32_t address, uint32_t count);
+
+/*
+ * Drops all cached sectors (including dirty ones) and all queued prefetches.
+ */
+void blockCache_invalidate(void);
+
+void blockCache_getStatistics(BlockCacheStatistics_t * statistics);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKCACHE_H_ */
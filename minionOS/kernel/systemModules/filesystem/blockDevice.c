@@ -0,0 +1,147 @@
+/*
+ * blockDevice.c
+ */
+
+#include "blockDevice.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define MBR_BLOCK_SIZE 512
+#define PARTITION_TABLE_OFFSET 0x1BE
+#define PARTITION_SECTOR_SIGNATURE 0xAA55 // inverted byte order
+
+// Partition types of extended partitions, logical partitions are not supported
+#define EXTENDED_PARTITION_TYPE 5
+#define EXTENDED_PARTITION_LBA_TYPE 15
+
+static BlockDevice_t * g_devices[MAX_BLOCK_DEVICES];
+static unsigned int g_deviceCount;
+
+// Devices of the partitions found by blockDevice_scanPartitions
+static BlockDevice_t g_partitions[MAX_BLOCK_DEVICES];
+static unsigned int g_partitionCount;
+
+int blockDevice_register(BlockDevice_t * device){
+    if(g_deviceCount >= MAX_BLOCK_DEVICES || blockDevice_get(device->name) != NULL){
+        return BLOCK_DEVICE_REGISTER_FAILED;
+    }
+    g_devices[g_deviceCount++] = device;
+    return 0;
+}
+
+BlockDevice_t * blockDevice_get(const char * name){
+    unsigned int i;
+    for(i = 0; i < g_deviceCount; i++){
+        if(strncmp(g_devices[i]->name, name, BLOCK_DEVICE_NAME_LENGTH) == 0){
+            return g_devices[i];
+        }
+    }
+    return NULL;
+}
+
+BlockDevice_t * blockDevice_getByIndex(unsigned int index){
+    return (index < g_deviceCount) ? g_devices[index] : NULL;
+}
+
+uint32_t blockDevice_read(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    uint32_t blocksRead = 0;
+    while(blocksRead < count){
+        uint32_t blocksToRead = count - blocksRead;
+        if(blocksToRead > device->queueDepth){
+            blocksToRead = device->queueDepth;
+        }
+
+        uint32_t result = device->readBlocks(device, buffer + blocksRead * device->blockSize, firstBlock + blocksRead, blocksToRead);
+        blocksRead += result;
+        if(result != blocksToRead){
+            break;
+        }
+    }
+    return blocksRead;
+}
+
+uint32_t blockDevice_write(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    uint32_t blocksWritten = 0;
+    while(blocksWritten < count){
+        uint32_t blocksToWrite = count - blocksWritten;
+        if(blocksToWrite > device->queueDepth){
+            blocksToWrite = device->queueDepth;
+        }
+
+        uint32_t result = device->writeBlocks(device, buffer + blocksWritten * device->blockSize, firstBlock + blocksWritten, blocksToWrite);
+        blocksWritten += result;
+        if(result != blocksToWrite){
+            break;
+        }
+    }
+    return blocksWritten;
+}
+
+/*
+ * Transfers of partitions are forwarded to the disk, after checking that they stay within the partition.
+ */
+static uint32_t partition_readBlocks(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(firstBlock >= device->numberOfBlocks || count > device->numberOfBlocks - firstBlock){
+        return 0;
+    }
+    return device->disk->readBlocks(device->disk, buffer, device->firstBlock + firstBlock, count);
+}
+
+static uint32_t partition_writeBlocks(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(firstBlock >= device->numberOfBlocks || count > device->numberOfBlocks - firstBlock){
+        return 0;
+    }
+    return device->disk->writeBlocks(device->disk, buffer, device->firstBlock + firstBlock, count);
+}
+
+unsigned int blockDevice_scanPartitions(BlockDevice_t * disk){
+    uint8_t buffer[MBR_BLOCK_SIZE];
+    if(disk->blockSize != MBR_BLOCK_SIZE || disk->readBlocks(disk, buffer, 0, 1) != 1){
+        return 0;
+    }
+
+    uint16_t signature = buffer[MBR_BLOCK_SIZE - 2] | (buffer[MBR_BLOCK_SIZE - 1] << 8);
+    if(signature != PARTITION_SECTOR_SIGNATURE){
+        // No MBR
+        return 0;
+    }
+
+    unsigned int partitionsFound = 0;
+    unsigned int i;
+    for(i = 0; i < MBR_PARTITION_ENTRIES; i++){
+        PartitionTable_t entry;
+        memcpy(&entry, buffer + PARTITION_TABLE_OFFSET + i * sizeof(PartitionTable_t), sizeof(PartitionTable_t));
+
+        if(entry.partitionType == 0 || entry.partitionType == EXTENDED_PARTITION_TYPE
+                || entry.partitionType == EXTENDED_PARTITION_LBA_TYPE || entry.partitionSizeInSectors == 0){
+            continue;
+        }
+        if(entry.relativeOffsetPartitionSectors >= disk->numberOfBlocks
+                || entry.partitionSizeInSectors > disk->numberOfBlocks - entry.relativeOffsetPartitionSectors){
+            // Partition table does not fit the disk
+            continue;
+        }
+        if(g_partitionCount >= MAX_BLOCK_DEVICES){
+            break;
+        }
+
+        BlockDevice_t * partition = &g_partitions[g_partitionCount];
+        snprintf(partition->name, BLOCK_DEVICE_NAME_LENGTH, "%sp%u", disk->name, i + 1);
+        partition->blockSize = disk->blockSize;
+        partition->numberOfBlocks = entry.partitionSizeInSectors;
+        partition->queueDepth = disk->queueDepth;
+        partition->readBlocks = partition_readBlocks;
+        partition->writeBlocks = partition_writeBlocks;
+        partition->disk = disk;
+        partition->firstBlock = entry.relativeOffsetPartitionSectors;
+        partition->partitionType = entry.partitionType;
+        partition->data = NULL;
+
+        if(blockDevice_register(partition) == 0){
+            g_partitionCount++;
+            partitionsFound++;
+        }
+    }
+    return partitionsFound;
+}
@@ -0,0 +1,87 @@
+/*
+ * blockDevice.h
+ *
+ *      Interface of storage devices which are accessed in fixed size blocks (SD card, RAM disk, partitions).
+ *      Devices are registered by name. Partitions found in the MBR of a disk are registered as devices of
+ *      their own ("sd0p1" for the first partition of "sd0"), which forward their transfers to the disk.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKDEVICE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKDEVICE_H_
+
+#include <inttypes.h>
+
+#define BLOCK_DEVICE_NAME_LENGTH 8
+
+// Number of registered devices, disks and partitions
+#define MAX_BLOCK_DEVICES 8
+
+// Number of entries of the MBR partition table
+#define MBR_PARTITION_ENTRIES 4
+
+#define BLOCK_DEVICE_REGISTER_FAILED (-1)
+
+// Entry of the MBR partition table
+typedef struct{
+    uint8_t isBootable;
+    uint8_t partitionStartCHS[3];
+    uint8_t partitionType;
+    uint8_t partitionEndCHS[3];
+    uint32_t relativeOffsetPartitionSectors;
+    uint32_t partitionSizeInSectors;
+}__attribute((packed)) PartitionTable_t;
+
+typedef struct BlockDevice BlockDevice_t;
+
+struct BlockDevice {
+    char name[BLOCK_DEVICE_NAME_LENGTH];
+
+    uint32_t blockSize;
+    // Capacity in blocks
+    uint32_t numberOfBlocks;
+    // Maximum number of blocks in one transfer, larger transfers are split by the caller
+    uint32_t queueDepth;
+
+    // Transfer count blocks starting at firstBlock. Return the number of blocks transferred.
+    uint32_t (*readBlocks)(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count);
+    uint32_t (*writeBlocks)(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count);
+
+    // Partitions: the disk the partition lies on, its first block on the disk and its MBR partition type.
+    // NULL and 0 for disks.
+    BlockDevice_t * disk;
+    uint32_t firstBlock;
+    uint8_t partitionType;
+
+    // Driver specific data, e.g. the memory of a RAM disk
+    void * data;
+};
+
+/*
+ * Adds a device to the list of devices. Returns 0 on success, or BLOCK_DEVICE_REGISTER_FAILED if the name is
+ * already used or the list is full.
+ */
+int blockDevice_register(BlockDevice_t * device);
+
+/*
+ * Returns the device with the given name, or NULL.
+ */
+BlockDevice_t * blockDevice_get(const char * name);
+
+/*
+ * Returns the device with the given index (in order of registration), or NULL. Used to iterate over all devices.
+ */
+BlockDevice_t * blockDevice_getByIndex(unsigned int index);
+
+/*
+ * Reads the MBR of the disk and registers each used partition as a device. Returns the number of partitions
+ * registered.
+ */
+unsigned int blockDevice_scanPartitions(BlockDevice_t * disk);
+
+/*
+ * Transfers count blocks, split into transfers of at most queueDepth blocks. Return the number of blocks transferred.
+ */
+uint32_t blockDevice_read(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count);
+uint32_t blockDevice_write(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_BLOCKDEVICE_H_ */
@@ -0,0 +1,180 @@
+/*
+ * dentryCache.c
+ *
+ *      Entries are chained into hash buckets. When the cache is full, the least recently used entry is reused.
+ */
+
+#include "dentryCache.h"
+#include "global/types.h"
+#include <string.h>
+
+#define MAX_CHAR_FILE_NAME 8
+#define MAX_CHAR_EXTENSION 3
+
+// Number of hash buckets, must be a power of two
+#define DENTRY_CACHE_BUCKETS 32
+
+// Marks the end of a bucket chain
+#define NO_ENTRY -1
+
+typedef struct {
+    const FatVolume_t * volume;
+    uint32_t directoryAddress;
+    uint8_t fileName[MAX_CHAR_FILE_NAME];
+    uint8_t extension[MAX_CHAR_EXTENSION];
+
+    uint8_t isUsed;
+
+    // Address (in bytes) of the directory entry, 0 if the name does not exist
+    uint32_t entryAddress;
+    Fat16Entry_t entry;
+
+    uint32_t lastUsed;
+
+    // Next entry in the same bucket
+    int16_t next;
+    uint16_t bucket;
+} DentryCacheEntry_t;
+
+static DentryCacheEntry_t g_entries[DENTRY_CACHE_ENTRIES];
+static int16_t g_buckets[DENTRY_CACHE_BUCKETS];
+
+// Incremented on every access, used for LRU eviction
+static uint32_t g_useCounter;
+
+static DentryCacheStatistics_t g_statistics;
+
+/*
+ * FNV-1a hash of the directory address and the name.
+ */
+static uint16_t hashName(uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension){
+    uint32_t hash = 2166136261u;
+    uint32_t i;
+    for(i = 0; i < sizeof(directoryAddress); i++){
+        hash = (hash ^ ((directoryAddress >> (8 * i)) & 0xFF)) * 16777619u;
+    }
+    for(i = 0; i < MAX_CHAR_FILE_NAME; i++){
+        hash = (hash ^ fileName[i]) * 16777619u;
+    }
+    for(i = 0; i < MAX_CHAR_EXTENSION; i++){
+        hash = (hash ^ extension[i]) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & (DENTRY_CACHE_BUCKETS - 1);
+}
+
+/*
+ * Returns the index of the entry for the name, or NO_ENTRY if the name is not cached.
+ */
+static int16_t findEntry(uint16_t bucket, const FatVolume_t * volume, uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension){
+    int16_t i = g_buckets[bucket];
+    while(i != NO_ENTRY){
+        DentryCacheEntry_t * cacheEntry = &g_entries[i];
+        if(cacheEntry->directoryAddress == directoryAddress && cacheEntry->volume == volume
+                && memcmp(cacheEntry->fileName, fileName, MAX_CHAR_FILE_NAME) == 0
+                && memcmp(cacheEntry->extension, extension, MAX_CHAR_EXTENSION) == 0){
+            return i;
+        }
+        i = cacheEntry->next;
+    }
+    return NO_ENTRY;
+}
+
+/*
+ * Removes an entry from its bucket chain.
+ */
+static void unlinkEntry(int16_t index){
+    int16_t * link = &g_buckets[g_entries[index].bucket];
+    while(*link != index){
+        link = &g_entries[*link].next;
+    }
+    *link = g_entries[index].next;
+    g_entries[index].isUsed = FALSE;
+}
+
+/*
+ * Returns a free entry, or evicts the least recently used one.
+ */
+static int16_t allocateEntry(void){
+    int16_t victim = 0;
+    int16_t i;
+    for(i = 0; i < DENTRY_CACHE_ENTRIES; i++){
+        if(!g_entries[i].isUsed){
+            return i;
+        }
+        if(g_entries[i].lastUsed < g_entries[victim].lastUsed){
+            victim = i;
+        }
+    }
+
+    unlinkEntry(victim);
+    return victim;
+}
+
+void dentryCache_invalidate(void){
+    uint32_t i;
+    for(i = 0; i < DENTRY_CACHE_BUCKETS; i++){
+        g_buckets[i] = NO_ENTRY;
+    }
+    for(i = 0; i < DENTRY_CACHE_ENTRIES; i++){
+        g_entries[i].isUsed = FALSE;
+    }
+}
+
+uint8_t dentryCache_lookup(const FatVolume_t * volume, uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension,
+                           uint32_t * entryAddress, Fat16Entry_t * entry){
+    int16_t i = findEntry(hashName(directoryAddress, fileName, extension), volume, directoryAddress, fileName, extension);
+    if(i == NO_ENTRY){
+        g_statistics.misses++;
+        return 0;
+    }
+
+    DentryCacheEntry_t * cacheEntry = &g_entries[i];
+    cacheEntry->lastUsed = ++g_useCounter;
+    *entryAddress = cacheEntry->entryAddress;
+    if(cacheEntry->entryAddress != 0){
+        memcpy(entry, &cacheEntry->entry, sizeof(Fat16Entry_t));
+        g_statistics.hits++;
+    } else {
+        g_statistics.negativeHits++;
+    }
+    return 1;
+}
+
+void dentryCache_insert(const FatVolume_t * volume, uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension,
+                        uint32_t entryAddress, const Fat16Entry_t * entry){
+    uint16_t bucket = hashName(directoryAddress, fileName, extension);
+    int16_t i = findEntry(bucket, volume, directoryAddress, fileName, extension);
+    if(i == NO_ENTRY){
+        i = allocateEntry();
+        DentryCacheEntry_t * cacheEntry = &g_entries[i];
+        cacheEntry->volume = volume;
+        cacheEntry->directoryAddress = directoryAddress;
+        memcpy(cacheEntry->fileName, fileName, MAX_CHAR_FILE_NAME);
+        memcpy(cacheEntry->extension, extension, MAX_CHAR_EXTENSION);
+        cacheEntry->isUsed = TRUE;
+        cacheEntry->bucket = bucket;
+        cacheEntry->next = g_buckets[bucket];
+        g_buckets[bucket] = i;
+    }
+
+    DentryCacheEntry_t * cacheEntry = &g_entries[i];
+    cacheEntry->entryAddress = entryAddress;
+    if(entry != NULL){
+        memcpy(&cacheEntry->entry, entry, sizeof(Fat16Entry_t));
+    }
+    cacheEntry->lastUsed = ++g_useCounter;
+}
+
+void dentryCache_update(const FatVolume_t * volume, uint32_t entryAddress, const Fat16Entry_t * entry){
+    uint32_t i;
+    for(i = 0; i < DENTRY_CACHE_ENTRIES; i++){
+        if(g_entries[i].isUsed && g_entries[i].entryAddress == entryAddress && g_entries[i].volume == volume){
+            memcpy(&g_entries[i].entry, entry, sizeof(Fat16Entry_t));
+            return;
+        }
+    }
+}
+
+void dentryCache_getStatistics(DentryCacheStatistics_t * statistics){
+    memcpy(statistics, &g_statistics, sizeof(DentryCacheStatistics_t));
+}
@@ -0,0 +1,56 @@
+/*
+ * dentryCache.h
+ *
+ *      Cache of FAT directory entries, keyed by the volume, the directory containing the entry and the 8.3 name.
+ *      Lookups of names which do not exist are cached as well (negative entries), so that probing for
+ *      missing files does not scan the directory again.
+ *      The FAT layer keeps the cache consistent: created entries replace negative ones and modified
+ *      entries (size, first cluster) are updated in place when they are written back.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_DENTRYCACHE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_DENTRYCACHE_H_
+
+#include <inttypes.h>
+#include "fileSystem.h"
+
+// Number of cached directory entries
+#define DENTRY_CACHE_ENTRIES 64
+
+typedef struct {
+    // Lookups answered by a cached entry / by a cached negative entry
+    uint32_t hits;
+    uint32_t negativeHits;
+
+    // Lookups which needed a directory scan
+    uint32_t misses;
+} DentryCacheStatistics_t;
+
+/*
+ * Drops all cached entries.
+ */
+void dentryCache_invalidate(void);
+
+/*
+ * Looks up the entry fileName/extension (padded with spaces) in the directory at directoryAddress of the volume.
+ * Returns 1 if the name is cached, 0 otherwise. If cached, *entryAddress is set to the address (in bytes)
+ * of the directory entry and the entry is copied, or *entryAddress is set to 0 if the name does not exist.
+ */
+uint8_t dentryCache_lookup(const FatVolume_t * volume, uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension,
+                           uint32_t * entryAddress, Fat16Entry_t * entry);
+
+/*
+ * Caches the result of a directory scan. entryAddress 0 (entry NULL) records that the name does not exist.
+ * An existing entry for the same name is replaced.
+ */
+void dentryCache_insert(const FatVolume_t * volume, uint32_t directoryAddress, const uint8_t * fileName, const uint8_t * extension,
+                        uint32_t entryAddress, const Fat16Entry_t * entry);
+
+/*
+ * Updates the cached copy of the directory entry at entryAddress after it has been modified.
+ */
+void dentryCache_update(const FatVolume_t * volume, uint32_t entryAddress, const Fat16Entry_t * entry);
+
+void dentryCache_getStatistics(DentryCacheStatistics_t * statistics);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_DENTRYCACHE_H_ */
@@ -3,12 +3,12 @@
 #include "deviceDrivers/uartDriver.h"
 #include "deviceDrivers/dmxDriver.h"
 #include "deviceDrivers/gpioDriver.h"
+#include "deviceDrivers/blockCacheDriver.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
 
-#define DEVICES_FOLDER "/dev/"
-#define MAX_DEVICES (10)
+#define MAX_DEVICES (16)
 #define MAX_DEVICE_NAME (10)
 
 typedef struct {
@@ -19,16 +19,14 @@ typedef struct {
 Device_t devices[MAX_DEVICES];
 unsigned int deviceCount;
 
-int devFs_open(const char* fileName) {
-    if (strncmp(fileName, DEVICES_FOLDER, strlen(DEVICES_FOLDER)) == 0) {
-        int i;
-        for (i = 0; i < deviceCount; ++i) {
-            Device_t device = devices[i];
-            const char* searchedName = fileName + strlen(DEVICES_FOLDER);
-            if (strcmp(device.name, searchedName) == 0) {
-                device.fileOperations->open();
-                return i;
-            }
+int devFs_open(void* mountData, const char* fileName, int flags) {
+    // fileName is relative to the mount point, e.g. "/uart3"
+    const char* searchedName = fileName + 1;
+    int i;
+    for (i = 0; i < deviceCount; ++i) {
+        if (strcmp(devices[i].name, searchedName) == 0) {
+            int result = devices[i].fileOperations->open();
+            return result < 0 ? result : i;
         }
     }
     return FILE_NOT_FOUND;
@@ -42,8 +40,26 @@ int devFs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
     return devices[fileDescriptor].fileOperations->read(buffer, bufferSize);
 }
 
-void devFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+int devFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
     devices[fileDescriptor].fileOperations->write(buffer, bufferSize);
+    return bufferSize;
+}
+
+int devFs_ioctl(int fileDescriptor, unsigned int request, void* argument) {
+    FileOperations_t* fileOperations = devices[fileDescriptor].fileOperations;
+    if (fileOperations->ioctl == NULL) {
+        return UNKNOWN_REQUEST;
+    }
+    return fileOperations->ioctl(request, argument);
+}
+
+int devFs_lseek(int fileDescriptor, int offset, int origin) {
+    // Devices are streams
+    return FILE_NOT_SEEKABLE;
+}
+
+int devFs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    return FILE_NOT_SEEKABLE;
 }
 
 void devFs_addDevice(const char* name, FileOperations_t* fileOperations) {
@@ -53,38 +69,80 @@ void devFs_addDevice(const char* name, FileOperations_t* fileOperations) {
     devices[deviceCount++] = dev;
 }
 
-const char* devFs_readdir(const char* dirName) {
-    static char previousDir[100];
-    static int successiveCall;
-    if (strcmp(previousDir, dirName) != 0) {
-        strcpy(previousDir, dirName);
-        successiveCall = 0;
+int devFs_opendir(void* mountData, const char* dirName) {
+    // All devices are in the mount point directory
+    return strcmp(dirName, "/") == 0 ? 0 : FILE_NOT_FOUND;
+}
+
+int devFs_getdents(int directory, uint32_t* position, DirectoryEntry_t* entries, unsigned int count) {
+    // The position is the index of the next device
+    int entriesRead = 0;
+    while (entriesRead < count && *position < deviceCount) {
+        DirectoryEntry_t* entry = &entries[entriesRead++];
+        strcpy(entry->name, devices[*position].name);
+        entry->type = DIRECTORY_ENTRY_DEVICE;
+        entry->size = 0;
+        *position += 1;
     }
+    return entriesRead;
+}
+
+void devFs_closedir(int directory) {
+    // NO OP
+}
 
-    const char* result;
-    if (strcmp("/", dirName) == 0) {
-        result = successiveCall == 0 ? "dev" : NULL;
-    } else if (strcmp(DEVICES_FOLDER, dirName) == 0) {
-        result = successiveCall < deviceCount ? devices[successiveCall].name : NULL;
-    } else {
-        result = NULL;
+int devFs_stat(void* mountData, const char* fileName, FileStatus_t* status) {
+    memset(status, 0, sizeof(FileStatus_t));
+    if (strcmp(fileName, "/") == 0) {
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        return 0;
     }
-    if (result) {
-        successiveCall += 1;
-    } else {
-        previousDir[0] = '\0';
+
+    int i;
+    for (i = 0; i < deviceCount; ++i) {
+        if (strcmp(devices[i].name, fileName + 1) == 0) {
+            status->type = DIRECTORY_ENTRY_DEVICE;
+            return 0;
+        }
     }
-    return result;
+    return FILE_NOT_FOUND;
+}
+
+int devFs_fstat(int fileDescriptor, FileStatus_t* status) {
+    // Devices have neither a size nor a modification time
+    memset(status, 0, sizeof(FileStatus_t));
+    status->type = DIRECTORY_ENTRY_DEVICE;
+    return 0;
 }
 
+int devFs_unlink(void* mountData, const char* fileName) {
+    // Devices cannot be removed
+    FileStatus_t status;
+    return devFs_stat(mountData, fileName, &status) == 0 ? OPERATION_NOT_SUPPORTED : FILE_NOT_FOUND;
+}
+
+void devFs_sync() {
+    // Devices are not cached, but may still be sending written data
+    int i;
+    for (i = 0; i < deviceCount; ++i) {
+        if (devices[i].fileOperations->flush != NULL) {
+            devices[i].fileOperations->flush();
+        }
+    }
+}
 
 void devFs_init() {
     devFs_addDevice("uart1", &devUart1);
     devFs_addDevice("uart2", &devUart2);
     devFs_addDevice("uart3", &devUart3);
-    devFs_addDevice("dmx", &dmxDriver);
+    // "dmx" is the first universe, as before there were several
+    devFs_addDevice("dmx", &dmxDriver0);
+    devFs_addDevice("dmx0", &dmxDriver0);
+    devFs_addDevice("dmx1", &dmxDriver1);
+    devFs_addDevice("dmx2", &dmxDriver2);
     devFs_addDevice("led1", &led1Driver);
     devFs_addDevice("led2", &led2Driver);
+    devFs_addDevice("bcache", &blockCacheDriver);
 }
 
 FileSystem_t deviceDriverFs = {
@@ -92,6 +150,15 @@ FileSystem_t deviceDriverFs = {
         .open = devFs_open,
         .read = devFs_read,
         .write = devFs_write,
-        .readdir = devFs_readdir,
+        .lseek = devFs_lseek,
+        .pread = devFs_pread,
+        .opendir = devFs_opendir,
+        .getdents = devFs_getdents,
+        .closedir = devFs_closedir,
+        .stat = devFs_stat,
+        .fstat = devFs_fstat,
+        .unlink = devFs_unlink,
+        .sync = devFs_sync,
+        .ioctl = devFs_ioctl,
         .init = devFs_init
 };
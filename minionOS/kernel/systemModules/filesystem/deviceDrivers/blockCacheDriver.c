@@ -0,0 +1,63 @@
+#include <kernel/systemModules/filesystem/deviceDrivers/blockCacheDriver.h>
+#include "kernel/systemModules/filesystem/blockCache.h"
+#include "kernel/systemModules/filesystem/dentryCache.h"
+#include "kernel/systemModules/filesystem/pageCache.h"
+#include "global/types.h"
+#include <stdio.h>
+#include <string.h>
+
+// The statistics are returned by the first read after opening the device, further reads return 0 (EOF)
+static uint8_t g_statisticsRead;
+
+static int open(void) {
+    g_statisticsRead = FALSE;
+    return 0;
+}
+
+static int read(uint8_t* buffer, unsigned int bufferSize) {
+    if (g_statisticsRead) {
+        return 0;
+    }
+
+    BlockCacheStatistics_t statistics;
+    blockCache_getStatistics(&statistics);
+
+    DentryCacheStatistics_t dentryStatistics;
+    dentryCache_getStatistics(&dentryStatistics);
+
+    PageCacheStatistics_t pageStatistics;
+    pageCache_getStatistics(&pageStatistics);
+
+    char text[400];
+    int length = sprintf(text, "hits %u\nmisses %u\nprefetched %u\nprefetch hits %u\nprefetch wasted %u\n"
+                         "sectors written %u\nwrite transfers %u\n"
+                         "dentry hits %u\ndentry negative hits %u\ndentry misses %u\n"
+                         "page hits %u\npage misses %u\npage evictions %u\n",
+                         statistics.hits, statistics.misses, statistics.prefetched,
+                         statistics.prefetchHits, statistics.prefetchWasted,
+                         statistics.sectorsWritten, statistics.writeTransfers,
+                         dentryStatistics.hits, dentryStatistics.negativeHits, dentryStatistics.misses,
+                         pageStatistics.hits, pageStatistics.misses, pageStatistics.evictions);
+    if (length > bufferSize) {
+        length = bufferSize;
+    }
+    memcpy(buffer, text, length);
+
+    g_statisticsRead = TRUE;
+    return length;
+}
+
+static void write(const uint8_t* buffer, unsigned int bufferSize) {
+    // NO OP
+}
+
+static void release(void) {
+    // NO OP
+}
+
+FileOperations_t blockCacheDriver = {
+        .open = open,
+        .read = read,
+        .write = write,
+        .release = release
+};
@@ -0,0 +1,8 @@
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_DEVICEDRIVERS_BLOCKCACHEDRIVER_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_DEVICEDRIVERS_BLOCKCACHEDRIVER_H_
+
+#include "../deviceDrivers/fileOperations.h"
+
+extern FileOperations_t blockCacheDriver;
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_DEVICEDRIVERS_BLOCKCACHEDRIVER_H_ */
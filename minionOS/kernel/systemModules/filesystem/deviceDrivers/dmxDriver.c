@@ -1,90 +1,128 @@
 #include <kernel/systemModules/filesystem/deviceDrivers/dmxDriver.h>
-#include "kernel/hal/uart/uart.h"
-#include "kernel/hal/gpio/gpio.h"
-#include "kernel/devices/omap3530/includes/gpio.h"
-#include "kernel/common/mmio.h"
-#include "delay/delay.h"
-#include "global/types.h"
+#include "kernel/hal/dmx/dmx.h"
+#include "kernel/systemModules/showPlayer/showPlayer.h"
+#include "kernel/systemModules/filesystem/vfs.h"
+#include "dmxControl.h"
+#include "stdio.h"
+#include <stdbool.h>
 
+#define DMX_CONF    "/ETC/DMX/DMX.CFG"
 
-// DMX pins
-#define DMX_DI_PIN      6    // DI Driver Input of ST485
-#define DMX_DE_PIN      8    // DE Driver Output Enable of ST485
-#define DMX_CHANNELS    25   // 1 StartCode, 11 Channels
+// The DMX engine sends universe 0 in the background from boot on, the others from the first open of their
+// device. The devices only replace the content of their universe.
 
-// Pad configuration addresses
-#define PADCONF_BASE                0x48002030
-#define CONTROL_PADCONF_UART2_TX    0x48002178
-#define CONTROL_PADCONF_UART2_CTS   0x48002174
+// The configuration is read at the first open only, later opens keep a rate set by DMX_CONTROL_SET_REFRESH_RATE
+static bool isConfigLoaded;
 
-typedef enum {
-    UART, GPIO
-} GpioMode_t;
-
-typedef enum {
-    Mode0 = 0x00,
-    Mode1 = 0x01,
-    Mode2 = 0x02,
-    Mode3 = 0x03,
-    Mode4 = 0x04,
-    Mode5 = 0x05,
-    Mode6 = 0x06,
-    Mode7 = 0x07,
-} MuxMode_t;
-
-static UartConfig_t config = { .baudMultiple = x16, .baudRate = 250000,
-                               .stopMode = STOP_1_5, .parityMode = NO_PARITY,
-                               .wordLength = LENGTH_8 };
-
-static void pad_setMode(GpioMode_t mode) {
-    switch (mode) {
-    case UART:
-        set32(CONTROL_PADCONF_UART2_TX, Mode0 << 0);
-        set32(CONTROL_PADCONF_UART2_CTS, Mode0 << 16);
-        break;
-    case GPIO:
-        set32(CONTROL_PADCONF_UART2_TX, Mode4 << 0);
-        set32(CONTROL_PADCONF_UART2_CTS, Mode4 << 16);
-        break;
+static void loadConfig(void) {
+    isConfigLoaded = true;
+    int file = vfs_open(DMX_CONF, OPEN_READ);
+    if (isValidFile(file)) {
+        char buf[20] = {};
+        vfs_read(file, (uint8_t*) buf, sizeof(buf) - 1);
+        /* refreshRate  *
+         * 1-43         */
+        unsigned int refreshRate = DMX_DEFAULT_REFRESH_RATE;
+        sscanf(buf, "%u", &refreshRate);
+        dmx_setRefreshRate(refreshRate);
+        vfs_close(file);
     }
 }
 
-static void open(void) {
-    pad_setMode(UART);
-    uart_initModule(UART2, config);
-    uart_updateConfig(UART2, config);
-    gpio_pinMode(146, OUTPUT);
+static int open(uint8_t universe) {
+    if (dmx_start(universe) != 0) {
+        return DEVICE_BUSY;
+    }
+    if (!isConfigLoaded) {
+        loadConfig();
+    }
+    return 0;
 }
 
 static int read(uint8_t* buffer, unsigned int bufferSize) {
     // NO OP
+    return 0;
+}
+
+static void write(uint8_t universe, const uint8_t* buffer, unsigned int bufferSize) {
+    dmx_write(universe, buffer, bufferSize > DMX_UNIVERSE_SIZE ? DMX_UNIVERSE_SIZE : bufferSize);
+}
+
+static void release(void) {
+    // NO OP
 }
 
-static void write(const uint8_t* buffer, unsigned int bufferSize) {
-    // Reset
-    pad_setMode(GPIO);
-    gpio_digitalWrite(146, LOW);
-    delay(1000);
+static int ioctl(uint8_t universe, unsigned int request, void* argument) {
+    switch (request) {
+    case DMX_CONTROL_PATCH: {
+        const DmxPatch_t* patch = (const DmxPatch_t*) argument;
+        if (patch == NULL || patch->data == NULL) {
+            return DMX_INVALID_PATCH;
+        }
+        return dmx_patch(universe, patch->startSlot, patch->data, patch->length) == 0 ? 0 : DMX_INVALID_PATCH;
+    }
+    case DMX_CONTROL_SET_REFRESH_RATE:
+        if (argument == NULL) {
+            return UNKNOWN_REQUEST;
+        }
+        dmx_setRefreshRate(*(const unsigned int*) argument);
+        return 0;
+    case DMX_CONTROL_FADE: {
+        const DmxFade_t* fade = (const DmxFade_t*) argument;
+        if (fade == NULL || fade->targets == NULL) {
+            return DMX_INVALID_PATCH;
+        }
+        return dmx_fade(universe, fade->startSlot, fade->targets, fade->length, fade->durationMs, fade->curve) == 0
+                ? 0 : DMX_INVALID_PATCH;
+    }
+    case DMX_CONTROL_PLAY_SHOW:
+        if (argument == NULL) {
+            return DMX_INVALID_SHOW;
+        }
+        return showPlayer_play(universe, (const char*) argument);
+    case DMX_CONTROL_STOP_SHOW:
+        showPlayer_stop(universe);
+        return 0;
+    case DMX_CONTROL_GET_STATISTICS:
+        if (argument == NULL) {
+            return UNKNOWN_REQUEST;
+        }
+        dmx_getStatistics(universe, (DmxStatistics_t*) argument);
+        return 0;
+    }
+    return UNKNOWN_REQUEST;
+}
 
-    // Mark
-    gpio_digitalWrite(146, HIGH);
-    delay(500);
-    gpio_digitalWrite(146, LOW);
+static int open0() {
+    return open(0);
+}
+static void write0(const uint8_t* buffer, unsigned int bufferSize) {
+    write(0, buffer, bufferSize);
+}
+static int ioctl0(unsigned int request, void* argument) {
+    return ioctl(0, request, argument);
+}
 
-    // Send data
-    pad_setMode(UART);
-    //uart_updateConfig(UART2, config);
-    uart_transmit(UART2, buffer, bufferSize);
+static int open1() {
+    return open(1);
+}
+static void write1(const uint8_t* buffer, unsigned int bufferSize) {
+    write(1, buffer, bufferSize);
+}
+static int ioctl1(unsigned int request, void* argument) {
+    return ioctl(1, request, argument);
+}
 
-    delay(200);
+static int open2() {
+    return open(2);
 }
-static void release(void) {
-    // NO OP
+static void write2(const uint8_t* buffer, unsigned int bufferSize) {
+    write(2, buffer, bufferSize);
+}
+static int ioctl2(unsigned int request, void* argument) {
+    return ioctl(2, request, argument);
 }
 
-FileOperations_t dmxDriver = {
-        .open = open,
-        .read = read,
-        .write = write,
-        .release = release
-};
+FileOperations_t dmxDriver0 = { .open = open0, .read = read, .write = write0, .release = release, .ioctl = ioctl0 };
+FileOperations_t dmxDriver1 = { .open = open1, .read = read, .write = write1, .release = release, .ioctl = ioctl1 };
+FileOperations_t dmxDriver2 = { .open = open2, .read = read, .write = write2, .release = release, .ioctl = ioctl2 };
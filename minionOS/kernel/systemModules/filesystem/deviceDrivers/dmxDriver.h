@@ -3,6 +3,9 @@
 
 #include "../deviceDrivers/fileOperations.h"
 
-extern FileOperations_t dmxDriver;
+// Universes 0...2 (UART2, UART1, UART3), see dmx.h
+extern FileOperations_t dmxDriver0;
+extern FileOperations_t dmxDriver1;
+extern FileOperations_t dmxDriver2;
 
 #endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_DEVICEDRIVERS_DMXDRIVER_H_ */
@@ -6,8 +6,15 @@
 typedef struct {
     int (*read)(uint8_t* buffer, unsigned int bufferSize);
     void (*write)(const uint8_t* buffer, unsigned int bufferSize);
-    void (*open)(void);
+    // Returns 0, or a negative error (e.g. DEVICE_BUSY) which is the result of the open
+    int (*open)(void);
     void (*release)(void);
+
+    // Optional, waits until written data has left the device
+    void (*flush)(void);
+
+    // Optional, device specific requests (see vfs_ioctl)
+    int (*ioctl)(unsigned int request, void* argument);
 } FileOperations_t;
 
 #endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_FILEOPERATIONS_H_ */
@@ -5,7 +5,8 @@
 #include "global/types.h"
 #include <string.h>
 
-static void open(void) {
+static int open(void) {
+    return 0;
 }
 
 static int read(uint8_t* buffer, unsigned int bufferSize) {
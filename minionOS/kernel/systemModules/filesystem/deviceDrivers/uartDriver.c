@@ -1,66 +1,246 @@
 #include <kernel/systemModules/filesystem/deviceDrivers/uartDriver.h>
 #include "kernel/hal/uart/uart.h"
 #include "kernel/systemModules/filesystem/vfs.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
+#include "kernel/systemModules/systemCalls/dispatcher.h"
+#include "kernel/systemModules/tty/tty.h"
+#include "uartControl.h"
 #include "stdio.h"
+#include <string.h>
 
 #define UART1_CONF  "/ETC/UART/UART1.CFG"
 #define UART2_CONF  "/ETC/UART/UART2.CFG"
 #define UART3_CONF  "/ETC/UART/UART3.CFG"
 
-static void open(UartModule_t module, const char* configFile) {
-    int file = vfs_open(configFile);
+static const char* configFiles[3] = { UART1_CONF, UART2_CONF, UART3_CONF };
+
+// Configuration per module, read from its file on the first open only. A module without configuration file
+// is left as it is.
+static UartSettings_t settings[3];
+static bool hasSettings[3];
+static bool isSettingsLoaded[3];
+
+// Configuration the module has been programmed with, it is programmed again only if settings differ or
+// another driver has configured the module since
+static UartSettings_t programmedSettings[3];
+static bool isProgrammed[3];
+static uint32_t programmedConfigCounts[3];
+
+// Open files per module, the module is owned (uart_claim) while there are any
+static unsigned int openCounts[3];
+
+// Process waiting for input per module, 0 if none (the idle process never reads)
+static ProcessId_t waitingReaders[3];
+
+static void wakeReader(UartModule_t module) {
+    if (waitingReaders[module] != 0) {
+        scheduler_unblockProcess(waitingReaders[module]);
+        waitingReaders[module] = 0;
+    }
+}
+
+// The console passes its input through the line discipline, which wakes its reader itself
+static const UartReceiveCallback_t receiveCallbacks[3] = { wakeReader, wakeReader, tty_handleReceive };
+
+static void loadSettings(UartModule_t module) {
+    isSettingsLoaded[module] = true;
+    hasSettings[module] = false;
+    int file = vfs_open(configFiles[module], OPEN_READ);
     if (isValidFile(file)) {
         char buf[100] = {};
-        vfs_read(file, (uint8_t*) buf, sizeof(buf));
-        UartConfig_t config;
-        /* parity  stop  wordL baud  baudM  *
-         * 0-4     0-1   0-3   0-xxx 0-1    */
+        vfs_read(file, (uint8_t*) buf, sizeof(buf) - 1);
+        /* parity  stop  wordL baud  baudM  rxTrigger         *
+         * 0-4     0-1   0-3   0-xxx 0-1    0-63 (optional)   */
         unsigned int parityMode, stopMode, wordLength, baudRate, baudMultiple;
-        sscanf(buf, "%u %u %u %u %u", &parityMode, &stopMode, &wordLength, &baudRate, &baudMultiple);
-        config.parityMode = (UartParityMode_t) parityMode;
-        config.stopMode = (UartStopMode_t) stopMode;
-        config.wordLength = (UartWordLength_t) wordLength;
-        config.baudRate = baudRate;
-        config.baudMultiple = (UartBaudMultiple_t) baudMultiple;
-        uart_initModule(module, config);
+        unsigned int rxTriggerLevel = UART_RX_TRIGGER_LEVEL_DEFAULT;
+        sscanf(buf, "%u %u %u %u %u %u", &parityMode, &stopMode, &wordLength, &baudRate, &baudMultiple, &rxTriggerLevel);
+        UartSettings_t* moduleSettings = &settings[module];
+        moduleSettings->parityMode = parityMode;
+        moduleSettings->stopMode = stopMode;
+        moduleSettings->wordLength = wordLength;
+        moduleSettings->baudRate = baudRate;
+        moduleSettings->baudMultiple = baudMultiple;
+        moduleSettings->rxTriggerLevel = rxTriggerLevel;
+        hasSettings[module] = true;
         vfs_close(file);
     }
 }
 
-static void open1() {
-    open(UART1, UART1_CONF);
+static bool isValid(const UartSettings_t* newSettings) {
+    return newSettings->parityMode <= FORCED_0 && newSettings->stopMode <= STOP_1_5
+            && newSettings->wordLength <= LENGTH_8 && newSettings->baudRate > 0 && newSettings->baudMultiple <= x13
+            && newSettings->rxTriggerLevel <= UART_RX_TRIGGER_LEVEL_MAX;
+}
+
+/*
+ * Programs the module with its settings if they differ from the programmed ones. A change of the protocol or
+ * baud rate only is applied without resetting the module, so received bytes are kept.
+ */
+static void applySettings(UartModule_t module) {
+    if (!hasSettings[module]) {
+        return;
+    }
+    const UartSettings_t* moduleSettings = &settings[module];
+    UartSettings_t* programmed = &programmedSettings[module];
+    if (isProgrammed[module] && uart_getConfigCount(module) != programmedConfigCounts[module]) {
+        isProgrammed[module] = false;
+    }
+    if (isProgrammed[module] && memcmp(moduleSettings, programmed, sizeof(UartSettings_t)) == 0) {
+        return;
+    }
+
+    UartConfig_t config;
+    config.parityMode = (UartParityMode_t) moduleSettings->parityMode;
+    config.stopMode = (UartStopMode_t) moduleSettings->stopMode;
+    config.wordLength = (UartWordLength_t) moduleSettings->wordLength;
+    config.baudRate = moduleSettings->baudRate;
+    config.baudMultiple = (UartBaudMultiple_t) moduleSettings->baudMultiple;
+    config.rxTriggerLevel = moduleSettings->rxTriggerLevel;
+
+    if (isProgrammed[module] && moduleSettings->rxTriggerLevel == programmed->rxTriggerLevel) {
+        // Pending output is sent with the old settings
+        uart_flush(module);
+        uart_updateConfig(module, config);
+    } else {
+        uart_setReceiveCallback(module, receiveCallbacks[module]);
+        uart_initModule(module, config);
+    }
+    *programmed = *moduleSettings;
+    isProgrammed[module] = true;
+    programmedConfigCounts[module] = uart_getConfigCount(module);
+}
+
+static int open(UartModule_t module) {
+    if (!uart_claim(module, UART_OWNER_DEVICE)) {
+        // e.g. sending a DMX universe
+        return DEVICE_BUSY;
+    }
+    openCounts[module]++;
+    if (!isSettingsLoaded[module]) {
+        loadSettings(module);
+    }
+    applySettings(module);
+    return 0;
+}
+
+static void release(UartModule_t module) {
+    if (openCounts[module] > 0 && --openCounts[module] == 0) {
+        uart_release(module, UART_OWNER_DEVICE);
+    }
+}
+
+static int ioctl(UartModule_t module, unsigned int request, void* argument) {
+    switch (request) {
+    case UART_CONTROL_CONFIGURE: {
+        const UartSettings_t* newSettings = (const UartSettings_t*) argument;
+        if (newSettings == NULL || !isValid(newSettings)) {
+            return UART_INVALID_CONFIG;
+        }
+        // Replaces the settings of the file until they are reloaded
+        settings[module] = *newSettings;
+        hasSettings[module] = true;
+        isSettingsLoaded[module] = true;
+        applySettings(module);
+        return 0;
+    }
+    case UART_CONTROL_GET_CONFIG:
+        if (argument == NULL || !hasSettings[module]) {
+            return UART_INVALID_CONFIG;
+        }
+        *(UartSettings_t*) argument = settings[module];
+        return 0;
+    case UART_CONTROL_RELOAD_CONFIG:
+        loadSettings(module);
+        applySettings(module);
+        return hasSettings[module] ? 0 : UART_INVALID_CONFIG;
+    }
+    return UNKNOWN_REQUEST;
+}
+
+/*
+ * Returns the bytes received so far. If there are none, a process reading with a system call is blocked
+ * until the receive interrupt brings new bytes: read returns 0 as before, but the process is not scheduled
+ * again until there is something to read.
+ */
+static int receive(UartModule_t module, uint8_t* buffer, unsigned int bufferSize) {
+    int bytesRead = uart_receive(module, buffer, bufferSize);
+    PCB_t* reader = dispatcher_getCallingProcess();
+    if (bytesRead > 0 || bufferSize == 0 || reader == NULL || !uart_isReceiveInterruptEnabled(module)) {
+        return bytesRead;
+    }
+
+    // Only one reader waits per module, others keep polling
+    ProcessId_t waitingReader = waitingReaders[module];
+    if (waitingReader == 0 || waitingReader == reader->processId
+            || scheduler_getProcess(waitingReader)->status != BLOCKED) {
+        waitingReaders[module] = reader->processId;
+        scheduler_blockProcess(reader->processId);
+        scheduler_yield();
+    }
+    return bytesRead;
+}
+
+static int open1() {
+    return open(UART1);
+}
+static void release1() {
+    release(UART1);
 }
 static int read1(uint8_t* buffer, unsigned int bufferSize) {
-    return uart_receive(UART1, buffer, bufferSize);
+    return receive(UART1, buffer, bufferSize);
 }
 static void write1(const uint8_t* buffer, unsigned int bufferSize) {
     uart_transmit(UART1, buffer, bufferSize);
 }
+static void flush1() {
+    uart_flush(UART1);
+}
+static int ioctl1(unsigned int request, void* argument) {
+    return ioctl(UART1, request, argument);
+}
 
-static void open2() {
-    open(UART2, UART2_CONF);
+static int open2() {
+    return open(UART2);
+}
+static void release2() {
+    release(UART2);
 }
 static int read2(uint8_t* buffer, unsigned int bufferSize) {
-    return uart_receive(UART2, buffer, bufferSize);
+    return receive(UART2, buffer, bufferSize);
 }
 static void write2(const uint8_t* buffer, unsigned int bufferSize) {
     uart_transmit(UART2, buffer, bufferSize);
 }
+static void flush2() {
+    uart_flush(UART2);
+}
+static int ioctl2(unsigned int request, void* argument) {
+    return ioctl(UART2, request, argument);
+}
 
-static void open3() {
-    open(UART3, UART3_CONF);
+static int open3() {
+    return open(UART3);
+}
+static void release3() {
+    release(UART3);
 }
 static int read3(uint8_t* buffer, unsigned int bufferSize) {
-    return uart_receive(UART3, buffer, bufferSize);
+    return tty_read(buffer, bufferSize);
 }
 static void write3(const uint8_t* buffer, unsigned int bufferSize) {
     uart_transmit(UART3, buffer, bufferSize);
 }
-
-static void release() {
-    // no op
+static void flush3() {
+    uart_flush(UART3);
+}
+static int ioctl3(unsigned int request, void* argument) {
+    int result = tty_control(request, argument);
+    return result != UNKNOWN_REQUEST ? result : ioctl(UART3, request, argument);
 }
 
-FileOperations_t devUart1 = { .read = read1, .write = write1, .open = open1, .release = release };
-FileOperations_t devUart2 = { .read = read2, .write = write2, .open = open2, .release = release };
-FileOperations_t devUart3 = { .read = read3, .write = write3, .open = open3, .release = release };
+FileOperations_t devUart1 = { .read = read1, .write = write1, .open = open1, .release = release1, .flush = flush1,
+                              .ioctl = ioctl1 };
+FileOperations_t devUart2 = { .read = read2, .write = write2, .open = open2, .release = release2, .flush = flush2,
+                              .ioctl = ioctl2 };
+FileOperations_t devUart3 = { .read = read3, .write = write3, .open = open3, .release = release3, .flush = flush3,
+                              .ioctl = ioctl3 };
@@ -6,9 +6,13 @@
  */
 
 #include "fileSystem.h"
-#include "abstractStorage.h"
+#include "blockCache.h"
+#include "dentryCache.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "openFlags.h"
 
 #include <string.h>
+#include <stdio.h>
 
 #define PATH_DELIMITER '/'
 
@@ -19,63 +23,202 @@
 // File types
 #define FAT16_DIRECTORY_ENTRY 0x10
 #define FAT16_ARCHIVE_ENTRY   0x20
+// Set for volume labels and long file name entries
+#define FAT16_VOLUME_LABEL_ENTRY 0x08
 
 // This is used to filter filenames which start with that weird character
 #define FAT16_UNDEFINED_FILENAME_START_CHAR 0xE5
 
+// A directory entry starting with this character marks the end of the directory
+#define FAT16_END_OF_DIRECTORY_CHAR 0x00
+
 // Cluster defines
 #define INVALID_CLUSTER 0 // Cluster 0 and 1 are invalid
 
 #define STORAGE_SECTOR_SIZE 512
-#define PARTITION_TABLE_OFFSET 0x1BE
 
-#define PARTITION_SECTOR_SIGNATURE 0xAA55 // inverted byte order
+#define BOOT_SECTOR_SIGNATURE 0xAA55 // inverted byte order
+
+// Must not be greater than 255. File descriptors are shared by all volumes.
+#define MAX_NUMBER_FILE_DESCRIPTORS 32
+
+// Marks the sector buffer of a file descriptor as empty
+#define INVALID_SECTOR_ADDRESS 0xFFFFFFFF
+
+// End of cluster chain marker (values >= 0x0FFFFFF8). FAT16 entries (>= 0xFFF8) are extended to these values
+// when they are read, so that cluster chains of both FAT types are handled the same way.
+#define FAT_END_OF_CHAIN 0x0FFFFFF8
+#define FAT_END_OF_CHAIN_MARKER 0x0FFFFFFF
+#define FAT_FREE_CLUSTER 0
+
+// FAT16 entries from this value on (bad cluster, end of chain) are extended to FAT32 values
+#define FAT16_RESERVED_VALUES 0xFFF7
+// Only the lower 28 bits of a FAT32 entry are a cluster number, the upper 4 bits must be preserved
+#define FAT32_CLUSTER_MASK 0x0FFFFFFF
+
+#define isEndOfChain(cluster) ((cluster) < 2 || (cluster) >= FAT_END_OF_CHAIN)
+
+// Modified FAT sectors, directory entries and cached sectors are written to the card at least this often
+#define SYNC_INTERVAL_MS 1000
+// The periodic sync runs in steps of one sector, one step per tick of this interval
+#define SYNC_STEP_INTERVAL_MS 1
+
+// Readahead window (in sectors). Starts at the minimum on sequential access and doubles with every
+// further sequential read, up to the maximum.
+#define READAHEAD_MIN_SECTORS 4
+#define READAHEAD_MAX_SECTORS (BLOCK_CACHE_ENTRIES / 2)
 
-// Must not be greater than 255
-#define MAX_NUMBER_FILE_DESCRIPTORS 16
+// Number of contiguous cluster runs remembered per open file
+#define MAX_EXTENTS_PER_FILE 8
 
+// A run of contiguous clusters of a file
 typedef struct{
-    uint32_t bytesRemainingInFile;
-    uint32_t beginningOfFileAsClusterNumber;
+    // Index of the first cluster of the run within the file's cluster chain
+    uint32_t firstClusterIndex;
+    uint32_t firstCluster;
+    uint32_t numberOfClusters;
+} Extent_t;
+
+typedef struct{
+    // Volume the file lies on
+    FatVolume_t * volume;
 
     uint32_t fileSize;
 
+    // Offset (in bytes) of the next byte to be read
+    uint32_t position;
+
+    uint32_t beginningOfFileAsClusterNumber;
+
+    // Cluster containing the current position and its index within the cluster chain
+    uint32_t currentCluster;
+    uint32_t currentClusterIndex;
+
+    // Cluster index: the extents cover the first indexedClusters clusters of the chain. The index is built
+    // while the chain is followed, so that seeking backwards or to an already visited part of the file does
+    // not need to walk the FAT again.
+    Extent_t extents[MAX_EXTENTS_PER_FILE];
+    uint32_t numberOfExtents;
+    uint32_t indexedClusters;
+
+    // The last sector read for partial copies is kept, so that a read resuming in the middle of a sector
+    // does not need to fetch it again.
+    uint32_t bufferedSectorAddress;
+    uint8_t sectorBuffer[STORAGE_SECTOR_SIZE];
+
+    // Readahead state: where the previous read ended, the current window (in sectors, 0 = no readahead)
+    // and the file position up to which sectors have been queued for prefetching
+    uint32_t previousReadEnd;
+    uint32_t readaheadWindow;
+    uint32_t readaheadPosition;
+
+    // Address (in bytes) of the directory entry of the file. Size and first cluster are only written back
+    // to the directory entry on close or sync.
+    uint32_t directoryEntryAddress;
+    uint16_t isDirectoryEntryDirty;
+
+    uint16_t isWritable;
+    uint16_t isAppending;
+
+    // Set for descriptors of directories opened with fileSystem_openDirectory
+    uint16_t isDirectory;
+
     // Use uint16 instead of uint8 because of memory alignment issues
     uint16_t isSlotTaken;
+} FileDescriptor_t;
 
-    uint16_t clustersRead;
-}__attribute((packed)) FileDescriptor_t;
+// A struct that contains data for accessing a mounted FAT volume.
+struct FatVolume{
+    // Device (usually a partition) holding the volume, the boot sector is its first block
+    BlockDevice_t * device;
+    uint16_t isUsed;
 
-// A struct that contains data for accessing the file system.
-typedef struct{
+    FatType_t fatType;
     uint32_t fatTableAddress;
     uint32_t rootDirectoryAddress;
+    // FAT32: first cluster of the root directory. 0 for FAT16, where the root directory is a fixed area in
+    // front of the data area.
+    uint32_t rootDirectoryCluster;
+    uint32_t dataAreaAddress;
     uint32_t numberOfSectorsPerFatTable;
     uint16_t maximumNumberOfEntriesInRoot;
-    uint16_t currentClusterBeingRead;
-    uint32_t bytesRemainingInFile;
-    uint32_t bytesRemainingInCluster;
+    uint32_t numberOfFats;
     uint32_t sectorsPerCluster;
+    uint32_t clusterSizeInBytes;
+
+    // Number of clusters in the data area (valid cluster numbers are 2 to numberOfClusters+1)
+    uint32_t numberOfClusters;
+    // Where the search for a free cluster starts
+    uint32_t nextFreeCluster;
+
+    // Number of free clusters (FSINFO_UNKNOWN if not known, read from the FSInfo sector on FAT32) and address of the
+    // FSInfo sector (0 if there is none). The hints are kept up to date while clusters are allocated and freed, and
+    // written back to the FSInfo sector on close and sync.
+    uint32_t freeClusterCount;
+    uint32_t fsInfoAddress;
+    uint16_t isFsInfoDirty;
 
-    // Array containing the file descriptors
-    FileDescriptor_t fileDescriptors[MAX_NUMBER_FILE_DESCRIPTORS];
+    // Last FAT sector accessed, following a cluster chain mostly stays within the same FAT sector.
+    // Modifications are collected here and written to all FAT copies when another FAT sector is needed, or on sync.
+    uint32_t cachedFatSector;
+    // Holds 128 FAT32 or 256 FAT16 entries
+    uint32_t fatSectorBuffer[STORAGE_SECTOR_SIZE / sizeof(uint32_t)];
+    uint16_t isFatSectorDirty;
+};
 
-    // This is the directory currently being read. After initialization, this directory is the root directory by default.
-    uint32_t currentDirectoryAddressInBytes;
-}__attribute((packed)) FileSystemState_t;
+static FatVolume_t volumes[MAX_FAT_VOLUMES];
 
-static FileSystemState_t fileSystemState;
+// Array containing the file descriptors of all volumes
+static FileDescriptor_t fileDescriptors[MAX_NUMBER_FILE_DESCRIPTORS];
+
+static uint8_t isInitialized = 0;
+
+static SubscriptionId_t syncStepSubscription;
+// Set if a piece of metadata could not be moved into the block cache in the running periodic sync
+static uint8_t isSyncMetadataBlocked;
 
 // Function declarations
-static uint16_t getNextClusterToRead(uint16_t currentCluster);
+static uint32_t getNextClusterToRead(FatVolume_t * volume, uint32_t currentCluster);
 static uint8_t compareFileNames(uint8_t* file1, uint8_t* ext1, uint8_t* file2, uint8_t* ext2);
-static uint32_t getClusterAdressInBytes(uint32_t clusterNumber);
-static uint32_t readBootSector(void);
-static uint32_t readPartitionTable(PartitionTable_t * partitionTable);
+static uint32_t getClusterAdressInBytes(FatVolume_t * volume, uint32_t clusterNumber);
+static uint32_t readBootSector(FatVolume_t * volume);
 static int16_t getNextFreeFileDescriptorSlot(void);
-static uint32_t getNextDirectory(uint8_t * dirName, uint32_t currentDirectory);
-static int16_t openFileEntry(uint8_t * fileName, uint8_t* extension, uint32_t addressOfCurrentDir);
-static uint8_t* removeWhiteSpacesFromUint8Array(uint8_t* input);
+static uint32_t getNextDirectory(FatVolume_t * volume, uint8_t * dirName, uint32_t currentDirectory);
+static int16_t openFileEntry(FatVolume_t * volume, uint8_t * fileName, uint8_t* extension, uint32_t addressOfCurrentDir, uint8_t flags);
+static uint8_t isFixedRootDirectory(FatVolume_t * volume, uint32_t directoryAddress);
+static uint32_t getNextDirectorySector(FatVolume_t * volume, uint32_t directoryAddress, uint32_t sectorAddress);
+static uint32_t extendDirectory(FatVolume_t * volume, uint32_t lastSectorAddress);
+static uint32_t findDirectoryEntry(FatVolume_t * volume, uint32_t directoryAddress, uint8_t * fileName, uint8_t * extension, Fat16Entry_t * entry);
+static uint32_t createDirectoryEntry(FatVolume_t * volume, uint32_t directoryAddress, uint8_t * fileName, uint8_t * extension, Fat16Entry_t * entry);
+static uint8_t writeDirectoryEntry(FileDescriptor_t * descriptor);
+static uint8_t loadFatSector(FatVolume_t * volume, uint32_t fatSector);
+static uint8_t flushFatSector(FatVolume_t * volume);
+static uint8_t setFatEntry(FatVolume_t * volume, uint32_t cluster, uint32_t value);
+static uint32_t allocateCluster(FatVolume_t * volume);
+static void freeClusterChain(FatVolume_t * volume, uint32_t firstCluster);
+static uint8_t readFsInfo(FatVolume_t * volume, uint32_t address);
+static uint8_t writeFsInfo(FatVolume_t * volume);
+static uint32_t getEntryCluster(FatVolume_t * volume, Fat16Entry_t * entry);
+static void setEntryCluster(FatVolume_t * volume, Fat16Entry_t * entry, uint32_t cluster);
+static uint8_t appendCluster(FileDescriptor_t * descriptor);
+static void truncateFile(FileDescriptor_t * descriptor);
+static void invalidateBufferedSectors(FatVolume_t * volume, uint32_t address, uint32_t count, FileDescriptor_t * except);
+static uint32_t writeToPosition(FileDescriptor_t * descriptor, const uint8_t * buffer, uint32_t bufferSize);
+static void periodicSync(PCB_t * currentPcb);
+static uint8_t finishMetadataStep(uint8_t isMoved);
+static uint8_t syncMetadataStep(void);
+static void syncStep(PCB_t * currentPcb);
+static uint32_t syncVolume(FatVolume_t * volume);
+static uint32_t getClusterOfAddress(FatVolume_t * volume, uint32_t address);
+static void initFileDescriptor(FatVolume_t * volume, FileDescriptor_t * descriptor, uint32_t startingCluster, uint32_t fileSize);
+static void formatFileName(char * name, uint8_t * fileName, uint8_t * extension);
+static FileDescriptor_t * getOpenFileDescriptor(uint8_t fileDescriptor);
+static uint8_t indexCluster(FileDescriptor_t * descriptor, uint32_t cluster);
+static uint8_t seekToClusterOfPosition(FileDescriptor_t * descriptor);
+static void updateReadahead(FileDescriptor_t * descriptor, uint32_t readStart);
+static uint32_t readFromPosition(FileDescriptor_t * descriptor, uint8_t * buffer, uint32_t bufferSize);
+static uint32_t resolvePath(FatVolume_t * volume, uint8_t * fileName, uint8_t * fileToOpen, uint8_t * fileToOpenExtension);
+static void fillFileStatus(Fat16Entry_t * entry, uint32_t entryAddress, FileStatus_t * status);
 
 /*
  * Returns next free FD slot, or -1 if no free FD slot
@@ -83,7 +226,7 @@ static uint8_t* removeWhiteSpacesFromUint8Array(uint8_t* input);
 int16_t getNextFreeFileDescriptorSlot(void){
     volatile uint8_t i = 0;
     for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS; i++){
-        if(fileSystemState.fileDescriptors[i].isSlotTaken == 0){
+        if(fileDescriptors[i].isSlotTaken == 0){
             // slot not taken, return 0
             return i;
         }
@@ -114,392 +257,708 @@ uint8_t compareFileNames(uint8_t* file1, uint8_t* ext1, uint8_t* file2, uint8_t*
 /*
  * Returns the cluster address (in bytes) for a cluster number
  */
-uint32_t getClusterAdressInBytes(uint32_t clusterNumber){
-    // Calculate address of data area
-    uint32_t dataAreaStartAddress = fileSystemState.rootDirectoryAddress + (fileSystemState.maximumNumberOfEntriesInRoot * sizeof(Fat16Entry_t));
-    return dataAreaStartAddress + ((clusterNumber-2) * fileSystemState.sectorsPerCluster * STORAGE_SECTOR_SIZE); // clusterNumber-2 because of FAT16 anomaly
+uint32_t getClusterAdressInBytes(FatVolume_t * volume, uint32_t clusterNumber){
+    return volume->dataAreaAddress + ((clusterNumber-2) * volume->sectorsPerCluster * STORAGE_SECTOR_SIZE); // clusterNumber-2 because of FAT16 anomaly
 }
 
-uint32_t readPartitionTable(PartitionTable_t * partitionTable){
-    if(partitionTable==0){
-        return 1;
+/*
+ * Returns the first cluster of a directory entry. The upper 16 bits are only used by FAT32.
+ */
+uint32_t getEntryCluster(FatVolume_t * volume, Fat16Entry_t * entry){
+    if(volume->fatType == FAT_TYPE_32){
+        return ((uint32_t)entry->starting_cluster_high << 16) | entry->starting_cluster;
     }
+    return entry->starting_cluster;
+}
 
-    uint8_t buffer[STORAGE_SECTOR_SIZE];
-    if (readSector(buffer, 0) != STORAGE_SECTOR_SIZE){
-        // Did not read expected 512 bytes. Make sure storage is initialized.
-        return 2;
+void setEntryCluster(FatVolume_t * volume, Fat16Entry_t * entry, uint32_t cluster){
+    entry->starting_cluster = cluster & 0xFFFF;
+    if(volume->fatType == FAT_TYPE_32){
+        entry->starting_cluster_high = cluster >> 16;
     }
-
-    // TODO: maybe analyze all four partitions instead of just the first?
-    memcpy(partitionTable, buffer + PARTITION_TABLE_OFFSET, sizeof(PartitionTable_t));
-
-    return 0;
 }
 
 /*
- * Gets the next cluster to be read from the FAT table. As input, the current cluster should be provided.
+ * Makes sure the given FAT sector is in the FAT sector buffer. A modified FAT sector is written back first.
+ * Returns 0 on error.
  */
-uint16_t getNextClusterToRead(uint16_t currentCluster){
-    // The FAT table may spread across multiple sectors. Check which sector should be read.
-    uint32_t fatSectorToRead = currentCluster/256; // 256, because a cluster number is 16 bit (FAT16) large
-
-    if(fatSectorToRead>fileSystemState.numberOfSectorsPerFatTable){
+uint8_t loadFatSector(FatVolume_t * volume, uint32_t fatSector){
+    if(fatSector >= volume->numberOfSectorsPerFatTable){
         // Out of FAT bounds
-        return 0xFFFF;
+        return 0;
+    }
+
+    if(volume->cachedFatSector == fatSector){
+        return 1;
     }
 
-    uint16_t fatTable[256];
-    if(readSector((uint8_t*)fatTable, (fileSystemState.fatTableAddress + (STORAGE_SECTOR_SIZE * fatSectorToRead)))!=STORAGE_SECTOR_SIZE){
-        return 0xFFFF;
+    if(!flushFatSector(volume)){
+        return 0;
     }
 
-    return fatTable[currentCluster];
+    if(blockCache_readSector(volume->device, (uint8_t*)volume->fatSectorBuffer, (volume->fatTableAddress + (STORAGE_SECTOR_SIZE * fatSector)))!=STORAGE_SECTOR_SIZE){
+        volume->cachedFatSector = INVALID_SECTOR_ADDRESS;
+        return 0;
+    }
+    volume->cachedFatSector = fatSector;
+    return 1;
 }
 
 /*
- * Reading the boot sector will cause the fileSystemState struct to be updated/written with information.
+ * Writes the FAT sector buffer to all copies of the FAT, if it has been modified. Returns 0 on error.
  */
-uint32_t readBootSector(void){
-    PartitionTable_t partitionTable;
-    if(readPartitionTable(&partitionTable)){
-        // Error reading partition table
-        return 2;
+uint8_t flushFatSector(FatVolume_t * volume){
+    if(!volume->isFatSectorDirty){
+        return 1;
     }
 
-    if(partitionTable.partitionType != FAT16_GT_32_MB_LBA){
-        // Unknown FAT type - currently only supporting type 14
-        return 3;
+    uint32_t i;
+    for(i = 0; i < volume->numberOfFats; i++){
+        uint32_t address = volume->fatTableAddress
+                + STORAGE_SECTOR_SIZE * (i * volume->numberOfSectorsPerFatTable + volume->cachedFatSector);
+        if(blockCache_writeSector(volume->device, (uint8_t*)volume->fatSectorBuffer, address) != STORAGE_SECTOR_SIZE){
+            return 0;
+        }
     }
 
-    FAT16BootSector_t bootSector;
+    volume->isFatSectorDirty = 0;
+    return 1;
+}
 
-    // Calculate address of boot sector
-    if(readSector((uint8_t*)&bootSector, STORAGE_SECTOR_SIZE*partitionTable.relativeOffsetPartitionSectors) != STORAGE_SECTOR_SIZE){
-        return 4;
+/*
+ * Gets the next cluster to be read from the FAT table. As input, the current cluster should be provided.
+ * End of chain markers are returned as FAT32 values (>= FAT_END_OF_CHAIN) for both FAT types.
+ */
+uint32_t getNextClusterToRead(FatVolume_t * volume, uint32_t currentCluster){
+    // The FAT table may spread across multiple sectors. Check which sector should be read.
+    uint32_t entriesPerFatSector = STORAGE_SECTOR_SIZE / volume->fatType; // 256 for FAT16, 128 for FAT32
+
+    if(!loadFatSector(volume, currentCluster / entriesPerFatSector)){
+        return FAT_END_OF_CHAIN_MARKER;
     }
 
-    // Write the fileSystemState struct:
+    uint32_t index = currentCluster % entriesPerFatSector;
+    if(volume->fatType == FAT_TYPE_32){
+        return volume->fatSectorBuffer[index] & FAT32_CLUSTER_MASK;
+    }
+
+    uint32_t value = ((uint16_t*)volume->fatSectorBuffer)[index];
+    return (value >= FAT16_RESERVED_VALUES) ? (value | (FAT32_CLUSTER_MASK & ~0xFFFF)) : value;
+}
 
-    // Write FAT table address in the global variable
-    fileSystemState.fatTableAddress = (bootSector.reservedSectors + partitionTable.relativeOffsetPartitionSectors)*STORAGE_SECTOR_SIZE;
+/*
+ * Sets the FAT entry of a cluster. Returns 0 on error.
+ */
+uint8_t setFatEntry(FatVolume_t * volume, uint32_t cluster, uint32_t value){
+    uint32_t entriesPerFatSector = STORAGE_SECTOR_SIZE / volume->fatType;
 
-    // Write root directory address in the global variable
-    fileSystemState.rootDirectoryAddress = ((bootSector.reservedSectors+bootSector.numSectorsPerFATTable*bootSector.numberOfFATs)*STORAGE_SECTOR_SIZE)
-                            +STORAGE_SECTOR_SIZE*partitionTable.relativeOffsetPartitionSectors;
+    if(!loadFatSector(volume, cluster / entriesPerFatSector)){
+        return 0;
+    }
 
-    // Initial directory to read is the root directory
-    fileSystemState.currentDirectoryAddressInBytes = fileSystemState.rootDirectoryAddress;
+    uint32_t index = cluster % entriesPerFatSector;
+    if(volume->fatType == FAT_TYPE_32){
+        uint32_t * entry = &volume->fatSectorBuffer[index];
+        *entry = (*entry & ~FAT32_CLUSTER_MASK) | (value & FAT32_CLUSTER_MASK);
+    } else {
+        ((uint16_t*)volume->fatSectorBuffer)[index] = value;
+    }
+    volume->isFatSectorDirty = 1;
+    return 1;
+}
 
-    // Write number of sectors per FAT table in root directory
-    fileSystemState.numberOfSectorsPerFatTable = bootSector.numSectorsPerFATTable;
+/*
+ * Finds a free cluster and marks it as the end of a cluster chain. Returns the cluster, or 0 if the disk is full.
+ * The search starts at the next free cluster hint (taken from the FSInfo sector on FAT32).
+ */
+uint32_t allocateCluster(FatVolume_t * volume){
+    if(volume->freeClusterCount == 0){
+        // Known to be full, do not scan the whole FAT
+        return 0;
+    }
 
-    // Maximum number of entries in root
-    fileSystemState.maximumNumberOfEntriesInRoot = ((uint16_t)bootSector.numberOfEntriesInRoot[1]<<8) | (bootSector.numberOfEntriesInRoot[0]);
+    uint32_t cluster = volume->nextFreeCluster;
+    uint32_t i;
+    for(i = 0; i < volume->numberOfClusters; i++){
+        if(cluster < 2 || cluster >= volume->numberOfClusters + 2){
+            cluster = 2;
+        }
 
-    fileSystemState.sectorsPerCluster = bootSector.numberOfSectorsPerCluster;
+        if(getNextClusterToRead(volume, cluster) == FAT_FREE_CLUSTER){
+            if(!setFatEntry(volume, cluster, FAT_END_OF_CHAIN_MARKER)){
+                return 0;
+            }
+            volume->nextFreeCluster = cluster + 1;
+            if(volume->freeClusterCount != FSINFO_UNKNOWN){
+                volume->freeClusterCount--;
+            }
+            volume->isFsInfoDirty = 1;
+            return cluster;
+        }
+        cluster++;
+    }
 
+    volume->freeClusterCount = 0;
     return 0;
 }
 
 /*
- * Reads the boot sectors and saves the most important information in a module-global struct.
+ * Marks all clusters of a cluster chain as free.
  */
-uint32_t filesystem_Initialize(void){
-    return readBootSector();
+void freeClusterChain(FatVolume_t * volume, uint32_t firstCluster){
+    uint32_t cluster = firstCluster;
+    while(!isEndOfChain(cluster)){
+        uint32_t nextCluster = getNextClusterToRead(volume, cluster);
+        if(!setFatEntry(volume, cluster, FAT_FREE_CLUSTER)){
+            return;
+        }
+        if(cluster < volume->nextFreeCluster){
+            volume->nextFreeCluster = cluster;
+        }
+        if(volume->freeClusterCount != FSINFO_UNKNOWN){
+            volume->freeClusterCount++;
+        }
+        volume->isFsInfoDirty = 1;
+        cluster = nextCluster;
+    }
 }
 
 /*
- * Returns address of next directory, or 0 if not found/not a directory.
+ * Reads the free cluster hints of the FSInfo sector at address. Returns 0 if the sector is not a valid FSInfo sector.
  */
-uint32_t getNextDirectory(uint8_t * dirName, uint32_t currentDirectory){
-    // Local buffer
-    uint8_t buffer[STORAGE_SECTOR_SIZE];
-
-    uint32_t sizeOfFatEntry = sizeof(Fat16Entry_t);
-
-    // Local variable to store the currently read entry
-    Fat16Entry_t currentEntry;
-    volatile uint16_t i = 0;
-
-    uint8_t * dirExtension = "   ";
-
-
-    for(i=0; i < fileSystemState.maximumNumberOfEntriesInRoot * sizeOfFatEntry; i+=sizeOfFatEntry){
+uint8_t readFsInfo(FatVolume_t * volume, uint32_t address){
+    FsInfoSector_t fsInfo;
+    if(blockCache_readSector(volume->device, (uint8_t*)&fsInfo, address) != STORAGE_SECTOR_SIZE
+            || fsInfo.leadSignature != FSINFO_LEAD_SIGNATURE || fsInfo.structSignature != FSINFO_STRUCT_SIGNATURE){
+        return 0;
+    }
 
-        if(i%STORAGE_SECTOR_SIZE==0){
-            // Read current directory
-            readSector(buffer, currentDirectory+i);
-        }
+    volume->fsInfoAddress = address;
+    if(fsInfo.freeClusterCount <= volume->numberOfClusters){
+        volume->freeClusterCount = fsInfo.freeClusterCount;
+    }
+    if(fsInfo.nextFreeCluster >= 2 && fsInfo.nextFreeCluster < volume->numberOfClusters + 2){
+        volume->nextFreeCluster = fsInfo.nextFreeCluster;
+    }
+    return 1;
+}
 
-        memcpy((void*)&currentEntry, buffer+(i % STORAGE_SECTOR_SIZE), sizeof(currentEntry));
+/*
+ * Writes the free cluster hints back to the FSInfo sector, if they changed. Returns 0 on error.
+ */
+uint8_t writeFsInfo(FatVolume_t * volume){
+    if(volume->fsInfoAddress == 0 || !volume->isFsInfoDirty){
+        return 1;
+    }
 
-        if(compareFileNames(currentEntry.filename, currentEntry.ext, dirName, dirExtension)){
-            // File found. Check if it is a directory. If yes, change the current directory global variable.
-            if(currentEntry.attributes == FAT16_DIRECTORY_ENTRY){
-                // Entry is a directory
-                return getClusterAdressInBytes(currentEntry.starting_cluster);
-            }
-            else {
-                return 0;
-            }
-        }
+    FsInfoSector_t fsInfo;
+    if(blockCache_readSector(volume->device, (uint8_t*)&fsInfo, volume->fsInfoAddress) != STORAGE_SECTOR_SIZE){
+        return 0;
+    }
+    fsInfo.freeClusterCount = volume->freeClusterCount;
+    fsInfo.nextFreeCluster = volume->nextFreeCluster;
+    if(blockCache_writeSector(volume->device, (uint8_t*)&fsInfo, volume->fsInfoAddress) != STORAGE_SECTOR_SIZE){
+        return 0;
     }
 
-    return 0;
+    volume->isFsInfoDirty = 0;
+    return 1;
 }
 
 /*
- * Opens a file entry. If fileName points to a directory name, -2 (error) is returned.
+ * Reading the boot sector (the first block of the volume's device) will cause the volume struct to be
+ * updated/written with information.
  */
-int16_t openFileEntry(uint8_t * fileName, uint8_t* extension, uint32_t addressOfCurrentDir){
-    // Calculate size of a FAT entry
-    uint32_t sizeOfFatEntry = sizeof(Fat16Entry_t);
-    // Iterate through entries in the root directory, until file is found
+uint32_t readBootSector(FatVolume_t * volume){
+    BlockDevice_t * device = volume->device;
+    if(device->blockSize != STORAGE_SECTOR_SIZE){
+        return 2;
+    }
 
-    uint8_t buffer[STORAGE_SECTOR_SIZE];
+    if(device->disk != NULL && device->partitionType != FAT16_GT_32_MB_LBA && device->partitionType != FAT32_LTE_2_GB
+            && device->partitionType != FAT32_LTE_2_GB_LBA){
+        // Unknown FAT type - currently only supporting types 14, 11 and 12. Devices which are not partitions
+        // (e.g. RAM disks) are checked by their boot sector only.
+        return 3;
+    }
 
-    // Local variable to store the currently read entry
-    Fat16Entry_t currentEntry;
-    volatile uint32_t i = 0;
-    for(i=0; i < fileSystemState.maximumNumberOfEntriesInRoot*4; i+=sizeOfFatEntry){
+    // Both boot sector layouts share the fields up to numSectorsOnDiskForGT32MB
+    union {
+        FAT16BootSector_t fat16;
+        FAT32BootSector_t fat32;
+    } bootSector;
+    if(blockDevice_read(device, (uint8_t*)&bootSector, 0, 1) != 1){
+        return 4;
+    }
 
-        if(i%STORAGE_SECTOR_SIZE==0){
-            readSector(buffer, addressOfCurrentDir+i);
-        }
+    if(bootSector.fat16.bootSectorSignature != BOOT_SECTOR_SIGNATURE || bootSector.fat16.sectorSizeInBytes != STORAGE_SECTOR_SIZE
+            || bootSector.fat16.numberOfSectorsPerCluster == 0){
+        // Not a FAT volume
+        return 5;
+    }
 
-        memcpy((void*)&currentEntry, buffer+(i%STORAGE_SECTOR_SIZE), sizeof(currentEntry));
-        if(compareFileNames(currentEntry.filename, currentEntry.ext, fileName, extension)){
-            // File found. Check if it is a directory. If yes, change the current directory global variable.
-            if(currentEntry.attributes == FAT16_DIRECTORY_ENTRY){
-                // Entry is a directory
-                return -2;
-            }
+    // Write the volume struct:
 
-            int16_t fileDescriptor = getNextFreeFileDescriptorSlot();
+    // FAT32 volumes have no FAT16 FAT size (the type is determined by the boot sector, not the partition type)
+    uint32_t numberOfSectorsPerFatTable;
+    if(bootSector.fat16.numSectorsPerFATTable == 0){
+        volume->fatType = FAT_TYPE_32;
+        numberOfSectorsPerFatTable = bootSector.fat32.numSectorsPerFATTable32;
+    } else {
+        volume->fatType = FAT_TYPE_16;
+        numberOfSectorsPerFatTable = bootSector.fat16.numSectorsPerFATTable;
+    }
 
-            // Get a file descriptor (if available)
-            if(fileDescriptor==-1){
-                // Too many files are opened, and no FD available
-                return -1;
-            }
+    // Write FAT table address in the volume struct. Addresses are relative to the start of the device.
+    volume->fatTableAddress = bootSector.fat16.reservedSectors*STORAGE_SECTOR_SIZE;
 
-            fileSystemState.fileDescriptors[fileDescriptor].beginningOfFileAsClusterNumber = currentEntry.starting_cluster;
-            fileSystemState.fileDescriptors[fileDescriptor].bytesRemainingInFile = currentEntry.file_size;
-            fileSystemState.fileDescriptors[fileDescriptor].fileSize = currentEntry.file_size;
-            // Slot taken
-            fileSystemState.fileDescriptors[fileDescriptor].isSlotTaken = 1;
-            fileSystemState.fileDescriptors[fileDescriptor].clustersRead = 0;
+    // Write number of sectors per FAT table in root directory
+    volume->numberOfSectorsPerFatTable = numberOfSectorsPerFatTable;
 
-            return fileDescriptor;
-        }
-    }
+    // Maximum number of entries in root (0 for FAT32)
+    volume->maximumNumberOfEntriesInRoot = ((uint16_t)bootSector.fat16.numberOfEntriesInRoot[1]<<8) | (bootSector.fat16.numberOfEntriesInRoot[0]);
 
-    // File not found
-    return -1;
-}
+    volume->numberOfFats = bootSector.fat16.numberOfFATs;
+    volume->sectorsPerCluster = bootSector.fat16.numberOfSectorsPerCluster;
+    volume->clusterSizeInBytes = volume->sectorsPerCluster * STORAGE_SECTOR_SIZE;
 
+    // The data area follows the FATs and (FAT16 only) the fixed root directory
+    uint32_t firstDataSector = bootSector.fat16.reservedSectors + numberOfSectorsPerFatTable*bootSector.fat16.numberOfFATs
+                            + (volume->maximumNumberOfEntriesInRoot * sizeof(Fat16Entry_t)) / STORAGE_SECTOR_SIZE;
+    volume->dataAreaAddress = firstDataSector*STORAGE_SECTOR_SIZE;
 
-int16_t fileSystem_openFile(uint8_t * fileName){
-    if(fileName==NULL){
-        return -3;
-    }
+    if(volume->fatType == FAT_TYPE_32){
+        // The root directory is a cluster chain
+        volume->rootDirectoryCluster = bootSector.fat32.rootDirectoryCluster;
+        volume->rootDirectoryAddress = getClusterAdressInBytes(volume, volume->rootDirectoryCluster);
 
-    if (*fileName != '/') {
-        return -4;
+        if(bootSector.fat32.extendedFlags & 0x80){
+            // FAT mirroring disabled, only the active FAT is used
+            volume->fatTableAddress += (bootSector.fat32.extendedFlags & 0x0F) * numberOfSectorsPerFatTable * STORAGE_SECTOR_SIZE;
+            volume->numberOfFats = 1;
+        }
     } else {
-        fileName += 1;
+        // Write root directory address in the volume struct
+        volume->rootDirectoryCluster = 0;
+        volume->rootDirectoryAddress = volume->fatTableAddress
+                            + numberOfSectorsPerFatTable*bootSector.fat16.numberOfFATs*STORAGE_SECTOR_SIZE;
     }
 
-    // Split fileName according to delimiter. Use strnchr in order not to change the original string
-    uint8_t * currentName = (uint8_t*) strchr((char*)fileName, PATH_DELIMITER);
+    // Number of clusters: sectors of the data area, limited by the number of FAT entries
+    uint32_t numberOfSectors = bootSector.fat16.numSectorsOnDiskForLTE32MB ? bootSector.fat16.numSectorsOnDiskForLTE32MB : bootSector.fat16.numSectorsOnDiskForGT32MB;
+    if(numberOfSectors > 0x100000000ULL / STORAGE_SECTOR_SIZE){
+        // Volumes are accessed with 32 bit byte addresses, so larger ones (e.g. on big SDHC cards) are not mounted
+        return 6;
+    }
+    uint32_t maximumNumberOfClusters = numberOfSectorsPerFatTable * (STORAGE_SECTOR_SIZE / volume->fatType) - 2;
+    volume->numberOfClusters = (numberOfSectors - firstDataSector) / volume->sectorsPerCluster;
+    if(volume->numberOfClusters > maximumNumberOfClusters){
+        volume->numberOfClusters = maximumNumberOfClusters;
+    }
+    volume->nextFreeCluster = 2;
+    volume->freeClusterCount = FSINFO_UNKNOWN;
+    volume->fsInfoAddress = 0;
+    volume->isFsInfoDirty = 0;
+
+    // Nothing cached yet
+    volume->cachedFatSector = INVALID_SECTOR_ADDRESS;
+    volume->isFatSectorDirty = 0;
+
+    if(volume->fatType == FAT_TYPE_32 && bootSector.fat32.fsInfoSector != 0){
+        // Without a valid FSInfo sector, free clusters are searched from the start of the FAT
+        readFsInfo(volume, bootSector.fat32.fsInfoSector*STORAGE_SECTOR_SIZE);
+    }
 
-    // Initialize dir name with spaces
-    uint8_t currentDirName[8];
-    memset(currentDirName,' ', 8);
+    return 0;
+}
 
-    uint8_t fileToOpen[8];
-    memset(fileToOpen,' ', 8);
+void fileSystem_init(void){
+    if(isInitialized){
+        return;
+    }
 
-    uint8_t fileToOpenExtension[3];
-    memset(fileToOpenExtension,' ', 3);
+    blockCache_init();
+    dentryCache_invalidate();
 
-    uint32_t addressOfNextDirectoryToOpen = fileSystemState.rootDirectoryAddress;
-    uint32_t lastPosition = 0;
+    SubscriptionId_t syncSubscription = systemTimer_subscribeCallback(SYNC_INTERVAL_MS, periodicSync);
+    systemTimer_enableSubscription(syncSubscription);
+    syncStepSubscription = systemTimer_subscribeCallback(SYNC_STEP_INTERVAL_MS, syncStep);
 
-    // As long as currentPath is not null, navigate through directories
-    while(currentName!=0){
-        // Copy current directory name to local buffer
-        strncpy((char*)currentDirName, (char*)(fileName + lastPosition), currentName - fileName - lastPosition);
+    isInitialized = 1;
+}
 
-        // currentDirName now contains the name of the directory to open
-        addressOfNextDirectoryToOpen = getNextDirectory(currentDirName, addressOfNextDirectoryToOpen);
+FatVolume_t * fileSystem_mount(BlockDevice_t * device){
+    if(device == NULL){
+        return NULL;
+    }
 
-        if(addressOfNextDirectoryToOpen==0){
-            // Not a directory, or does not exist
-            return -3;
+    uint32_t i;
+    for(i = 0; i < MAX_FAT_VOLUMES; i++){
+        if(volumes[i].isUsed && volumes[i].device == device){
+            // Already mounted
+            return NULL;
         }
+    }
 
-        // Update last position
-        lastPosition = currentName - fileName + 1;
+    for(i = 0; i < MAX_FAT_VOLUMES; i++){
+        FatVolume_t * volume = &volumes[i];
+        if(!volume->isUsed){
+            volume->device = device;
+            if(readBootSector(volume) != 0){
+                return NULL;
+            }
+            volume->isUsed = 1;
+            return volume;
+        }
+    }
 
-        currentName = (uint8_t*)strchr((char*)(currentName+1), PATH_DELIMITER);
+    // Too many volumes
+    return NULL;
+}
 
-        // Reinitialize current name with spaces
-        memset(currentDirName,' ', 8);
+uint32_t fileSystem_format(BlockDevice_t * device){
+    if(device == NULL || device->blockSize != STORAGE_SECTOR_SIZE){
+        return 1;
     }
-    // currentPath has reached 0, meaning all directories have been accessed and only the filename + extension remains
-    // Split filename and extension
-    uint8_t * firstOccurenceOfDot = (uint8_t*)strchr((char*)(fileName + lastPosition), '.');
 
-    // Copy name of file to open, without extension, to local buffer
-    strncpy((char*)fileToOpen, (char*)(fileName + lastPosition) , firstOccurenceOfDot - (fileName + lastPosition));
+    // Boot sector, FAT and root directory take at least 3 sectors, FAT16 counts at most 0xFFF5 clusters
+    uint32_t numberOfSectors = device->numberOfBlocks;
+    if(numberOfSectors < 4 || numberOfSectors > 0xFFF5){
+        return 1;
+    }
+    uint32_t numberOfSectorsPerFatTable = ((numberOfSectors + 2) * FAT_TYPE_16 + STORAGE_SECTOR_SIZE - 1) / STORAGE_SECTOR_SIZE;
+    uint32_t rootDirectorySectors = FORMAT_ROOT_ENTRIES * sizeof(Fat16Entry_t) / STORAGE_SECTOR_SIZE;
+    if(1 + numberOfSectorsPerFatTable + rootDirectorySectors >= numberOfSectors){
+        return 1;
+    }
 
-    // Copy extension
-    strncpy((char*)fileToOpenExtension, (char*)(firstOccurenceOfDot + 1), 3);
+    FAT16BootSector_t bootSector;
+    memset(&bootSector, 0, sizeof(bootSector));
+    bootSector.jumpInstruction80x86[0] = 0xEB;
+    bootSector.jumpInstruction80x86[1] = 0x3C;
+    bootSector.jumpInstruction80x86[2] = 0x90;
+    memcpy(bootSector.oemName, "MINIONOS", sizeof(bootSector.oemName));
+    bootSector.sectorSizeInBytes = STORAGE_SECTOR_SIZE;
+    bootSector.numberOfSectorsPerCluster = 1;
+    bootSector.reservedSectors = 1;
+    bootSector.numberOfFATs = 1;
+    bootSector.numberOfEntriesInRoot[0] = FORMAT_ROOT_ENTRIES & 0xFF;
+    bootSector.numberOfEntriesInRoot[1] = FORMAT_ROOT_ENTRIES >> 8;
+    bootSector.numSectorsOnDiskForLTE32MB = numberOfSectors;
+    bootSector.mediaDescriptor = 0xF8;
+    bootSector.numSectorsPerFATTable = numberOfSectorsPerFatTable;
+    bootSector.bootSignature = 0x29;
+    memcpy(bootSector.volumeLabel, "NO NAME    ", sizeof(bootSector.volumeLabel));
+    memcpy(bootSector.fileSystemType, "FAT16   ", sizeof(bootSector.fileSystemType));
+    bootSector.bootSectorSignature = BOOT_SECTOR_SIGNATURE;
+    if(blockDevice_write(device, (uint8_t*)&bootSector, 0, 1) != 1){
+        return 1;
+    }
+
+    // Empty FAT and root directory, the first two FAT entries hold the media descriptor and the end of chain marker
+    uint16_t sector[STORAGE_SECTOR_SIZE / sizeof(uint16_t)];
+    uint32_t i;
+    for(i = 1; i <= numberOfSectorsPerFatTable + rootDirectorySectors; i++){
+        memset(sector, 0, sizeof(sector));
+        if(i == 1){
+            sector[0] = 0xFFF8;
+            sector[1] = 0xFFFF;
+        }
+        if(blockDevice_write(device, (uint8_t*)sector, i, 1) != 1){
+            return 1;
+        }
+    }
 
-    return openFileEntry(fileToOpen, fileToOpenExtension, addressOfNextDirectoryToOpen);
+    return 0;
 }
 
-void fileSystem_closeFile(uint8_t fileDescriptor){
-    if(fileDescriptor < MAX_NUMBER_FILE_DESCRIPTORS){
-        // Free slot
-        fileSystemState.fileDescriptors[fileDescriptor].isSlotTaken = 0;
-    }
+/*
+ * Returns 1 if the directory is the FAT16 root directory, which is a fixed area in front of the data area.
+ */
+uint8_t isFixedRootDirectory(FatVolume_t * volume, uint32_t directoryAddress){
+    return volume->rootDirectoryCluster == 0 && directoryAddress == volume->rootDirectoryAddress;
 }
 
-uint32_t fileSystem_readBytes(uint8_t fileDescriptor, uint8_t * buffer, uint32_t bufferSize){
-    if(buffer==NULL){
-        return 0;
+/*
+ * Returns the address of the sector following sectorAddress in the directory starting at directoryAddress, or 0
+ * at the end of the directory. Directories are cluster chains, except for the fixed FAT16 root directory.
+ */
+uint32_t getNextDirectorySector(FatVolume_t * volume, uint32_t directoryAddress, uint32_t sectorAddress){
+    uint32_t nextSectorAddress = sectorAddress + STORAGE_SECTOR_SIZE;
+
+    if(isFixedRootDirectory(volume, directoryAddress)){
+        uint32_t rootDirectorySize = volume->maximumNumberOfEntriesInRoot * sizeof(Fat16Entry_t);
+        return (nextSectorAddress < directoryAddress + rootDirectorySize) ? nextSectorAddress : 0;
     }
 
-    if(fileDescriptor>=MAX_NUMBER_FILE_DESCRIPTORS){
-        // Invalid file descriptor
-        return 0;
+    if((nextSectorAddress - volume->dataAreaAddress) % volume->clusterSizeInBytes != 0){
+        // Still within the same cluster
+        return nextSectorAddress;
     }
 
-    if(fileSystemState.fileDescriptors[fileDescriptor].isSlotTaken==0){
-        // Slot not taken => no file opened for this descriptor
+    uint32_t nextCluster = getNextClusterToRead(volume, getClusterOfAddress(volume, sectorAddress));
+    if(isEndOfChain(nextCluster)){
         return 0;
     }
+    return getClusterAdressInBytes(volume, nextCluster);
+}
 
-    uint32_t bytesRemainingInFile = fileSystemState.fileDescriptors[fileDescriptor].bytesRemainingInFile;
-
-    uint32_t fileSize = fileSystemState.fileDescriptors[fileDescriptor].fileSize;
+/*
+ * Appends an empty cluster to the directory whose last sector is at lastSectorAddress. Returns the address of
+ * the new cluster, or 0 if the disk is full.
+ */
+uint32_t extendDirectory(FatVolume_t * volume, uint32_t lastSectorAddress){
+    static const uint8_t emptySector[STORAGE_SECTOR_SIZE] = { 0 };
 
-    if(bytesRemainingInFile==0){
+    uint32_t newCluster = allocateCluster(volume);
+    if(newCluster == 0){
+        return 0;
+    }
+    if(!setFatEntry(volume, getClusterOfAddress(volume, lastSectorAddress), newCluster)){
         return 0;
     }
 
-    // Get current cluster
-    uint16_t currentCluster = fileSystemState.fileDescriptors[fileDescriptor].beginningOfFileAsClusterNumber;
+    // Entries of a directory end with the first empty entry
+    uint32_t clusterAddress = getClusterAdressInBytes(volume, newCluster);
+    uint32_t i;
+    for(i = 0; i < volume->sectorsPerCluster; i++){
+        if(blockCache_writeSector(volume->device, emptySector, clusterAddress + i * STORAGE_SECTOR_SIZE) != STORAGE_SECTOR_SIZE){
+            return 0;
+        }
+    }
+    return clusterAddress;
+}
 
-    uint32_t clusterSizeInBytes = fileSystemState.sectorsPerCluster*STORAGE_SECTOR_SIZE;
+/*
+ * Searches a directory for the entry with the given name and extension (padded with spaces).
+ * Returns the address (in bytes) of the entry and copies the entry, or returns 0 if not found.
+ * The result is taken from the dentry cache if possible, otherwise the directory is scanned and the result is cached.
+ */
+uint32_t findDirectoryEntry(FatVolume_t * volume, uint32_t directoryAddress, uint8_t * fileName, uint8_t * extension, Fat16Entry_t * entry){
+    uint32_t entryAddress;
+    if(dentryCache_lookup(volume, directoryAddress, fileName, extension, &entryAddress, entry)){
+        return entryAddress;
+    }
 
-    // Local buffer in which each sector is stored
-    uint8_t localBuffer[STORAGE_SECTOR_SIZE];
+    // Local buffer
+    uint8_t buffer[STORAGE_SECTOR_SIZE];
 
-    // Position where file read was left off
-    uint32_t resumePosition = fileSystemState.fileDescriptors[fileDescriptor].fileSize - bytesRemainingInFile;
+    uint32_t sizeOfFatEntry = sizeof(Fat16Entry_t);
+    uint32_t sectorAddress = directoryAddress;
+    uint8_t isEndOfDirectory = 0;
 
-    if(resumePosition%STORAGE_SECTOR_SIZE!=0){
-        // Read first sector
-        if(readSector(localBuffer, getClusterAdressInBytes(currentCluster)+((resumePosition/STORAGE_SECTOR_SIZE)*STORAGE_SECTOR_SIZE)) != STORAGE_SECTOR_SIZE){
-            // Some unexpected error occurred.
+    while(sectorAddress != 0 && !isEndOfDirectory){
+        // Read current directory
+        if(blockCache_readSector(volume->device, buffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+            // Read error, the result is not cached
             return 0;
         }
-    }
 
-    // Keep track of the passed buffer position
-    volatile uint32_t bufferPosition = 0;
+        uint32_t i = 0;
+        for(i=0; i < STORAGE_SECTOR_SIZE; i+=sizeOfFatEntry){
+            memcpy((void*)entry, buffer+i, sizeOfFatEntry);
 
-    volatile uint32_t i = 0;
-    for(i = resumePosition; i < bufferSize+resumePosition; i++){
-        // if sector beginning, read sector
-        if(i%STORAGE_SECTOR_SIZE==0){
-            // Check if next cluster needs to be read. A cluster is made up of multiple sectors
-            if(i/(clusterSizeInBytes + (clusterSizeInBytes*fileSystemState.fileDescriptors[fileDescriptor].clustersRead))>=1){
-                currentCluster = getNextClusterToRead(currentCluster);
-                fileSystemState.fileDescriptors[fileDescriptor].beginningOfFileAsClusterNumber = currentCluster;
-                fileSystemState.fileDescriptors[fileDescriptor].clustersRead++;
+            if(entry->filename[0] == FAT16_END_OF_DIRECTORY_CHAR){
+                // No entries behind this one
+                isEndOfDirectory = 1;
+                break;
             }
 
-            // Read a sector
-            if(readSector(localBuffer, getClusterAdressInBytes(currentCluster)+(i%clusterSizeInBytes)) != STORAGE_SECTOR_SIZE){
-                return i;
+            if(compareFileNames(entry->filename, entry->ext, fileName, extension)){
+                dentryCache_insert(volume, directoryAddress, fileName, extension, sectorAddress + i, entry);
+                return sectorAddress + i;
             }
         }
 
-        if(i>=fileSize){
-            fileSystemState.fileDescriptors[fileDescriptor].bytesRemainingInFile = 0;
-            // EOF reached
-            return i-resumePosition;
+        if(!isEndOfDirectory){
+            sectorAddress = getNextDirectorySector(volume, directoryAddress, sectorAddress);
         }
-
-        // Local buffer is only 512 bytes, so cycle through it using %.
-        buffer[bufferPosition] = localBuffer[i%STORAGE_SECTOR_SIZE];
-        bufferPosition++;
     }
 
-    // Update how many bytes have been read
-    fileSystemState.fileDescriptors[fileDescriptor].bytesRemainingInFile -= bufferSize;
-
-    return bufferSize;
+    // Remember that the name does not exist
+    dentryCache_insert(volume, directoryAddress, fileName, extension, 0, NULL);
+    return 0;
 }
 
-uint8_t* removeWhiteSpacesFromUint8Array(uint8_t* input)
-{
-    uint32_t i,j;
-    uint8_t *output=input;
-    for (i = 0, j = 0; i<strlen((char*)input); i++,j++)
-    {
-        if (input[i]!=' ')
-            output[j]=input[i];
-        else
-            j--;
+/*
+ * Creates an empty file entry in the first free slot of the directory. A full directory is extended by a cluster,
+ * except for the fixed FAT16 root directory. Returns the address (in bytes) of the entry and copies the entry,
+ * or returns 0 if the directory is full.
+ */
+uint32_t createDirectoryEntry(FatVolume_t * volume, uint32_t directoryAddress, uint8_t * fileName, uint8_t * extension, Fat16Entry_t * entry){
+    uint8_t buffer[STORAGE_SECTOR_SIZE];
+
+    uint32_t sizeOfFatEntry = sizeof(Fat16Entry_t);
+    uint32_t sectorAddress = directoryAddress;
+
+    while(sectorAddress != 0){
+        if(blockCache_readSector(volume->device, buffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+            return 0;
+        }
+
+        uint32_t i = 0;
+        for(i=0; i < STORAGE_SECTOR_SIZE; i+=sizeOfFatEntry){
+            uint8_t firstCharacter = buffer[i];
+            if(firstCharacter == FAT16_END_OF_DIRECTORY_CHAR || firstCharacter == FAT16_UNDEFINED_FILENAME_START_CHAR){
+                memset(entry, 0, sizeOfFatEntry);
+                memcpy(entry->filename, fileName, MAX_CHAR_FILE_NAME);
+                memcpy(entry->ext, extension, MAX_CHAR_EXTENSION);
+                entry->attributes = FAT16_ARCHIVE_ENTRY;
+
+                memcpy(buffer + i, entry, sizeOfFatEntry);
+                if(blockCache_writeSector(volume->device, buffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+                    return 0;
+                }
+                // Replaces the negative entry left by the failed lookup
+                dentryCache_insert(volume, directoryAddress, fileName, extension, sectorAddress + i, entry);
+                return sectorAddress + i;
+            }
+        }
+
+        uint32_t nextSectorAddress = getNextDirectorySector(volume, directoryAddress, sectorAddress);
+        if(nextSectorAddress == 0 && !isFixedRootDirectory(volume, directoryAddress)){
+            nextSectorAddress = extendDirectory(volume, sectorAddress);
+        }
+        sectorAddress = nextSectorAddress;
     }
-    output[j]=0;
-    return output;
+
+    return 0;
 }
 
-uint8_t * fileSystem_getNextEntryInDirectory(uint8_t * dirName){
-    if(dirName==NULL){
-        return 0;
-    }
+/*
+ * Writes size and first cluster of an opened file back to its directory entry. Returns 0 on error.
+ */
+uint8_t writeDirectoryEntry(FileDescriptor_t * descriptor){
+    FatVolume_t * volume = descriptor->volume;
+    uint8_t buffer[STORAGE_SECTOR_SIZE];
+    uint32_t offsetInSector = descriptor->directoryEntryAddress % STORAGE_SECTOR_SIZE;
+    uint32_t sectorAddress = descriptor->directoryEntryAddress - offsetInSector;
 
-    // Skip leading slash
-    if (*dirName != '/') {
+    if(blockCache_readSector(volume->device, buffer, sectorAddress) != STORAGE_SECTOR_SIZE){
         return 0;
-    } else {
-        dirName += 1;
     }
 
-    static uint8_t lastDirName[100];
-    static uint32_t indexOfLastReadEntry = 0;
+    Fat16Entry_t entry;
+    memcpy(&entry, buffer + offsetInSector, sizeof(Fat16Entry_t));
+    setEntryCluster(volume, &entry, descriptor->beginningOfFileAsClusterNumber);
+    entry.file_size = descriptor->fileSize;
+    memcpy(buffer + offsetInSector, &entry, sizeof(Fat16Entry_t));
 
-    if (strcmp((char*)lastDirName, (char*)dirName) != 0) {
-        strncpy((char*) lastDirName, (char*) dirName, sizeof(lastDirName) - 1);
-        // Directory has changed, reset index of last entry
-        indexOfLastReadEntry = 0;
+    if(blockCache_writeSector(volume->device, buffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+        return 0;
     }
+    dentryCache_update(volume, descriptor->directoryEntryAddress, &entry);
 
-    // Split fileName according to delimiter. Use strnchr in order not to change the original string
-    uint8_t * currentName = (uint8_t*) strchr((char*)dirName, PATH_DELIMITER);
+    descriptor->isDirectoryEntryDirty = 0;
+    return 1;
+}
 
-    // Initialize dir name with spaces
-    uint8_t currentDirName[8];
+/*
+ * Returns address of next directory, or 0 if not found/not a directory.
+ */
+uint32_t getNextDirectory(FatVolume_t * volume, uint8_t * dirName, uint32_t currentDirectory){
+    // Local variable to store the currently read entry
+    Fat16Entry_t currentEntry;
+
+    uint8_t * dirExtension = "   ";
+
+    if(findDirectoryEntry(volume, currentDirectory, dirName, dirExtension, &currentEntry) == 0){
+        return 0;
+    }
+
+    // File found. Check if it is a directory.
+    if(currentEntry.attributes == FAT16_DIRECTORY_ENTRY){
+        // Entry is a directory. ".." entries of directories in the root directory refer to cluster 0.
+        uint32_t cluster = getEntryCluster(volume, &currentEntry);
+        return (cluster == 0) ? volume->rootDirectoryAddress : getClusterAdressInBytes(volume, cluster);
+    }
+    else {
+        return 0;
+    }
+}
+
+/*
+ * Opens a file entry. If fileName points to a directory name, -2 (error) is returned.
+ * If the file does not exist and OPEN_CREATE is set, an empty file is created.
+ */
+int16_t openFileEntry(FatVolume_t * volume, uint8_t * fileName, uint8_t* extension, uint32_t addressOfCurrentDir, uint8_t flags){
+    // Local variable to store the currently read entry
+    Fat16Entry_t currentEntry;
+
+    uint32_t entryAddress = findDirectoryEntry(volume, addressOfCurrentDir, fileName, extension, &currentEntry);
+    if(entryAddress == 0){
+        if((flags & OPEN_CREATE) == 0){
+            // File not found
+            return -1;
+        }
+
+        entryAddress = createDirectoryEntry(volume, addressOfCurrentDir, fileName, extension, &currentEntry);
+        if(entryAddress == 0){
+            // Directory full
+            return -1;
+        }
+    }
+
+    if(currentEntry.attributes == FAT16_DIRECTORY_ENTRY){
+        // Entry is a directory
+        return -2;
+    }
+
+    int16_t fileDescriptor = getNextFreeFileDescriptorSlot();
+
+    // Get a file descriptor (if available)
+    if(fileDescriptor==-1){
+        // Too many files are opened, and no FD available
+        return -1;
+    }
+
+    FileDescriptor_t * descriptor = &fileDescriptors[fileDescriptor];
+    initFileDescriptor(volume, descriptor, getEntryCluster(volume, &currentEntry), currentEntry.file_size);
+    descriptor->directoryEntryAddress = entryAddress;
+    descriptor->isWritable = (flags & (OPEN_WRITE | OPEN_APPEND)) != 0;
+    descriptor->isAppending = (flags & OPEN_APPEND) != 0;
+    // Slot taken
+    descriptor->isSlotTaken = 1;
+
+    if((flags & OPEN_TRUNCATE) && descriptor->isWritable){
+        truncateFile(descriptor);
+    }
+
+    return fileDescriptor;
+}
+
+
+/*
+ * Splits an absolute path into the directory containing its last component and the name and extension of the
+ * last component (8 and 3 characters, padded with spaces). Returns the address of the directory, or 0 if the
+ * path is invalid or a directory on the path does not exist.
+ */
+uint32_t resolvePath(FatVolume_t * volume, uint8_t * fileName, uint8_t * fileToOpen, uint8_t * fileToOpenExtension){
+    if(volume==NULL || fileName==NULL || *fileName != '/'){
+        return 0;
+    }
+    fileName += 1;
+
+    // Split fileName according to delimiter. Use strnchr in order not to change the original string
+    uint8_t * currentName = (uint8_t*) strchr((char*)fileName, PATH_DELIMITER);
+
+    // Initialize dir name with spaces
+    uint8_t currentDirName[8];
     memset(currentDirName,' ', 8);
 
-    uint32_t addressOfNextDirectoryToOpen = fileSystemState.rootDirectoryAddress;
+    memset(fileToOpen,' ', MAX_CHAR_FILE_NAME);
+    memset(fileToOpenExtension,' ', MAX_CHAR_EXTENSION);
+
+    uint32_t addressOfNextDirectoryToOpen = volume->rootDirectoryAddress;
     uint32_t lastPosition = 0;
 
     // As long as currentPath is not null, navigate through directories
     while(currentName!=0){
         // Copy current directory name to local buffer
-        strncpy((char*)currentDirName, (char*)(dirName + lastPosition), currentName - dirName - lastPosition);
+        strncpy((char*)currentDirName, (char*)(fileName + lastPosition), currentName - fileName - lastPosition);
 
         // currentDirName now contains the name of the directory to open
-        addressOfNextDirectoryToOpen = getNextDirectory(currentDirName, addressOfNextDirectoryToOpen);
+        addressOfNextDirectoryToOpen = getNextDirectory(volume, currentDirName, addressOfNextDirectoryToOpen);
 
         if(addressOfNextDirectoryToOpen==0){
             // Not a directory, or does not exist
@@ -507,57 +966,909 @@ uint8_t * fileSystem_getNextEntryInDirectory(uint8_t * dirName){
         }
 
         // Update last position
-        lastPosition = currentName - dirName + 1;
+        lastPosition = currentName - fileName + 1;
 
         currentName = (uint8_t*)strchr((char*)(currentName+1), PATH_DELIMITER);
 
         // Reinitialize current name with spaces
-        memset(currentDirName,' ', MAX_CHAR_FILE_NAME);
+        memset(currentDirName,' ', 8);
     }
+    // currentPath has reached 0, meaning all directories have been accessed and only the filename + extension remains
+    // Split filename and extension
+    uint8_t * firstOccurenceOfDot = (uint8_t*)strchr((char*)(fileName + lastPosition), '.');
 
-    // Current dir name is available. Read current dir.
-    // Create local buffer
-    uint8_t buf[STORAGE_SECTOR_SIZE];
+    // A file name without a dot has no extension
+    uint32_t nameLength = (firstOccurenceOfDot != NULL) ? firstOccurenceOfDot - (fileName + lastPosition) : strlen((char*)(fileName + lastPosition));
+    if(nameLength > MAX_CHAR_FILE_NAME || nameLength == 0){
+        return 0;
+    }
 
-    uint32_t fileEntriesToSkip = indexOfLastReadEntry;
+    // Copy name of file to open, without extension, to local buffer
+    strncpy((char*)fileToOpen, (char*)(fileName + lastPosition) , nameLength);
 
-    Fat16Entry_t currentEntry;
+    // Copy extension
+    if(firstOccurenceOfDot != NULL){
+        uint32_t extensionLength = strlen((char*)(firstOccurenceOfDot + 1));
+        strncpy((char*)fileToOpenExtension, (char*)(firstOccurenceOfDot + 1), extensionLength < MAX_CHAR_EXTENSION ? extensionLength : MAX_CHAR_EXTENSION);
+    }
+
+    return addressOfNextDirectoryToOpen;
+}
+
+int16_t fileSystem_openFile(FatVolume_t * volume, uint8_t * fileName, uint8_t flags){
+    uint8_t fileToOpen[MAX_CHAR_FILE_NAME];
+    uint8_t fileToOpenExtension[MAX_CHAR_EXTENSION];
+
+    uint32_t directoryAddress = resolvePath(volume, fileName, fileToOpen, fileToOpenExtension);
+    if(directoryAddress == 0){
+        return -3;
+    }
+
+    return openFileEntry(volume, fileToOpen, fileToOpenExtension, directoryAddress, flags);
+}
+
+/*
+ * Fills the file status from a directory entry. The address of the entry identifies the file on its volume.
+ */
+void fillFileStatus(Fat16Entry_t * entry, uint32_t entryAddress, FileStatus_t * status){
+    if(entry->attributes & FAT16_DIRECTORY_ENTRY){
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        status->size = 0;
+    } else {
+        status->type = DIRECTORY_ENTRY_FILE;
+        status->size = entry->file_size;
+    }
+    status->modifyTime = entry->modify_time;
+    status->modifyDate = entry->modify_date;
+    status->fileId = entryAddress;
+}
+
+int32_t fileSystem_stat(FatVolume_t * volume, uint8_t * fileName, FileStatus_t * status){
+    if(volume==NULL || fileName==NULL || status==NULL){
+        return -3;
+    }
+
+    if(strcmp((char*)fileName, "/") == 0){
+        // The root directory has no directory entry
+        memset(status, 0, sizeof(FileStatus_t));
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        return 0;
+    }
+
+    uint8_t name[MAX_CHAR_FILE_NAME];
+    uint8_t extension[MAX_CHAR_EXTENSION];
+    uint32_t directoryAddress = resolvePath(volume, fileName, name, extension);
+    if(directoryAddress == 0){
+        return -3;
+    }
+
+    Fat16Entry_t entry;
+    uint32_t entryAddress = findDirectoryEntry(volume, directoryAddress, name, extension, &entry);
+    if(entryAddress == 0){
+        // File not found
+        return -1;
+    }
+
+    fillFileStatus(&entry, entryAddress, status);
+    return 0;
+}
+
+int32_t fileSystem_fstat(uint8_t fileDescriptor, FileStatus_t * status){
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor == NULL || status == NULL){
+        return -3;
+    }
+    FatVolume_t * volume = descriptor->volume;
+
+    if(descriptor->isDirectory){
+        memset(status, 0, sizeof(FileStatus_t));
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        return 0;
+    }
+
+    // Times are taken from the directory entry, the size from the descriptor, which is ahead of the
+    // directory entry while the file is being written
+    uint8_t buffer[STORAGE_SECTOR_SIZE];
+    uint32_t offsetInSector = descriptor->directoryEntryAddress % STORAGE_SECTOR_SIZE;
+    if(blockCache_readSector(volume->device, buffer, descriptor->directoryEntryAddress - offsetInSector) != STORAGE_SECTOR_SIZE){
+        return -2;
+    }
+
+    Fat16Entry_t entry;
+    memcpy(&entry, buffer + offsetInSector, sizeof(Fat16Entry_t));
+    fillFileStatus(&entry, descriptor->directoryEntryAddress, status);
+    status->size = descriptor->fileSize;
+    return 0;
+}
+
+void fileSystem_closeFile(uint8_t fileDescriptor){
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor == NULL){
+        return;
+    }
+    FatVolume_t * volume = descriptor->volume;
+
+    if(descriptor->isWritable){
+        // Make the written data persistent
+        if(descriptor->isDirectoryEntryDirty){
+            writeDirectoryEntry(descriptor);
+        }
+        flushFatSector(volume);
+        writeFsInfo(volume);
+        blockCache_flush();
+    }
+
+    // Free slot
+    descriptor->isSlotTaken = 0;
+}
+
+/*
+ * Returns the descriptor of an opened file, or NULL if the file descriptor is invalid.
+ */
+FileDescriptor_t * getOpenFileDescriptor(uint8_t fileDescriptor){
+    if(fileDescriptor>=MAX_NUMBER_FILE_DESCRIPTORS){
+        // Invalid file descriptor
+        return NULL;
+    }
+
+    if(fileDescriptors[fileDescriptor].isSlotTaken==0){
+        // Slot not taken => no file opened for this descriptor
+        return NULL;
+    }
+
+    return &fileDescriptors[fileDescriptor];
+}
+
+/*
+ * Appends the cluster following the indexed part of the cluster chain to the cluster index.
+ * Returns 0 if the cluster starts a new run but all extents are in use.
+ */
+uint8_t indexCluster(FileDescriptor_t * descriptor, uint32_t cluster){
+    Extent_t * lastExtent = &descriptor->extents[descriptor->numberOfExtents - 1];
+
+    if(cluster == lastExtent->firstCluster + lastExtent->numberOfClusters){
+        lastExtent->numberOfClusters++;
+    } else if(descriptor->numberOfExtents < MAX_EXTENTS_PER_FILE){
+        Extent_t * newExtent = &descriptor->extents[descriptor->numberOfExtents];
+        newExtent->firstClusterIndex = descriptor->indexedClusters;
+        newExtent->firstCluster = cluster;
+        newExtent->numberOfClusters = 1;
+        descriptor->numberOfExtents++;
+    } else {
+        return 0;
+    }
+
+    descriptor->indexedClusters++;
+    return 1;
+}
+
+/*
+ * Makes sure the current cluster of the file descriptor is the one containing the current position.
+ * Clusters covered by the cluster index are looked up directly, the FAT is only followed beyond the index.
+ * Returns 0 if the chain ended unexpectedly.
+ */
+uint8_t seekToClusterOfPosition(FileDescriptor_t * descriptor){
+    FatVolume_t * volume = descriptor->volume;
+    uint32_t clusterIndexOfPosition = descriptor->position / volume->clusterSizeInBytes;
+
+    if(descriptor->numberOfExtents == 0){
+        // File without clusters
+        return 0;
+    }
+
+    if(descriptor->currentClusterIndex == clusterIndexOfPosition){
+        return 1;
+    }
+
+    if(clusterIndexOfPosition < descriptor->indexedClusters){
+        uint32_t i = descriptor->numberOfExtents - 1;
+        while(descriptor->extents[i].firstClusterIndex > clusterIndexOfPosition){
+            i--;
+        }
+        descriptor->currentCluster = descriptor->extents[i].firstCluster
+                + (clusterIndexOfPosition - descriptor->extents[i].firstClusterIndex);
+        descriptor->currentClusterIndex = clusterIndexOfPosition;
+        return 1;
+    }
+
+    // Beyond the index: continue from the end of the index, unless the current cluster is closer
+    if(descriptor->currentClusterIndex > clusterIndexOfPosition || descriptor->currentClusterIndex + 1 < descriptor->indexedClusters){
+        Extent_t * lastExtent = &descriptor->extents[descriptor->numberOfExtents - 1];
+        descriptor->currentCluster = lastExtent->firstCluster + lastExtent->numberOfClusters - 1;
+        descriptor->currentClusterIndex = descriptor->indexedClusters - 1;
+    }
+
+    while(descriptor->currentClusterIndex < clusterIndexOfPosition){
+        uint32_t nextCluster = getNextClusterToRead(volume, descriptor->currentCluster);
+        if(isEndOfChain(nextCluster)){
+            return 0;
+        }
+        descriptor->currentCluster = nextCluster;
+        descriptor->currentClusterIndex++;
+
+        if(descriptor->currentClusterIndex == descriptor->indexedClusters){
+            indexCluster(descriptor, nextCluster);
+        }
+    }
+    return 1;
+}
+
+/*
+ * Adapts the readahead window to the access pattern and queues the sectors following the current position
+ * for prefetching. Called after every read through the position of the descriptor, with the position the
+ * read started at, and with the position moved behind a page cache fill (fileSystem_readahead). The current
+ * cluster has to be the one of the last byte read. Other positioned reads leave the state alone.
+ */
+void updateReadahead(FileDescriptor_t * descriptor, uint32_t readStart){
+    FatVolume_t * volume = descriptor->volume;
+    if(readStart == descriptor->previousReadEnd){
+        // Sequential access, grow the window
+        if(descriptor->readaheadWindow == 0){
+            descriptor->readaheadWindow = READAHEAD_MIN_SECTORS;
+        } else if(descriptor->readaheadWindow < READAHEAD_MAX_SECTORS){
+            descriptor->readaheadWindow *= 2;
+        }
+    } else {
+        // Random access, readahead would only waste cache space
+        descriptor->readaheadWindow = 0;
+        descriptor->readaheadPosition = 0;
+    }
+    descriptor->previousReadEnd = descriptor->position;
+
+    if(descriptor->readaheadWindow == 0){
+        return;
+    }
+
+    uint32_t windowInBytes = descriptor->readaheadWindow * STORAGE_SECTOR_SIZE;
+    uint32_t start = descriptor->position - (descriptor->position % STORAGE_SECTOR_SIZE);
+    if(descriptor->readaheadPosition > start){
+        if(descriptor->readaheadPosition - start > windowInBytes / 2){
+            // More than half of the window is still queued or cached, refill later
+            return;
+        }
+        start = descriptor->readaheadPosition;
+    }
+
+    uint32_t end = descriptor->position + windowInBytes;
+    if(end > descriptor->fileSize){
+        end = descriptor->fileSize;
+    }
+    if(end % STORAGE_SECTOR_SIZE != 0){
+        end += STORAGE_SECTOR_SIZE - (end % STORAGE_SECTOR_SIZE);
+    }
+
+    // Walk the cluster chain (without moving the descriptor) and queue one prefetch per cluster
+    uint32_t cluster = descriptor->currentCluster;
+    uint32_t clusterIndex = descriptor->currentClusterIndex;
+    while(start < end){
+        while(clusterIndex < start / volume->clusterSizeInBytes){
+            uint32_t nextCluster = getNextClusterToRead(volume, cluster);
+            if(isEndOfChain(nextCluster)){
+                return;
+            }
+            cluster = nextCluster;
+            clusterIndex++;
+        }
+
+        uint32_t offsetInCluster = start % volume->clusterSizeInBytes;
+        uint32_t bytesToQueue = volume->clusterSizeInBytes - offsetInCluster;
+        if(bytesToQueue > end - start){
+            bytesToQueue = end - start;
+        }
+        blockCache_prefetch(volume->device, getClusterAdressInBytes(volume, cluster) + offsetInCluster, bytesToQueue / STORAGE_SECTOR_SIZE);
+
+        start += bytesToQueue;
+        descriptor->readaheadPosition = start;
+    }
+}
+
+/*
+ * Reads from the current position of the descriptor and advances it.
+ */
+uint32_t readFromPosition(FileDescriptor_t * descriptor, uint8_t * buffer, uint32_t bufferSize){
+    FatVolume_t * volume = descriptor->volume;
+    if(descriptor->position >= descriptor->fileSize){
+        // EOF reached
+        return 0;
+    }
+
+    uint32_t bytesToRead = descriptor->fileSize - descriptor->position;
+    if(bytesToRead > bufferSize){
+        bytesToRead = bufferSize;
+    }
+
+    uint32_t bytesRead = 0;
+    while(bytesRead < bytesToRead){
+        if(!seekToClusterOfPosition(descriptor)){
+            break;
+        }
+
+        uint32_t offsetInCluster = descriptor->position % volume->clusterSizeInBytes;
+        uint32_t offsetInSector = offsetInCluster % STORAGE_SECTOR_SIZE;
+        uint32_t sectorAddress = getClusterAdressInBytes(volume, descriptor->currentCluster) + (offsetInCluster - offsetInSector);
+        uint32_t bytesRemaining = bytesToRead - bytesRead;
+        uint32_t bytesCopied;
+
+        if(offsetInSector == 0 && bytesRemaining >= STORAGE_SECTOR_SIZE){
+            // Whole sectors: read them straight into the caller's buffer, up to the end of the current cluster
+            uint32_t sectorsRemainingInCluster = (volume->clusterSizeInBytes - offsetInCluster) / STORAGE_SECTOR_SIZE;
+            uint32_t sectorsToRead = bytesRemaining / STORAGE_SECTOR_SIZE;
+            if(sectorsToRead > sectorsRemainingInCluster){
+                sectorsToRead = sectorsRemainingInCluster;
+            }
+
+            bytesCopied = blockCache_readSectors(volume->device, buffer + bytesRead, sectorAddress, sectorsToRead);
+            if(bytesCopied != sectorsToRead * STORAGE_SECTOR_SIZE){
+                // Some unexpected error occurred, only report complete sectors
+                bytesCopied -= bytesCopied % STORAGE_SECTOR_SIZE;
+                descriptor->position += bytesCopied;
+                bytesRead += bytesCopied;
+                break;
+            }
+        } else {
+            // Head or tail of a read which does not cover a whole sector: go through the descriptor's sector buffer
+            if(descriptor->bufferedSectorAddress != sectorAddress){
+                if(blockCache_readSector(volume->device, descriptor->sectorBuffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+                    descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+                    break;
+                }
+                descriptor->bufferedSectorAddress = sectorAddress;
+            }
+
+            bytesCopied = STORAGE_SECTOR_SIZE - offsetInSector;
+            if(bytesCopied > bytesRemaining){
+                bytesCopied = bytesRemaining;
+            }
+            memcpy(buffer + bytesRead, descriptor->sectorBuffer + offsetInSector, bytesCopied);
+        }
+
+        descriptor->position += bytesCopied;
+        bytesRead += bytesCopied;
+    }
+
+    return bytesRead;
+}
 
-    // Max size is: size of filename + size of dot + size of extension + size of null termination + 3 chars for special filenames (starting with / and ending with ~X)
-    static uint8_t fileNameToReturn[MAX_CHAR_FILE_NAME + MAX_CHAR_EXTENSION + 5];
+uint32_t fileSystem_readBytes(uint8_t fileDescriptor, uint8_t * buffer, uint32_t bufferSize){
+    if(buffer==NULL){
+        return 0;
+    }
 
-    uint32_t i = 0;
-    for(i = 0; i < (fileSystemState.maximumNumberOfEntriesInRoot*4); i+=sizeof(Fat16Entry_t)){
-        if(i%STORAGE_SECTOR_SIZE == 0){
-            readSector(buf, addressOfNextDirectoryToOpen+i);
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL){
+        return 0;
+    }
+
+    uint32_t readStart = descriptor->position;
+    uint32_t bytesRead = readFromPosition(descriptor, buffer, bufferSize);
+    if(readStart < descriptor->fileSize){
+        updateReadahead(descriptor, readStart);
+    }
+
+    return bytesRead;
+}
+
+uint32_t fileSystem_readBytesAt(uint8_t fileDescriptor, uint8_t * buffer, uint32_t bufferSize, uint32_t offset){
+    if(buffer==NULL){
+        return 0;
+    }
+
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL){
+        return 0;
+    }
+
+    // The current cluster is moved along, it is found again through the cluster index. The readahead state
+    // belongs to the reads through the position, so a pread in between does not end their sequential run.
+    uint32_t savedPosition = descriptor->position;
+    descriptor->position = offset;
+    uint32_t bytesRead = readFromPosition(descriptor, buffer, bufferSize);
+    descriptor->position = savedPosition;
+
+    return bytesRead;
+}
+
+void fileSystem_readahead(uint8_t fileDescriptor, uint32_t offset, uint32_t size){
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL || size == 0 || offset >= descriptor->fileSize){
+        return;
+    }
+
+    // Page cache reads do not move the position, the readahead runs as if they had
+    uint32_t savedPosition = descriptor->position;
+    descriptor->position = offset + size - 1;
+    if(seekToClusterOfPosition(descriptor)){
+        descriptor->position = offset + size;
+        updateReadahead(descriptor, offset);
+    }
+    descriptor->position = savedPosition;
+}
+
+int32_t fileSystem_seek(uint8_t fileDescriptor, int32_t offset, uint8_t origin){
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL){
+        return -1;
+    }
+
+    int32_t newPosition;
+    switch(origin){
+    case SEEK_SET:
+        newPosition = offset;
+        break;
+    case SEEK_CUR:
+        newPosition = (int32_t)descriptor->position + offset;
+        break;
+    case SEEK_END:
+        newPosition = (int32_t)descriptor->fileSize + offset;
+        break;
+    default:
+        return -1;
+    }
+
+    if(newPosition < 0){
+        return -1;
+    }
+
+    // The cluster of the new position is looked up on the next read
+    descriptor->position = newPosition;
+    return newPosition;
+}
+
+/*
+ * Adds a cluster to the end of the cluster chain of the file. For files which already have clusters, the current
+ * cluster of the descriptor must be the last one of the chain (as left by seekToClusterOfPosition when the chain
+ * ended). Returns 0 if the disk is full.
+ */
+uint8_t appendCluster(FileDescriptor_t * descriptor){
+    FatVolume_t * volume = descriptor->volume;
+    if(descriptor->numberOfExtents > 0 && !isEndOfChain(getNextClusterToRead(volume, descriptor->currentCluster))){
+        // Current cluster is not the end of the chain
+        return 0;
+    }
+
+    uint32_t newCluster = allocateCluster(volume);
+    if(newCluster == 0){
+        return 0;
+    }
+
+    if(descriptor->numberOfExtents == 0){
+        // First cluster of the file
+        descriptor->beginningOfFileAsClusterNumber = newCluster;
+        descriptor->currentCluster = newCluster;
+        descriptor->currentClusterIndex = 0;
+        descriptor->extents[0].firstClusterIndex = 0;
+        descriptor->extents[0].firstCluster = newCluster;
+        descriptor->extents[0].numberOfClusters = 1;
+        descriptor->numberOfExtents = 1;
+        descriptor->indexedClusters = 1;
+        descriptor->isDirectoryEntryDirty = 1;
+        return 1;
+    }
+
+    // The new cluster is added to the cluster index once seekToClusterOfPosition walks onto it
+    return setFatEntry(volume, descriptor->currentCluster, newCluster);
+}
+
+/*
+ * Frees all clusters of the file and sets its size to 0. All descriptors of the file (identified by its
+ * directory entry) are reset, so that none of them keeps using the freed clusters or the old size.
+ */
+void truncateFile(FileDescriptor_t * descriptor){
+    FatVolume_t * volume = descriptor->volume;
+
+    // A descriptor opened earlier may have allocated the first cluster without writing it to the entry yet
+    uint32_t firstCluster = descriptor->beginningOfFileAsClusterNumber;
+    uint32_t i;
+    for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS && firstCluster < 2; i++){
+        FileDescriptor_t * other = &fileDescriptors[i];
+        if(other->isSlotTaken && !other->isDirectory && other->volume == volume
+                && other->directoryEntryAddress == descriptor->directoryEntryAddress){
+            firstCluster = other->beginningOfFileAsClusterNumber;
+        }
+    }
+    if(firstCluster >= 2){
+        freeClusterChain(volume, firstCluster);
+    }
+
+    for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS; i++){
+        FileDescriptor_t * other = &fileDescriptors[i];
+        if(other != descriptor && (!other->isSlotTaken || other->isDirectory || other->volume != volume
+                || other->directoryEntryAddress != descriptor->directoryEntryAddress)){
+            continue;
+        }
+        other->beginningOfFileAsClusterNumber = 0;
+        other->currentCluster = 0;
+        other->currentClusterIndex = 0;
+        other->numberOfExtents = 0;
+        other->indexedClusters = 0;
+        other->fileSize = 0;
+        other->position = 0;
+        other->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+        other->previousReadEnd = 0;
+        other->readaheadWindow = 0;
+        other->readaheadPosition = 0;
+    }
+    descriptor->isDirectoryEntryDirty = 1;
+}
+
+/*
+ * Drops the buffered sector of all descriptors (except the given one) whose buffered sector lies within the
+ * count sectors starting at address, because it has been overwritten.
+ */
+void invalidateBufferedSectors(FatVolume_t * volume, uint32_t address, uint32_t count, FileDescriptor_t * except){
+    uint32_t endAddress = address + count * STORAGE_SECTOR_SIZE;
+    uint32_t i;
+    for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS; i++){
+        FileDescriptor_t * descriptor = &fileDescriptors[i];
+        if(descriptor != except && descriptor->volume == volume && descriptor->bufferedSectorAddress >= address && descriptor->bufferedSectorAddress < endAddress){
+            descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+        }
+    }
+}
+
+/*
+ * Writes at the current position of the descriptor and advances it. Clusters are allocated as needed.
+ * The new size of the file is only written to the directory entry on close or sync.
+ */
+uint32_t writeToPosition(FileDescriptor_t * descriptor, const uint8_t * buffer, uint32_t bufferSize){
+    FatVolume_t * volume = descriptor->volume;
+    if(descriptor->position > descriptor->fileSize){
+        // Fill the gap behind the end of the file with zeros
+        static const uint8_t zeros[STORAGE_SECTOR_SIZE] = { 0 };
+        uint32_t targetPosition = descriptor->position;
+        descriptor->position = descriptor->fileSize;
+        while(descriptor->position < targetPosition){
+            uint32_t bytesToFill = targetPosition - descriptor->position;
+            if(bytesToFill > STORAGE_SECTOR_SIZE){
+                bytesToFill = STORAGE_SECTOR_SIZE;
+            }
+            if(writeToPosition(descriptor, zeros, bytesToFill) != bytesToFill){
+                return 0;
+            }
         }
+    }
 
-        // Copy current position to a FAT16 entry
-        memcpy((void*)&currentEntry, buf+(i%STORAGE_SECTOR_SIZE), sizeof(currentEntry));
+    uint32_t bytesWritten = 0;
+    while(bytesWritten < bufferSize){
+        while(!seekToClusterOfPosition(descriptor)){
+            if(!appendCluster(descriptor)){
+                // Disk full
+                return bytesWritten;
+            }
+        }
 
-        if((currentEntry.filename[0]!=FAT16_UNDEFINED_FILENAME_START_CHAR) && ((currentEntry.attributes == FAT16_DIRECTORY_ENTRY) || (currentEntry.attributes == FAT16_ARCHIVE_ENTRY))){
-            if(fileEntriesToSkip == 0){
-                // File name to be returned must be reinitialized, in case there are some leftover chars
-                memset(fileNameToReturn, ' ', MAX_CHAR_FILE_NAME + MAX_CHAR_EXTENSION + 5);
+        uint32_t offsetInCluster = descriptor->position % volume->clusterSizeInBytes;
+        uint32_t offsetInSector = offsetInCluster % STORAGE_SECTOR_SIZE;
+        uint32_t sectorAddress = getClusterAdressInBytes(volume, descriptor->currentCluster) + (offsetInCluster - offsetInSector);
+        uint32_t bytesRemaining = bufferSize - bytesWritten;
+        uint32_t bytesCopied;
+
+        if(offsetInSector == 0 && bytesRemaining >= STORAGE_SECTOR_SIZE){
+            // Whole sectors, up to the end of the current cluster
+            uint32_t sectorsRemainingInCluster = (volume->clusterSizeInBytes - offsetInCluster) / STORAGE_SECTOR_SIZE;
+            uint32_t sectorsToWrite = bytesRemaining / STORAGE_SECTOR_SIZE;
+            if(sectorsToWrite > sectorsRemainingInCluster){
+                sectorsToWrite = sectorsRemainingInCluster;
+            }
 
-                strncpy((char*)fileNameToReturn, (char*)currentEntry.filename, MAX_CHAR_FILE_NAME);
-                if(currentEntry.attributes == FAT16_ARCHIVE_ENTRY){
-                    // Add '.' and extension
-                    fileNameToReturn[MAX_CHAR_FILE_NAME] = '.';
-                    strncpy((char*)(fileNameToReturn+MAX_CHAR_FILE_NAME+1), (char*)currentEntry.ext, MAX_CHAR_EXTENSION);
+            bytesCopied = blockCache_writeSectors(volume->device, buffer + bytesWritten, sectorAddress, sectorsToWrite);
+            invalidateBufferedSectors(volume, sectorAddress, sectorsToWrite, NULL);
+            if(bytesCopied != sectorsToWrite * STORAGE_SECTOR_SIZE){
+                bytesCopied -= bytesCopied % STORAGE_SECTOR_SIZE;
+                descriptor->position += bytesCopied;
+                bytesWritten += bytesCopied;
+                break;
+            }
+        } else {
+            // Part of a sector: modify the sector in the descriptor's sector buffer and write it back
+            if(descriptor->bufferedSectorAddress != sectorAddress){
+                if(descriptor->position - offsetInSector >= descriptor->fileSize){
+                    // Sector lies completely behind the end of the file, no need to read it
+                    memset(descriptor->sectorBuffer, 0, STORAGE_SECTOR_SIZE);
+                } else if(blockCache_readSector(volume->device, descriptor->sectorBuffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+                    descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+                    break;
                 }
-                indexOfLastReadEntry++;
-                fileNameToReturn[MAX_CHAR_FILE_NAME + MAX_CHAR_EXTENSION + 4] = 0;
-                return removeWhiteSpacesFromUint8Array(fileNameToReturn);
-            } else {
-                fileEntriesToSkip--;
+                descriptor->bufferedSectorAddress = sectorAddress;
+            }
+
+            bytesCopied = STORAGE_SECTOR_SIZE - offsetInSector;
+            if(bytesCopied > bytesRemaining){
+                bytesCopied = bytesRemaining;
+            }
+            memcpy(descriptor->sectorBuffer + offsetInSector, buffer + bytesWritten, bytesCopied);
+
+            if(blockCache_writeSector(volume->device, descriptor->sectorBuffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+                descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+                break;
             }
+            invalidateBufferedSectors(volume, sectorAddress, 1, descriptor);
         }
+
+        descriptor->position += bytesCopied;
+        bytesWritten += bytesCopied;
+    }
+
+    if(descriptor->position > descriptor->fileSize){
+        descriptor->fileSize = descriptor->position;
+        descriptor->isDirectoryEntryDirty = 1;
     }
 
-    // Nothing found
-    // reset lastDirName and indexOfLastReadEntry to allow query of same directory from the beginning
-    lastDirName[0] = '\0';
-    indexOfLastReadEntry = 0;
+    return bytesWritten;
+}
+
+uint32_t fileSystem_writeBytes(uint8_t fileDescriptor, const uint8_t * buffer, uint32_t bufferSize){
+    if(buffer==NULL){
+        return 0;
+    }
+
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL || !descriptor->isWritable){
+        return 0;
+    }
+
+    if(descriptor->isAppending){
+        descriptor->position = descriptor->fileSize;
+    }
+
+    return writeToPosition(descriptor, buffer, bufferSize);
+}
+
+/*
+ * Writes directory entries, FAT sector and FSInfo hints of a volume to the block cache. Returns 0 on success.
+ */
+uint32_t syncVolume(FatVolume_t * volume){
+    uint32_t result = 0;
+    uint32_t i;
+    for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS; i++){
+        FileDescriptor_t * descriptor = &fileDescriptors[i];
+        if(descriptor->isSlotTaken && descriptor->volume == volume && descriptor->isDirectoryEntryDirty){
+            if(!writeDirectoryEntry(descriptor)){
+                result = 1;
+            }
+        }
+    }
+
+    if(!flushFatSector(volume)){
+        result = 1;
+    }
+
+    if(!writeFsInfo(volume)){
+        result = 1;
+    }
+    return result;
+}
+
+uint32_t fileSystem_sync(void){
+    uint32_t result = 0;
+    uint32_t i;
+    for(i = 0; i < MAX_FAT_VOLUMES; i++){
+        if(volumes[i].isUsed && syncVolume(&volumes[i])){
+            result = 1;
+        }
+    }
+
+    if(blockCache_flush()){
+        result = 1;
+    }
+    return result;
+}
+
+/*
+ * Starts writing pending modifications to the card. Called by the system timer. The timer interrupt must not
+ * wait for a whole sync, so it is done by syncStep in steps.
+ */
+void periodicSync(PCB_t * currentPcb){
+    isSyncMetadataBlocked = 0;
+    systemTimer_enableSubscription(syncStepSubscription);
+}
+
+/*
+ * Marks the end of the metadata of this sync if a piece could not be moved into the block cache, which is
+ * full of dirty sectors then. Returns 1, the step is used.
+ */
+uint8_t finishMetadataStep(uint8_t isMoved){
+    if(!isMoved){
+        isSyncMetadataBlocked = 1;
+    }
+    return 1;
+}
+
+/*
+ * Moves one piece of modified metadata (a directory entry, the FAT sector or the FsInfo sector of a volume) into
+ * the block cache, which reads one sector from the card at most. Returns 0 if there is none left.
+ */
+uint8_t syncMetadataStep(void){
+    if(isSyncMetadataBlocked){
+        return 0;
+    }
+
+    uint32_t i;
+    for(i = 0; i < MAX_NUMBER_FILE_DESCRIPTORS; i++){
+        FileDescriptor_t * descriptor = &fileDescriptors[i];
+        if(descriptor->isSlotTaken && descriptor->isDirectoryEntryDirty){
+            return finishMetadataStep(writeDirectoryEntry(descriptor));
+        }
+    }
+    for(i = 0; i < MAX_FAT_VOLUMES; i++){
+        FatVolume_t * volume = &volumes[i];
+        if(volume->isUsed && volume->isFatSectorDirty){
+            return finishMetadataStep(flushFatSector(volume));
+        }
+        if(volume->isUsed && volume->fsInfoAddress != 0 && volume->isFsInfoDirty){
+            return finishMetadataStep(writeFsInfo(volume));
+        }
+    }
     return 0;
 }
+
+/*
+ * One step of the periodic sync: moves a piece of metadata into the block cache, or once there is none, writes
+ * one dirty sector to the card. Called by the system timer until nothing is left.
+ */
+void syncStep(PCB_t * currentPcb){
+    if(!syncMetadataStep() && !blockCache_flushSector()){
+        systemTimer_disableSubscription(syncStepSubscription);
+    }
+}
+
+/*
+ * Returns the cluster number of a subdirectory from its address (in bytes).
+ */
+uint32_t getClusterOfAddress(FatVolume_t * volume, uint32_t address){
+    return (address - getClusterAdressInBytes(volume, 2)) / volume->clusterSizeInBytes + 2;
+}
+
+/*
+ * Initializes a free file descriptor for reading the cluster chain starting at startingCluster.
+ */
+void initFileDescriptor(FatVolume_t * volume, FileDescriptor_t * descriptor, uint32_t startingCluster, uint32_t fileSize){
+    descriptor->volume = volume;
+    descriptor->beginningOfFileAsClusterNumber = startingCluster;
+    descriptor->currentCluster = startingCluster;
+    descriptor->currentClusterIndex = 0;
+    descriptor->extents[0].firstClusterIndex = 0;
+    descriptor->extents[0].firstCluster = startingCluster;
+    descriptor->extents[0].numberOfClusters = 1;
+    // Empty files do not have a cluster
+    descriptor->numberOfExtents = (startingCluster >= 2) ? 1 : 0;
+    descriptor->indexedClusters = descriptor->numberOfExtents;
+    descriptor->fileSize = fileSize;
+    descriptor->position = 0;
+    descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+    descriptor->previousReadEnd = 0;
+    descriptor->readaheadWindow = 0;
+    descriptor->readaheadPosition = 0;
+    descriptor->directoryEntryAddress = 0;
+    descriptor->isDirectoryEntryDirty = 0;
+    descriptor->isWritable = 0;
+    descriptor->isAppending = 0;
+    descriptor->isDirectory = 0;
+}
+
+int16_t fileSystem_openDirectory(FatVolume_t * volume, uint8_t * dirName){
+    if(volume==NULL || dirName==NULL || *dirName != '/'){
+        return -3;
+    }
+
+    uint32_t directoryAddress = volume->rootDirectoryAddress;
+    uint8_t currentDirName[MAX_CHAR_FILE_NAME];
+
+    // Follow the path component by component, empty components (e.g. a trailing '/') are ignored
+    uint8_t * currentName = dirName + 1;
+    while(*currentName != '\0'){
+        uint8_t * nextDelimiter = (uint8_t*)strchr((char*)currentName, PATH_DELIMITER);
+        uint32_t nameLength = (nextDelimiter != NULL) ? nextDelimiter - currentName : strlen((char*)currentName);
+
+        if(nameLength > MAX_CHAR_FILE_NAME){
+            return -3;
+        }
+        if(nameLength > 0){
+            memset(currentDirName, ' ', MAX_CHAR_FILE_NAME);
+            memcpy(currentDirName, currentName, nameLength);
+            directoryAddress = getNextDirectory(volume, currentDirName, directoryAddress);
+            if(directoryAddress == 0){
+                // Not a directory, or does not exist
+                return -3;
+            }
+        }
+
+        currentName += nameLength;
+        if(*currentName == PATH_DELIMITER){
+            currentName++;
+        }
+    }
+
+    int16_t fileDescriptor = getNextFreeFileDescriptorSlot();
+    if(fileDescriptor==-1){
+        return -1;
+    }
+
+    FileDescriptor_t * descriptor = &fileDescriptors[fileDescriptor];
+    if(isFixedRootDirectory(volume, directoryAddress)){
+        // The root directory is a fixed area in front of the clusters
+        initFileDescriptor(volume, descriptor, 0, volume->maximumNumberOfEntriesInRoot * sizeof(Fat16Entry_t));
+    } else {
+        // Subdirectories have no size, they end with their cluster chain
+        initFileDescriptor(volume, descriptor, getClusterOfAddress(volume, directoryAddress), 0xFFFFFFFF);
+    }
+    descriptor->isDirectory = 1;
+    descriptor->isSlotTaken = 1;
+
+    return fileDescriptor;
+}
+
+/*
+ * Copies an 8.3 name (padded with spaces) into name as "NAME.EXT", or "NAME" if the extension is empty.
+ */
+void formatFileName(char * name, uint8_t * fileName, uint8_t * extension){
+    uint32_t length = 0;
+    uint32_t i;
+    for(i = 0; i < MAX_CHAR_FILE_NAME && fileName[i] != ' '; i++){
+        name[length++] = fileName[i];
+    }
+    if(extension[0] != ' '){
+        name[length++] = '.';
+        for(i = 0; i < MAX_CHAR_EXTENSION && extension[i] != ' '; i++){
+            name[length++] = extension[i];
+        }
+    }
+    name[length] = '\0';
+}
+
+int32_t fileSystem_readDirectory(uint8_t fileDescriptor, uint32_t * position, DirectoryEntry_t * entries, uint32_t count){
+    FileDescriptor_t * descriptor = getOpenFileDescriptor(fileDescriptor);
+    if(descriptor==NULL || !descriptor->isDirectory || position==NULL || entries==NULL){
+        return -1;
+    }
+    FatVolume_t * volume = descriptor->volume;
+
+    uint32_t entriesRead = 0;
+    while(entriesRead < count && *position < descriptor->fileSize){
+        uint32_t entryAddress;
+        if(descriptor->beginningOfFileAsClusterNumber == 0){
+            entryAddress = volume->rootDirectoryAddress + *position;
+        } else {
+            descriptor->position = *position;
+            if(!seekToClusterOfPosition(descriptor)){
+                // End of the cluster chain
+                break;
+            }
+            entryAddress = getClusterAdressInBytes(volume, descriptor->currentCluster) + (*position % volume->clusterSizeInBytes);
+        }
+
+        uint32_t offsetInSector = entryAddress % STORAGE_SECTOR_SIZE;
+        uint32_t sectorAddress = entryAddress - offsetInSector;
+        if(descriptor->bufferedSectorAddress != sectorAddress){
+            if(blockCache_readSector(volume->device, descriptor->sectorBuffer, sectorAddress) != STORAGE_SECTOR_SIZE){
+                descriptor->bufferedSectorAddress = INVALID_SECTOR_ADDRESS;
+                return entriesRead > 0 ? entriesRead : -1;
+            }
+            descriptor->bufferedSectorAddress = sectorAddress;
+        }
+
+        Fat16Entry_t * entry = (Fat16Entry_t*)(descriptor->sectorBuffer + offsetInSector);
+        if(entry->filename[0] == FAT16_END_OF_DIRECTORY_CHAR){
+            // No entries behind this one
+            break;
+        }
+        *position += sizeof(Fat16Entry_t);
+
+        if(entry->filename[0] == FAT16_UNDEFINED_FILENAME_START_CHAR || entry->filename[0] == '.'
+                || (entry->attributes & FAT16_VOLUME_LABEL_ENTRY)){
+            continue;
+        }
+
+        DirectoryEntry_t * directoryEntry = &entries[entriesRead++];
+        formatFileName(directoryEntry->name, entry->filename, entry->ext);
+        if(entry->attributes & FAT16_DIRECTORY_ENTRY){
+            directoryEntry->type = DIRECTORY_ENTRY_DIRECTORY;
+            directoryEntry->size = 0;
+        } else {
+            directoryEntry->type = DIRECTORY_ENTRY_FILE;
+            directoryEntry->size = entry->file_size;
+        }
+    }
+
+    return entriesRead;
+}
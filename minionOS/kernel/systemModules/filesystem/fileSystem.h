@@ -9,19 +9,21 @@
 #define FILESYSTEM_H_
 
 #include <inttypes.h>
+#include "directoryEntry.h"
+#include "fileStatus.h"
+#include "blockDevice.h"
 
-#define FAT_16_LBA_PARTITION_TYPE 14
+// Number of FAT volumes which can be mounted at the same time
+#define MAX_FAT_VOLUMES 4
 
+// Size of the root directory of volumes written by fileSystem_format (one sector)
+#define FORMAT_ROOT_ENTRIES 16
 
-// Partition table
-typedef struct{
-    uint8_t isBootable;
-	uint8_t partitionStartCHS[3];
-	uint8_t partitionType;
-	uint8_t partitionEndCHS[3];
-	uint32_t relativeOffsetPartitionSectors;
-	uint32_t partitionSizeInSectors;
-}__attribute((packed)) PartitionTable_t;
+// Signatures of the FAT32 FSInfo sector
+#define FSINFO_LEAD_SIGNATURE   0x41615252
+#define FSINFO_STRUCT_SIGNATURE 0x61417272
+// Free cluster count or next free cluster not known
+#define FSINFO_UNKNOWN          0xFFFFFFFF
 
 
 // FAT16 boot sector
@@ -41,7 +43,7 @@ typedef struct{
     uint32_t numHiddenSectorsBeforeBoot;
     uint32_t numSectorsOnDiskForGT32MB;
 
-    /* FAT 32 missing, only FAT16 supported */
+    /* FAT16 extended boot record, FAT32 see FAT32BootSector_t */
 
     uint8_t driveNumber;
     uint8_t currentHead;
@@ -53,18 +55,71 @@ typedef struct{
     uint16_t bootSectorSignature; // 0xAA55 instead of 0x55AA because of byte ordering
 } __attribute((packed)) FAT16BootSector_t;
 
+// FAT32 boot sector, same as the FAT16 boot sector up to numSectorsOnDiskForGT32MB
+typedef struct{
+    uint8_t jumpInstruction80x86[3];
+    uint8_t oemName[8];
+    uint16_t sectorSizeInBytes;
+    uint8_t numberOfSectorsPerCluster;
+    uint16_t reservedSectors;
+    uint8_t numberOfFATs;
+    uint8_t numberOfEntriesInRoot[2]; // Always 0
+    uint16_t numSectorsOnDiskForLTE32MB; // Always 0
+    uint8_t mediaDescriptor;
+    uint16_t numSectorsPerFATTable; // Always 0, see numSectorsPerFATTable32
+    uint16_t numSectorsPerTrackCHS;
+    uint16_t numHeadsCHS;
+    uint32_t numHiddenSectorsBeforeBoot;
+    uint32_t numSectorsOnDiskForGT32MB;
+
+    uint32_t numSectorsPerFATTable32;
+    uint16_t extendedFlags; // Bit 7 set: only the FAT with the number in bits 0-3 is used
+    uint16_t fileSystemVersion;
+    uint32_t rootDirectoryCluster;
+    uint16_t fsInfoSector; // Relative to the boot sector
+    uint16_t backupBootSector;
+    uint8_t reserved[12];
+
+    uint8_t driveNumber;
+    uint8_t currentHead;
+    uint8_t bootSignature;
+    uint32_t volumeId;
+    uint8_t volumeLabel[11];
+    uint8_t fileSystemType[8];
+    uint8_t bootCode[420];
+    uint16_t bootSectorSignature;
+} __attribute((packed)) FAT32BootSector_t;
+
+// FAT32 FSInfo sector, holds hints for the search of free clusters
+typedef struct{
+    uint32_t leadSignature;
+    uint8_t reserved1[480];
+    uint32_t structSignature;
+    uint32_t freeClusterCount;
+    uint32_t nextFreeCluster;
+    uint8_t reserved2[12];
+    uint32_t trailSignature;
+} __attribute((packed)) FsInfoSector_t;
+
 // File structure
 typedef struct {
     uint8_t filename[8];
     uint8_t ext[3];
     uint8_t attributes;
-    uint8_t reserved[10];
+    uint8_t reserved[8];
+    uint16_t starting_cluster_high; // FAT32 only
     uint16_t modify_time;
     uint16_t modify_date;
     uint16_t starting_cluster;
     uint32_t file_size;
 } __attribute((packed)) Fat16Entry_t;
 
+// Size of a FAT entry, selects FAT16 or FAT32
+typedef enum{
+    FAT_TYPE_16 = 2,
+    FAT_TYPE_32 = 4
+} FatType_t;
+
 // File system types
 typedef enum{
     UNUSED = 0,
@@ -78,21 +133,40 @@ typedef enum{
     EXTENDED_PARTITION_LBA = 15
 } FileSystemTypes_t;
 
+// A mounted FAT volume
+typedef struct FatVolume FatVolume_t;
+
+/*
+ * Initialize file system - block cache, dentry cache and periodic sync. Must be called before mounting volumes.
+ */
+void fileSystem_init(void);
+
+/*
+ * Mount the FAT volume on the block device (usually a partition registered by blockDevice_scanPartitions) - read
+ * most important information about the file system in a volume struct. FAT16 (partition type 14) and FAT32
+ * (partition types 11 and 12) are supported, devices which are not partitions must start with a FAT boot sector.
+ * Returns the volume, or NULL if the device holds no supported FAT volume or too many volumes are mounted.
+ */
+FatVolume_t * fileSystem_mount(BlockDevice_t * device);
+
 /*
- * Initialize file system - read most important information about the file system in a module-global struct.
+ * Write an empty FAT16 volume (one sector per cluster, one FAT, root directory of FORMAT_ROOT_ENTRIES entries)
+ * onto the whole block device, e.g. a RAM disk. The device must not be mounted.
+ * Returns 0 on success, or 1 if the block size is not supported or the device is too small or too large.
  */
-uint32_t filesystem_Initialize(void);
+uint32_t fileSystem_format(BlockDevice_t * device);
 
 /*
- * Open file specified by fileName. Path must be absolute, with UNIX-style separation '/'.
+ * Open file specified by fileName on a mounted volume. Path must be absolute, with UNIX-style separation '/'.
  * Use ALL CAPS for both directories and file names (because that's how FAT16 saves files on disk).
  * fileName parameter is guaranteed to NOT be changed by the function.
+ * flags is a combination of the OPEN_* flags (openFlags.h), 0 opens the file for reading only.
  * Returns: negative number in case of error, or a file descriptor (positive integer).
  */
-int16_t fileSystem_openFile(uint8_t * fileName);
+int16_t fileSystem_openFile(FatVolume_t * volume, uint8_t * fileName, uint8_t flags);
 
 /*
- * Close a file (free the file descriptor).
+ * Close a file (free the file descriptor). Modifications of files opened for writing are written to the card.
  */
 void fileSystem_closeFile(uint8_t fileDescriptor);
 
@@ -104,9 +178,63 @@ void fileSystem_closeFile(uint8_t fileDescriptor);
 uint32_t fileSystem_readBytes(uint8_t fileDescriptor, uint8_t * buffer, uint32_t bufferSize);
 
 /*
- * Returns the next entry in the directory. If no entries are available, 0 is returned.
+ * Same as fileSystem_readBytes, but reads from the given offset of the file. The position used by
+ * fileSystem_readBytes is not changed.
+ */
+uint32_t fileSystem_readBytesAt(uint8_t fileDescriptor, uint8_t * buffer, uint32_t bufferSize, uint32_t offset);
+
+/*
+ * Tells the descriptor that size bytes at offset have just been read with fileSystem_readBytesAt (a page cache
+ * fill). If this continues the previous read, the sectors following it are queued for prefetching, like after
+ * fileSystem_readBytes.
+ */
+void fileSystem_readahead(uint8_t fileDescriptor, uint32_t offset, uint32_t size);
+
+/*
+ * Sets the position of the next read. The offset is relative to the beginning of the file, the current position or the
+ * end of the file, depending on origin (SEEK_SET, SEEK_CUR or SEEK_END). Positions beyond the end of the file are allowed.
+ * Returns the new position, or a negative number in case of error.
+ */
+int32_t fileSystem_seek(uint8_t fileDescriptor, int32_t offset, uint8_t origin);
+
+/*
+ * Write bytes at the current position of a file opened with OPEN_WRITE (or at its end, if opened with OPEN_APPEND).
+ * The file grows as needed. Writes are cached: data, FAT and directory entry reach the card on close, on
+ * fileSystem_sync or by the periodic sync of the file system.
+ * Returns number of bytes written, which is smaller than bufferSize if the disk is full or an error occurred.
+ */
+uint32_t fileSystem_writeBytes(uint8_t fileDescriptor, const uint8_t * buffer, uint32_t bufferSize);
+
+/*
+ * Write all pending modifications of all volumes to their devices. Returns 0 on success.
+ */
+uint32_t fileSystem_sync(void);
+
+/*
+ * Open the directory specified by dirName (absolute path, a trailing '/' is allowed) for reading its entries.
+ * The returned descriptor must be closed with fileSystem_closeFile.
+ * Returns: negative number in case of error, or a file descriptor (positive integer).
+ */
+int16_t fileSystem_openDirectory(FatVolume_t * volume, uint8_t * dirName);
+
+/*
+ * Read up to count entries of an opened directory, starting at *position (0 for the first entry), and advance
+ * *position behind the entries read. Deleted entries, volume labels, long file name entries and the entries
+ * "." and ".." are skipped.
+ * Returns the number of entries read, 0 once all entries have been read, or a negative number in case of error.
+ */
+int32_t fileSystem_readDirectory(uint8_t fileDescriptor, uint32_t * position, DirectoryEntry_t * entries, uint32_t count);
+
+/*
+ * Get size, type and modification time of the file or directory specified by fileName (absolute path).
+ * Returns 0 on success, or a negative number if the path is invalid or the file does not exist.
+ */
+int32_t fileSystem_stat(FatVolume_t * volume, uint8_t * fileName, FileStatus_t * status);
+
+/*
+ * Same as fileSystem_stat, for an opened file or directory. The size includes data written but not yet synced.
  */
-uint8_t * fileSystem_getNextEntryInDirectory(uint8_t * dirName);
+int32_t fileSystem_fstat(uint8_t fileDescriptor, FileStatus_t * status);
 
 
 #endif
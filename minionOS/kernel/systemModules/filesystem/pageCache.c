@@ -0,0 +1,300 @@
+/*
+ * pageCache.c
+ *
+ *      Every cached page owns a frame of the frame pool, so the entry of a page is the one with the index of its
+ *      frame. Entries are chained into hash buckets. Eviction uses the clock algorithm: the hand skips pinned
+ *      pages and gives recently used ones a second chance.
+ */
+
+#include "pageCache.h"
+#include "kernel/systemModules/mmu/mmu.h"
+#include "global/types.h"
+#include <string.h>
+
+#define PAGE_CACHE_ENTRIES NR_OF_FRAMES_IN_FRAME_POOL
+
+// Number of hash buckets, must be a power of two
+#define PAGE_CACHE_BUCKETS 128
+
+// Marks the end of a bucket chain
+#define NO_ENTRY -1
+
+typedef struct {
+    uint16_t device;
+    uint32_t fileId;
+    uint32_t pageIndex;
+
+    uint32_t frame;
+    // Bytes of the file in the page, the rest of the page is 0
+    uint16_t length;
+
+    // Number of users which need the frame to stay (mappings), the page is not evicted while pinned
+    uint16_t pinCount;
+
+    // The entry holds a frame / is found by its file (pinned pages of invalidated files are not)
+    uint8_t isUsed;
+    uint8_t isLinked;
+
+    // Set on every access, cleared by the clock hand
+    uint8_t isReferenced;
+
+    // Next entry in the same bucket
+    int16_t next;
+    uint16_t bucket;
+} PageCacheEntry_t;
+
+static PageCacheEntry_t g_entries[PAGE_CACHE_ENTRIES];
+static int16_t g_buckets[PAGE_CACHE_BUCKETS];
+static uint16_t g_clockHand;
+
+static PageCacheStatistics_t g_statistics;
+
+/*
+ * FNV-1a hash of the file and the page index.
+ */
+static uint16_t hashPage(uint16_t device, uint32_t fileId, uint32_t pageIndex){
+    uint32_t key[3] = {device, fileId, pageIndex};
+    uint32_t hash = 2166136261u;
+    uint32_t i;
+    for(i = 0; i < 3 * sizeof(uint32_t); i++){
+        hash = (hash ^ ((key[i / 4] >> (8 * (i % 4))) & 0xFF)) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & (PAGE_CACHE_BUCKETS - 1);
+}
+
+/*
+ * Returns the index of the entry of the page, or NO_ENTRY if the page is not cached.
+ */
+static int16_t findEntry(uint16_t bucket, uint16_t device, uint32_t fileId, uint32_t pageIndex){
+    int16_t i = g_buckets[bucket];
+    while(i != NO_ENTRY){
+        PageCacheEntry_t * entry = &g_entries[i];
+        if(entry->pageIndex == pageIndex && entry->fileId == fileId && entry->device == device){
+            return i;
+        }
+        i = entry->next;
+    }
+    return NO_ENTRY;
+}
+
+/*
+ * Removes an entry from its bucket chain, the page keeps its frame.
+ */
+static void unlinkEntry(int16_t index){
+    int16_t * link = &g_buckets[g_entries[index].bucket];
+    while(*link != index){
+        link = &g_entries[*link].next;
+    }
+    *link = g_entries[index].next;
+    g_entries[index].isLinked = FALSE;
+}
+
+/*
+ * Drops the page and gives its frame back to the frame pool.
+ */
+static void freeEntry(int16_t index){
+    if(g_entries[index].isLinked){
+        unlinkEntry(index);
+    }
+    g_entries[index].isUsed = FALSE;
+    mmu_freeFrame(g_entries[index].frame);
+}
+
+/*
+ * Reads the page from the file into the frame of the entry. Returns 0 if it could not be read.
+ * On misses of sequential reads, the filesystem is told (readahead, may be NULL) which part of the file has been
+ * read, so that it prefetches the following pages.
+ */
+static uint8_t fillEntry(PageCacheEntry_t * entry, PageCacheFill_t fill, PageCacheReadahead_t readahead, int fileDescriptor){
+    uint32_t offset = entry->pageIndex * PAGE_CACHE_PAGE_SIZE;
+    int bytesRead = fill(fileDescriptor, (uint8_t*)entry->frame, PAGE_CACHE_PAGE_SIZE, offset);
+    if(bytesRead < 0){
+        return 0;
+    }
+    memset((uint8_t*)entry->frame + bytesRead, 0, PAGE_CACHE_PAGE_SIZE - bytesRead);
+    entry->length = bytesRead;
+
+    if(readahead != NULL && bytesRead > 0){
+        readahead(fileDescriptor, offset, bytesRead);
+    }
+    return 1;
+}
+
+/*
+ * Called by the frame allocator when the frame pool is exhausted. Evicts the first page the clock hand finds
+ * neither pinned nor referenced since the hand passed it the last time. Returns 1 if a frame was given back.
+ */
+static int reclaimFrame(void){
+    // Within two rounds, every page not pinned has lost its reference bit
+    uint32_t i;
+    for(i = 0; i < 2 * PAGE_CACHE_ENTRIES; i++){
+        int16_t index = g_clockHand;
+        PageCacheEntry_t * entry = &g_entries[index];
+        g_clockHand = (g_clockHand + 1) % PAGE_CACHE_ENTRIES;
+
+        if(!entry->isUsed || entry->pinCount > 0){
+            continue;
+        }
+        if(entry->isReferenced){
+            entry->isReferenced = FALSE;
+            continue;
+        }
+
+        freeEntry(index);
+        g_statistics.evictions++;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Returns the index of the entry of the page, reading the page if it is not cached, or NO_ENTRY in case of error.
+ */
+static int16_t getEntry(uint16_t device, uint32_t fileId, uint32_t pageIndex, PageCacheFill_t fill,
+                        PageCacheReadahead_t readahead, int fileDescriptor){
+    uint16_t bucket = hashPage(device, fileId, pageIndex);
+    int16_t i = findEntry(bucket, device, fileId, pageIndex);
+    if(i != NO_ENTRY){
+        g_entries[i].isReferenced = TRUE;
+        g_statistics.hits++;
+        return i;
+    }
+
+    // May evict other pages, but not this one as it is not cached
+    uint32_t frame = mmu_allocateFrame();
+    if(frame == 0){
+        return NO_ENTRY;
+    }
+
+    i = mmu_getFrameIndex(frame);
+    PageCacheEntry_t * entry = &g_entries[i];
+    entry->device = device;
+    entry->fileId = fileId;
+    entry->pageIndex = pageIndex;
+    entry->frame = frame;
+    if(!fillEntry(entry, fill, readahead, fileDescriptor)){
+        mmu_freeFrame(frame);
+        return NO_ENTRY;
+    }
+
+    entry->pinCount = 0;
+    entry->isUsed = TRUE;
+    entry->isLinked = TRUE;
+    entry->isReferenced = TRUE;
+    entry->bucket = bucket;
+    entry->next = g_buckets[bucket];
+    g_buckets[bucket] = i;
+    g_statistics.misses++;
+    return i;
+}
+
+void pageCache_init(void){
+    uint32_t i;
+    for(i = 0; i < PAGE_CACHE_BUCKETS; i++){
+        g_buckets[i] = NO_ENTRY;
+    }
+    mmu_setFrameReclaimer(reclaimFrame);
+}
+
+int pageCache_read(uint16_t device, uint32_t fileId, uint32_t pageIndex, PageCacheFill_t fill,
+                   PageCacheReadahead_t readahead, int fileDescriptor, const uint8_t ** data){
+    int16_t i = getEntry(device, fileId, pageIndex, fill, readahead, fileDescriptor);
+    if(i == NO_ENTRY){
+        return -1;
+    }
+    *data = (const uint8_t*)g_entries[i].frame;
+    return g_entries[i].length;
+}
+
+uint32_t pageCache_acquire(uint16_t device, uint32_t fileId, uint32_t pageIndex, PageCacheFill_t fill, int fileDescriptor){
+    int16_t i = getEntry(device, fileId, pageIndex, fill, NULL, fileDescriptor);
+    if(i == NO_ENTRY){
+        return 0;
+    }
+    g_entries[i].pinCount++;
+    return g_entries[i].frame;
+}
+
+void pageCache_release(uint32_t frame){
+    int16_t i = mmu_getFrameIndex(frame);
+    PageCacheEntry_t * entry = &g_entries[i];
+    if(!entry->isUsed || entry->pinCount == 0){
+        return;
+    }
+
+    entry->pinCount--;
+    if(entry->pinCount == 0 && !entry->isLinked){
+        // The file has been invalidated while the page was pinned
+        freeEntry(i);
+    }
+}
+
+/*
+ * Copies the written bytes which fall into the page of the entry into its frame. Bytes of the page before them
+ * which were behind the old end of the file are zeros already.
+ */
+static void patchEntry(PageCacheEntry_t * entry, uint32_t offset, const uint8_t * data, uint32_t size){
+    uint32_t pageStart = entry->pageIndex * PAGE_CACHE_PAGE_SIZE;
+    uint32_t start = (offset > pageStart) ? offset : pageStart;
+    uint32_t end = offset + size;
+    if(end > pageStart + PAGE_CACHE_PAGE_SIZE){
+        end = pageStart + PAGE_CACHE_PAGE_SIZE;
+    }
+
+    if(start < end){
+        memcpy((uint8_t*)entry->frame + (start - pageStart), data + (start - offset), end - start);
+        if(end - pageStart > entry->length){
+            entry->length = end - pageStart;
+        }
+    } else {
+        // The page lies before the written range, the file continues behind it
+        entry->length = PAGE_CACHE_PAGE_SIZE;
+    }
+}
+
+void pageCache_update(uint16_t device, uint32_t fileId, uint32_t offset, const uint8_t * data, uint32_t size){
+    if(size == 0){
+        return;
+    }
+
+    uint32_t firstPage = offset / PAGE_CACHE_PAGE_SIZE;
+    uint32_t lastPage = (offset + size - 1) / PAGE_CACHE_PAGE_SIZE;
+    int16_t i;
+    for(i = 0; i < PAGE_CACHE_ENTRIES; i++){
+        PageCacheEntry_t * entry = &g_entries[i];
+        if(!entry->isLinked || entry->fileId != fileId || entry->device != device){
+            continue;
+        }
+
+        // A last page before the written range now continues with a gap of zeros or with the written bytes
+        uint8_t isWritten = entry->pageIndex >= firstPage && entry->pageIndex <= lastPage;
+        uint8_t isOldEnd = entry->pageIndex < firstPage && entry->length < PAGE_CACHE_PAGE_SIZE;
+        if(!isWritten && !isOldEnd){
+            continue;
+        }
+
+        if(entry->pinCount == 0){
+            freeEntry(i);
+        } else {
+            patchEntry(entry, offset, data, size);
+        }
+    }
+}
+
+void pageCache_invalidateFile(uint16_t device, uint32_t fileId){
+    int16_t i;
+    for(i = 0; i < PAGE_CACHE_ENTRIES; i++){
+        PageCacheEntry_t * entry = &g_entries[i];
+        if(entry->isLinked && entry->fileId == fileId && entry->device == device){
+            if(entry->pinCount == 0){
+                freeEntry(i);
+            } else {
+                unlinkEntry(i);
+            }
+        }
+    }
+}
+
+void pageCache_getStatistics(PageCacheStatistics_t * statistics){
+    memcpy(statistics, &g_statistics, sizeof(PageCacheStatistics_t));
+}
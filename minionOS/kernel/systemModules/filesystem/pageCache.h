@@ -0,0 +1,78 @@
+/*
+ * pageCache.h
+ *
+ *      Cache of file content in pages of 4 KB, keyed by the file (device and fileId, see FileStatus_t) and the
+ *      index of the page within the file. The VFS serves reads of storage backed files from it and memory mapped
+ *      files map its pages, so a file which is read again, loaded twice or mapped by several processes is read
+ *      from the storage only once.
+ *      Pages are frames of the MMU's frame pool. When the pool is exhausted, the MMU has the cache give back
+ *      a page which has not been used recently and is not pinned (mapped).
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_PAGECACHE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_PAGECACHE_H_
+
+#include <inttypes.h>
+
+#define PAGE_CACHE_PAGE_SIZE 4096
+
+// Reads from the file at offset, like the pread operation of FileSystem_t. Used to fill pages.
+typedef int (*PageCacheFill_t)(const int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset);
+
+// Called after a page has been read on a miss, with its offset in the file and the number of bytes read, so that
+// the filesystem can fetch the data following it in the background (like the readahead operation of FileSystem_t)
+typedef void (*PageCacheReadahead_t)(const int fileDescriptor, unsigned int offset, unsigned int size);
+
+typedef struct {
+    // Pages found in the cache / read from the file
+    uint32_t hits;
+    uint32_t misses;
+
+    // Pages given back to the frame pool under memory pressure
+    uint32_t evictions;
+} PageCacheStatistics_t;
+
+/*
+ * Registers the cache with the MMU's frame allocator, which asks it for frames when the pool is exhausted.
+ */
+void pageCache_init(void);
+
+/*
+ * Returns the number of bytes of the file in the page pageIndex (less than the page size for the last page of
+ * the file) and sets *data to the content of the page. A page which is not cached is read with
+ * fill(fileDescriptor, ...), followed by readahead(fileDescriptor, ...) if it is not NULL. *data stays valid until
+ * the cache is used again.
+ * Returns a negative number if the page could not be read or there is no frame for it.
+ */
+int pageCache_read(uint16_t device, uint32_t fileId, uint32_t pageIndex, PageCacheFill_t fill,
+                   PageCacheReadahead_t readahead, int fileDescriptor, const uint8_t ** data);
+
+/*
+ * Same as pageCache_read (without readahead), but the page is pinned, so that it is not evicted until it is released, and its frame
+ * (physical address, e.g. to map it into a process) is returned. Bytes behind the end of the file are 0.
+ * Returns 0 in case of error.
+ */
+uint32_t pageCache_acquire(uint16_t device, uint32_t fileId, uint32_t pageIndex, PageCacheFill_t fill, int fileDescriptor);
+
+/*
+ * Releases a page pinned by pageCache_acquire.
+ */
+void pageCache_release(uint32_t frame);
+
+/*
+ * Called after the size bytes of data have been written at offset of the file. The cached pages which changed
+ * (and a cached last page before the written range, whose end moved) are dropped. Pinned ones are updated in place
+ * from data, without reading the file, so that writers in the interrupt handler do not wait for the storage.
+ * A gap between the old end of the file and offset reads as zeros, like the bytes behind the end of a page.
+ */
+void pageCache_update(uint16_t device, uint32_t fileId, uint32_t offset, const uint8_t * data, uint32_t size);
+
+/*
+ * Drops all pages of the file, e.g. when it is truncated or removed. Pinned pages keep their content for
+ * their users, but are no longer found by the file.
+ */
+void pageCache_invalidateFile(uint16_t device, uint32_t fileId);
+
+void pageCache_getStatistics(PageCacheStatistics_t * statistics);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_PAGECACHE_H_ */
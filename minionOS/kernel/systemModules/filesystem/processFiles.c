@@ -0,0 +1,105 @@
+/*
+ * processFiles.c
+ */
+
+#include "processFiles.h"
+#include "vfs.h"
+#include <stddef.h>
+
+// Marks a free file descriptor
+#define NO_FILE (-1)
+
+#define NUMBER_OF_STD_STREAMS 3
+
+/*
+ * Returns the lowest free file descriptor of the process, or -1 if all are in use.
+ */
+static int getFreeDescriptor(PCB_t* process) {
+    int i;
+    for (i = 0; i < MAX_FILES_PER_PROCESS; ++i) {
+        if (process->files[i] == NO_FILE) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void processFiles_init(PCB_t* process) {
+    int i;
+    for (i = 0; i < MAX_FILES_PER_PROCESS; ++i) {
+        process->files[i] = NO_FILE;
+    }
+
+    for (i = 0; i < NUMBER_OF_STD_STREAMS; ++i) {
+        int file = vfs_openStdStream();
+        if (isValidFile(file)) {
+            process->files[i] = file;
+        }
+    }
+}
+
+/*
+ * Puts a just opened VFS file into the lowest free descriptor of the process, which must be available.
+ */
+static int addFile(PCB_t* process, int file) {
+    if (!isValidFile(file)) {
+        return file;
+    }
+
+    int fileDescriptor = getFreeDescriptor(process);
+    process->files[fileDescriptor] = file;
+    return fileDescriptor;
+}
+
+int processFiles_open(PCB_t* process, const char* fileName, int flags) {
+    if (process == NULL || getFreeDescriptor(process) < 0) {
+        // Too many open files
+        return FILE_NOT_FOUND;
+    }
+    return addFile(process, vfs_open(fileName, flags));
+}
+
+int processFiles_openDirectory(PCB_t* process, const char* dirName) {
+    if (process == NULL || getFreeDescriptor(process) < 0) {
+        return FILE_NOT_FOUND;
+    }
+    return addFile(process, vfs_opendir(dirName));
+}
+
+int processFiles_get(PCB_t* process, int fileDescriptor) {
+    if (process == NULL || fileDescriptor < 0 || fileDescriptor >= MAX_FILES_PER_PROCESS
+            || process->files[fileDescriptor] == NO_FILE) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    return process->files[fileDescriptor];
+}
+
+int processFiles_dup(PCB_t* process, int fileDescriptor) {
+    int file = processFiles_get(process, fileDescriptor);
+    if (!isValidFile(file)) {
+        return file;
+    }
+
+    int newFileDescriptor = getFreeDescriptor(process);
+    if (newFileDescriptor < 0) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+
+    process->files[newFileDescriptor] = vfs_dup(file);
+    return newFileDescriptor;
+}
+
+void processFiles_close(PCB_t* process, int fileDescriptor) {
+    int file = processFiles_get(process, fileDescriptor);
+    if (isValidFile(file)) {
+        vfs_close(file);
+        process->files[fileDescriptor] = NO_FILE;
+    }
+}
+
+void processFiles_closeAll(PCB_t* process) {
+    int i;
+    for (i = 0; i < MAX_FILES_PER_PROCESS; ++i) {
+        processFiles_close(process, i);
+    }
+}
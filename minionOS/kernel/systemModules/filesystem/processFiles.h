@@ -0,0 +1,47 @@
+/*
+ * processFiles.h
+ *
+ *      File descriptor tables of processes. A file descriptor of a process is an index into the table
+ *      in its PCB, which refers to a (reference counted) VFS file. Descriptors 0 to 2 are the standard streams.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_PROCESSFILES_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_PROCESSFILES_H_
+
+#include "kernel/systemModules/processManagement/contextSwitch.h"
+
+/*
+ * Initializes the file descriptor table of a new process with the standard streams.
+ */
+void processFiles_init(PCB_t* process);
+
+/*
+ * Opens a file for the process. Returns the lowest free file descriptor, or a negative number in case of error.
+ */
+int processFiles_open(PCB_t* process, const char* fileName, int flags);
+
+/*
+ * Opens a directory for the process (see vfs_opendir). Returns the lowest free file descriptor, or a negative
+ * number in case of error.
+ */
+int processFiles_openDirectory(PCB_t* process, const char* dirName);
+
+/*
+ * Returns the VFS file of a file descriptor of the process, or INVALID_FILE_DESCRIPTOR.
+ */
+int processFiles_get(PCB_t* process, int fileDescriptor);
+
+/*
+ * Creates a new file descriptor (the lowest free one) referring to the same file as fileDescriptor.
+ * Returns the new descriptor, or a negative number in case of error.
+ */
+int processFiles_dup(PCB_t* process, int fileDescriptor);
+
+void processFiles_close(PCB_t* process, int fileDescriptor);
+
+/*
+ * Closes all file descriptors of the process, called when the process exits.
+ */
+void processFiles_closeAll(PCB_t* process);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_PROCESSFILES_H_ */
@@ -4,14 +4,11 @@
 #include <string.h>
 #include <stdlib.h>
 
-#define stringStartsWith(str1, str2) (strncmp(str1, str2, strlen(str2)))
-
-#define IPC_FOLDER      "/ipc/"
-
-int processFs_open(const char* fileName) {
+int processFs_open(void* mountData, const char* fileName, int flags) {
     // TODO only allow currently used PIDs
-    if (stringStartsWith(fileName, IPC_FOLDER) == 0) {
-        return atoi(fileName + strlen(IPC_FOLDER));
+    // fileName is relative to the mount point, e.g. "/3"
+    if (fileName[1] != '\0') {
+        return atoi(fileName + 1);
     } else {
         return FILE_NOT_FOUND;
     }
@@ -38,34 +35,59 @@ int processFs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize)
     }
 }
 
-void processFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+int processFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
     char message[MAX_MESSAGE_LENGTH] = {};
     int bytesToCopy = (MAX_MESSAGE_LENGTH - 1) > bufferSize ? bufferSize : MAX_MESSAGE_LENGTH - 1;
     memcpy(message, buffer, bytesToCopy);
     ipc_message(fileDescriptor, message);
+    return bytesToCopy;
 }
 
-const char* processFs_readdir(const char* dirName) {
-    static unsigned int consecutiveCall;
-    static char previousDir[100];
-    if (strcmp(dirName, previousDir) == 0) {
-        consecutiveCall += 1;
-    } else {
-        strncpy(previousDir, dirName, sizeof(previousDir) - 1);
-    }
+int processFs_lseek(int fileDescriptor, int offset, int origin) {
+    // Message queues are streams
+    return FILE_NOT_SEEKABLE;
+}
 
-    if (strcmp(dirName, "/") == 0) {
-        if (consecutiveCall == 0) {
-            return "ipc";
-        }
-    } else if (stringStartsWith(dirName, IPC_FOLDER) == 0) {
-        // TODO return running processes
-    }
-    consecutiveCall = 0;
-    previousDir[0] = '\0';
-    return NULL;
+int processFs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    return FILE_NOT_SEEKABLE;
+}
+
+int processFs_opendir(void* mountData, const char* dirName) {
+    // Only the mount point itself is a directory
+    return strcmp(dirName, "/") == 0 ? 0 : FILE_NOT_FOUND;
+}
+
+int processFs_getdents(int directory, uint32_t* position, DirectoryEntry_t* entries, unsigned int count) {
+    // TODO return running processes
+    return 0;
 }
 
+void processFs_closedir(int directory) {
+    // NO OP
+}
+
+int processFs_stat(void* mountData, const char* fileName, FileStatus_t* status) {
+    memset(status, 0, sizeof(FileStatus_t));
+    // Like open, any process id is accepted
+    status->type = strcmp(fileName, "/") == 0 ? DIRECTORY_ENTRY_DIRECTORY : DIRECTORY_ENTRY_DEVICE;
+    return 0;
+}
+
+int processFs_fstat(int fileDescriptor, FileStatus_t* status) {
+    memset(status, 0, sizeof(FileStatus_t));
+    status->type = DIRECTORY_ENTRY_DEVICE;
+    return 0;
+}
+
+int processFs_unlink(void* mountData, const char* fileName) {
+    // Message queues exist as long as their process
+    FileStatus_t status;
+    return processFs_stat(mountData, fileName, &status) == 0 ? OPERATION_NOT_SUPPORTED : FILE_NOT_FOUND;
+}
+
+void processFs_sync() {
+    // NO OP
+}
 
 void processFs_init() {
     // NO OP
@@ -76,6 +98,14 @@ FileSystem_t processFs = {
         .open = processFs_open,
         .read = processFs_read,
         .write = processFs_write,
-        .readdir = processFs_readdir,
+        .lseek = processFs_lseek,
+        .pread = processFs_pread,
+        .opendir = processFs_opendir,
+        .getdents = processFs_getdents,
+        .closedir = processFs_closedir,
+        .stat = processFs_stat,
+        .fstat = processFs_fstat,
+        .unlink = processFs_unlink,
+        .sync = processFs_sync,
         .init = processFs_init
 };
@@ -0,0 +1,36 @@
+/*
+ * ramBlockDevice.c
+ */
+
+#include "ramBlockDevice.h"
+#include <string.h>
+
+// A RAM disk transfers any number of blocks at once
+#define RAM_QUEUE_DEPTH 0xFFFFFFFF
+
+static uint32_t ram_readBlocks(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(firstBlock >= device->numberOfBlocks || count > device->numberOfBlocks - firstBlock){
+        return 0;
+    }
+    memcpy(buffer, (uint8_t*)device->data + firstBlock * RAM_BLOCK_SIZE, count * RAM_BLOCK_SIZE);
+    return count;
+}
+
+static uint32_t ram_writeBlocks(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    if(firstBlock >= device->numberOfBlocks || count > device->numberOfBlocks - firstBlock){
+        return 0;
+    }
+    memcpy((uint8_t*)device->data + firstBlock * RAM_BLOCK_SIZE, buffer, count * RAM_BLOCK_SIZE);
+    return count;
+}
+
+void ramBlockDevice_init(BlockDevice_t * device, const char * name, uint8_t * memory, uint32_t numberOfBlocks){
+    memset(device, 0, sizeof(BlockDevice_t));
+    strncpy(device->name, name, BLOCK_DEVICE_NAME_LENGTH - 1);
+    device->blockSize = RAM_BLOCK_SIZE;
+    device->numberOfBlocks = numberOfBlocks;
+    device->queueDepth = RAM_QUEUE_DEPTH;
+    device->readBlocks = ram_readBlocks;
+    device->writeBlocks = ram_writeBlocks;
+    device->data = memory;
+}
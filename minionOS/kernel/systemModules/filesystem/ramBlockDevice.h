@@ -0,0 +1,21 @@
+/*
+ * ramBlockDevice.h
+ *
+ *      Block device backed by memory. Behaves like a disk without access latency, e.g. for holding a
+ *      FAT image or for measuring the file system layers on their own.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_RAMBLOCKDEVICE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_RAMBLOCKDEVICE_H_
+
+#include "blockDevice.h"
+
+#define RAM_BLOCK_SIZE 512
+
+/*
+ * Initializes device as a RAM disk named name, using numberOfBlocks blocks of memory (RAM_BLOCK_SIZE bytes each).
+ * The device still has to be registered with blockDevice_register.
+ */
+void ramBlockDevice_init(BlockDevice_t * device, const char * name, uint8_t * memory, uint32_t numberOfBlocks);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_RAMBLOCKDEVICE_H_ */
@@ -1,10 +1,24 @@
 #include "sdCardFs.h"
 #include "fileSystem.h"
+#include "blockDevice.h"
+#include "sdCardStorage.h"
+#include "ramBlockDevice.h"
 #include "kernel/hal/mmc_sd/sdCard.h"
 #include <stddef.h>
+#include <stdio.h>
 
-int sdFs_open(const char* fileName) {
-    return fileSystem_openFile((uint8_t*) fileName);
+// Mount path of a volume which is not the first one, "/" followed by the partition name, e.g. "/sd0p2"
+#define VOLUME_MOUNT_PATH_LENGTH (BLOCK_DEVICE_NAME_LENGTH + 1)
+
+// RAM disk mounted at "/ram0" with an empty FAT16 volume, e.g. for testing the FAT layers without a card (128 KB)
+#define RAM_DISK_NAME "ram0"
+#define RAM_DISK_BLOCKS 256
+
+static BlockDevice_t ramDiskDevice;
+static uint8_t ramDiskMemory[RAM_DISK_BLOCKS * RAM_BLOCK_SIZE];
+
+int sdFs_open(void* volume, const char* fileName, int flags) {
+    return fileSystem_openFile(volume, (uint8_t*) fileName, flags);
 }
 
 void sdFs_close(int fileDescriptor) {
@@ -16,18 +30,106 @@ int sdFs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
     return readBytes;
 }
 
-void sdFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+int sdFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+    return fileSystem_writeBytes(fileDescriptor, buffer, bufferSize);
+}
+
+int sdFs_lseek(int fileDescriptor, int offset, int origin) {
+    return fileSystem_seek(fileDescriptor, offset, origin);
+}
+
+int sdFs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    return fileSystem_readBytesAt(fileDescriptor, buffer, bufferSize, offset);
+}
+
+void sdFs_readahead(int fileDescriptor, unsigned int offset, unsigned int size) {
+    fileSystem_readahead(fileDescriptor, offset, size);
+}
+
+int sdFs_opendir(void* volume, const char* dirName) {
+    return fileSystem_openDirectory(volume, (uint8_t*) dirName);
+}
+
+int sdFs_getdents(int directory, uint32_t* position, DirectoryEntry_t* entries, unsigned int count) {
+    return fileSystem_readDirectory(directory, position, entries, count);
+}
+
+void sdFs_closedir(int directory) {
+    fileSystem_closeFile(directory);
+}
+
+int sdFs_stat(void* volume, const char* fileName, FileStatus_t* status) {
+    return fileSystem_stat(volume, (uint8_t*) fileName, status);
+}
+
+int sdFs_fstat(int fileDescriptor, FileStatus_t* status) {
+    return fileSystem_fstat(fileDescriptor, status);
+}
+
+int sdFs_unlink(void* volume, const char* fileName) {
+    // Removing files is not supported on FAT volumes
+    FileStatus_t status;
+    return fileSystem_stat(volume, (uint8_t*) fileName, &status) == 0 ? OPERATION_NOT_SUPPORTED : FILE_NOT_FOUND;
+}
 
+void sdFs_sync() {
+    fileSystem_sync();
 }
 
-const char* sdFs_readdir(const char* dirName) {
-    return (const char*) fileSystem_getNextEntryInDirectory((uint8_t*) dirName);
+/*
+ * Mounts the FAT volume on the device, the first one at "/" and all further ones at "/<device name>".
+ * Returns whether a volume has been mounted.
+ */
+static int mountVolume(BlockDevice_t* device, int isFirstVolume) {
+    FatVolume_t* volume = fileSystem_mount(device);
+    if (volume == NULL) {
+        return 0;
+    }
+
+    char path[VOLUME_MOUNT_PATH_LENGTH];
+    snprintf(path, sizeof(path), "/%s", device->name);
+    return vfs_mount(isFirstVolume ? "/" : path, &sdCardFs, volume) == 0;
 }
 
+/*
+ * Registers the RAM disk, formats it and mounts it. Its contents are lost on reset.
+ */
+static void mountRamDisk(void) {
+    ramBlockDevice_init(&ramDiskDevice, RAM_DISK_NAME, ramDiskMemory, RAM_DISK_BLOCKS);
+    if (blockDevice_register(&ramDiskDevice) != 0 || fileSystem_format(&ramDiskDevice) != 0) {
+        return;
+    }
+    mountVolume(&ramDiskDevice, 0);
+}
 
 void sdFs_init() {
-    sdCard_initialize_Ch1();
-    filesystem_Initialize();
+    int32_t cardType = sdCardStorage_initialize();
+    fileSystem_init();
+    mountRamDisk();
+
+    // SDIO and MMC cards are not initialized for transfers
+    if (cardType != SDv1 && cardType != SDv2) {
+        return;
+    }
+
+    if (blockDevice_register(&sdCardDevice) != 0) {
+        return;
+    }
+
+    // Cards without a partition table are formatted as a single volume
+    if (blockDevice_scanPartitions(&sdCardDevice) == 0) {
+        mountVolume(&sdCardDevice, 1);
+        return;
+    }
+
+    int volumesMounted = 0;
+    unsigned int i;
+    BlockDevice_t* device;
+    for (i = 0; (device = blockDevice_getByIndex(i)) != NULL; ++i) {
+        if (device->disk == &sdCardDevice && mountVolume(device, volumesMounted == 0)) {
+            volumesMounted++;
+        }
+    }
 }
 
 FileSystem_t sdCardFs = {
@@ -35,6 +137,16 @@ FileSystem_t sdCardFs = {
         .open = sdFs_open,
         .read = sdFs_read,
         .write = sdFs_write,
-        .readdir = sdFs_readdir,
-        .init = sdFs_init
+        .lseek = sdFs_lseek,
+        .pread = sdFs_pread,
+        .opendir = sdFs_opendir,
+        .getdents = sdFs_getdents,
+        .closedir = sdFs_closedir,
+        .stat = sdFs_stat,
+        .fstat = sdFs_fstat,
+        .unlink = sdFs_unlink,
+        .sync = sdFs_sync,
+        .init = sdFs_init,
+        .readahead = sdFs_readahead,
+        .isPageCached = 1
 };
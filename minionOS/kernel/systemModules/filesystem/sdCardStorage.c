@@ -3,11 +3,41 @@
  *
  *  Created on: 20.05.2017
  *      Author: benimurza
+ *
+ *      The SD card as block device "sd0".
  */
 
-#include "abstractStorage.h"
+#include "sdCardStorage.h"
 #include "../../hal/mmc_sd/sdCard.h"
 
-uint32_t readSector(uint8_t * buf, uint32_t address){
-    return sdCard_read512ByteBlock(buf, address);
+#define SD_SECTOR_SIZE 512
+
+// Cards addressed in bytes (32 bit) are limited to their first 4 GB, high capacity cards take 32 bit block numbers
+#define SD_BYTE_ADDRESSABLE_BLOCKS (0x100000000ULL / SD_SECTOR_SIZE)
+#define SD_BLOCK_ADDRESSABLE_BLOCKS 0xFFFFFFFFUL
+
+// Blocks per multi-block command (CMD18 for reads, CMD25 for writes)
+#define SD_QUEUE_DEPTH 8
+
+static uint32_t sdCard_readBlocks(BlockDevice_t * device, uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    return sdCard_read512ByteBlocks(buffer, firstBlock, count) / SD_SECTOR_SIZE;
 }
+
+static uint32_t sdCard_writeBlocks(BlockDevice_t * device, const uint8_t * buffer, uint32_t firstBlock, uint32_t count){
+    return sdCard_write512ByteBlocks(buffer, firstBlock, count) / SD_SECTOR_SIZE;
+}
+
+int32_t sdCardStorage_initialize(void){
+    int32_t cardType = sdCard_initialize_Ch1();
+    sdCardDevice.numberOfBlocks = sdCard_isHighCapacity() ? SD_BLOCK_ADDRESSABLE_BLOCKS : SD_BYTE_ADDRESSABLE_BLOCKS;
+    return cardType;
+}
+
+BlockDevice_t sdCardDevice = {
+        .name = "sd0",
+        .blockSize = SD_SECTOR_SIZE,
+        .numberOfBlocks = SD_BYTE_ADDRESSABLE_BLOCKS,
+        .queueDepth = SD_QUEUE_DEPTH,
+        .readBlocks = sdCard_readBlocks,
+        .writeBlocks = sdCard_writeBlocks
+};
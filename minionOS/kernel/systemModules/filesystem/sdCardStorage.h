@@ -0,0 +1,16 @@
+/*
+ * sdCardStorage.h
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_SDCARDSTORAGE_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_SDCARDSTORAGE_H_
+
+#include "blockDevice.h"
+
+// The SD card in slot 1, available after sdCardStorage_initialize
+extern BlockDevice_t sdCardDevice;
+
+// Initializes the card and sets the size of sdCardDevice. Returns the type of the card (SDCardTypes_t).
+int32_t sdCardStorage_initialize(void);
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_SDCARDSTORAGE_H_ */
@@ -0,0 +1,385 @@
+/*
+ * tmpFs.c
+ *
+ *      All files are in the mount point directory. The content of a file is a table of pages, so that
+ *      reading, writing and appending at any position only needs an index into the table.
+ */
+
+#include "tmpFs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TMPFS_PAGE_SIZE (4096)
+// Pages of all files together, limits the share of the kernel heap used by tmpfs
+#define TMPFS_MAX_PAGES (16)
+#define TMPFS_MAX_PAGES_PER_FILE TMPFS_MAX_PAGES
+#define TMPFS_MAX_FILES (16)
+#define TMPFS_MAX_OPEN_FILES (16)
+
+typedef struct {
+    char name[DIRECTORY_ENTRY_NAME_LENGTH];
+    unsigned int size;
+
+    // Never reused, so that pages cached for a removed file are not taken for a new one
+    uint32_t fileId;
+
+    // Page i holds the bytes from i * TMPFS_PAGE_SIZE on. Bytes behind the end of the file are 0.
+    uint8_t* pages[TMPFS_MAX_PAGES_PER_FILE];
+    unsigned int numberOfPages;
+
+    // Number of open files referring to the node. An unlinked node keeps its pages until the last one is closed.
+    unsigned int openCount;
+    int isLinked;
+    int isUsed;
+} TmpFsNode_t;
+
+typedef struct {
+    TmpFsNode_t* node;
+    unsigned int position;
+    int isWritable;
+    int isAppending;
+    int isUsed;
+} TmpFsFile_t;
+
+static TmpFsNode_t nodes[TMPFS_MAX_FILES];
+static TmpFsFile_t files[TMPFS_MAX_OPEN_FILES];
+static unsigned int pagesInUse;
+static uint32_t lastFileId;
+
+/*
+ * Returns the linked node with the given name (relative to the mount point, e.g. "/scene.bin"), or NULL.
+ */
+static TmpFsNode_t* findNode(const char* fileName) {
+    int i;
+    for (i = 0; i < TMPFS_MAX_FILES; ++i) {
+        if (nodes[i].isUsed && nodes[i].isLinked && strcmp(nodes[i].name, fileName + 1) == 0) {
+            return &nodes[i];
+        }
+    }
+    return NULL;
+}
+
+static TmpFsNode_t* createNode(const char* fileName) {
+    const char* name = fileName + 1;
+    unsigned int nameLength = strlen(name);
+    if (nameLength == 0 || nameLength >= DIRECTORY_ENTRY_NAME_LENGTH || strchr(name, '/') != NULL) {
+        // There are no subdirectories
+        return NULL;
+    }
+
+    int i;
+    for (i = 0; i < TMPFS_MAX_FILES; ++i) {
+        TmpFsNode_t* node = &nodes[i];
+        if (!node->isUsed) {
+            memset(node, 0, sizeof(TmpFsNode_t));
+            strcpy(node->name, name);
+            node->fileId = ++lastFileId;
+            node->isLinked = 1;
+            node->isUsed = 1;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void freePages(TmpFsNode_t* node) {
+    unsigned int i;
+    for (i = 0; i < node->numberOfPages; ++i) {
+        free(node->pages[i]);
+    }
+    pagesInUse -= node->numberOfPages;
+    node->numberOfPages = 0;
+    node->size = 0;
+}
+
+/*
+ * Frees the node once it is neither linked nor open.
+ */
+static void releaseNode(TmpFsNode_t* node) {
+    if (!node->isLinked && node->openCount == 0) {
+        freePages(node);
+        node->isUsed = 0;
+    }
+}
+
+/*
+ * Makes sure the node has pages up to (including) pageIndex. New pages are cleared.
+ * Returns 0 if the file or tmpfs is full.
+ */
+static int allocatePages(TmpFsNode_t* node, unsigned int pageIndex) {
+    if (pageIndex >= TMPFS_MAX_PAGES_PER_FILE) {
+        return 0;
+    }
+
+    while (node->numberOfPages <= pageIndex) {
+        if (pagesInUse >= TMPFS_MAX_PAGES) {
+            return 0;
+        }
+        uint8_t* page = malloc(TMPFS_PAGE_SIZE);
+        if (page == NULL) {
+            return 0;
+        }
+        memset(page, 0, TMPFS_PAGE_SIZE);
+        node->pages[node->numberOfPages++] = page;
+        pagesInUse++;
+    }
+    return 1;
+}
+
+/*
+ * Returns the open file of a descriptor, or NULL if the descriptor is invalid.
+ */
+static TmpFsFile_t* getFile(int fileDescriptor) {
+    if (fileDescriptor < 0 || fileDescriptor >= TMPFS_MAX_OPEN_FILES || !files[fileDescriptor].isUsed) {
+        return NULL;
+    }
+    return &files[fileDescriptor];
+}
+
+/*
+ * Copies up to bufferSize bytes from the given offset of the node. Returns the number of bytes copied.
+ */
+static int readAt(TmpFsNode_t* node, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    if (offset >= node->size) {
+        return 0;
+    }
+
+    unsigned int bytesToRead = node->size - offset;
+    if (bytesToRead > bufferSize) {
+        bytesToRead = bufferSize;
+    }
+
+    unsigned int bytesRead = 0;
+    while (bytesRead < bytesToRead) {
+        unsigned int position = offset + bytesRead;
+        unsigned int offsetInPage = position % TMPFS_PAGE_SIZE;
+        unsigned int bytesToCopy = TMPFS_PAGE_SIZE - offsetInPage;
+        if (bytesToCopy > bytesToRead - bytesRead) {
+            bytesToCopy = bytesToRead - bytesRead;
+        }
+        memcpy(buffer + bytesRead, node->pages[position / TMPFS_PAGE_SIZE] + offsetInPage, bytesToCopy);
+        bytesRead += bytesToCopy;
+    }
+    return bytesRead;
+}
+
+int tmpFs_open(void* mountData, const char* fileName, int flags) {
+    int fileDescriptor;
+    for (fileDescriptor = 0; fileDescriptor < TMPFS_MAX_OPEN_FILES; ++fileDescriptor) {
+        if (!files[fileDescriptor].isUsed) {
+            break;
+        }
+    }
+    if (fileDescriptor == TMPFS_MAX_OPEN_FILES) {
+        return FILE_NOT_FOUND;
+    }
+
+    TmpFsNode_t* node = findNode(fileName);
+    if (node == NULL) {
+        if ((flags & OPEN_CREATE) == 0) {
+            return FILE_NOT_FOUND;
+        }
+        node = createNode(fileName);
+        if (node == NULL) {
+            return FILE_NOT_FOUND;
+        }
+    }
+
+    TmpFsFile_t* file = &files[fileDescriptor];
+    file->node = node;
+    file->position = 0;
+    file->isWritable = (flags & (OPEN_WRITE | OPEN_APPEND)) != 0;
+    file->isAppending = (flags & OPEN_APPEND) != 0;
+    file->isUsed = 1;
+    node->openCount++;
+
+    if ((flags & OPEN_TRUNCATE) && file->isWritable) {
+        freePages(node);
+    }
+    return fileDescriptor;
+}
+
+void tmpFs_close(int fileDescriptor) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file) {
+        file->node->openCount--;
+        releaseNode(file->node);
+        file->isUsed = 0;
+    }
+}
+
+int tmpFs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file == NULL) {
+        return 0;
+    }
+
+    int bytesRead = readAt(file->node, buffer, bufferSize, file->position);
+    file->position += bytesRead;
+    return bytesRead;
+}
+
+int tmpFs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file == NULL || !file->isWritable) {
+        return 0;
+    }
+
+    TmpFsNode_t* node = file->node;
+    if (file->isAppending) {
+        file->position = node->size;
+    }
+
+    // A gap behind the end of the file reads as zeros, as pages are cleared when they are allocated
+    unsigned int bytesWritten = 0;
+    while (bytesWritten < bufferSize) {
+        unsigned int pageIndex = file->position / TMPFS_PAGE_SIZE;
+        if (!allocatePages(node, pageIndex)) {
+            // File or tmpfs full
+            break;
+        }
+
+        unsigned int offsetInPage = file->position % TMPFS_PAGE_SIZE;
+        unsigned int bytesToCopy = TMPFS_PAGE_SIZE - offsetInPage;
+        if (bytesToCopy > bufferSize - bytesWritten) {
+            bytesToCopy = bufferSize - bytesWritten;
+        }
+        memcpy(node->pages[pageIndex] + offsetInPage, buffer + bytesWritten, bytesToCopy);
+        file->position += bytesToCopy;
+        bytesWritten += bytesToCopy;
+    }
+
+    if (bytesWritten > 0 && file->position > node->size) {
+        node->size = file->position;
+    }
+    return bytesWritten;
+}
+
+int tmpFs_lseek(int fileDescriptor, int offset, int origin) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file == NULL) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+
+    int newPosition;
+    switch (origin) {
+    case SEEK_SET:
+        newPosition = offset;
+        break;
+    case SEEK_CUR:
+        newPosition = (int) file->position + offset;
+        break;
+    case SEEK_END:
+        newPosition = (int) file->node->size + offset;
+        break;
+    default:
+        return -1;
+    }
+
+    if (newPosition < 0) {
+        return -1;
+    }
+    file->position = newPosition;
+    return newPosition;
+}
+
+int tmpFs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file == NULL) {
+        return 0;
+    }
+    return readAt(file->node, buffer, bufferSize, offset);
+}
+
+int tmpFs_opendir(void* mountData, const char* dirName) {
+    // Only the mount point itself is a directory
+    return strcmp(dirName, "/") == 0 ? 0 : FILE_NOT_FOUND;
+}
+
+int tmpFs_getdents(int directory, uint32_t* position, DirectoryEntry_t* entries, unsigned int count) {
+    // The position is the index of the next node
+    int entriesRead = 0;
+    while (entriesRead < count && *position < TMPFS_MAX_FILES) {
+        TmpFsNode_t* node = &nodes[*position];
+        *position += 1;
+        if (node->isUsed && node->isLinked) {
+            DirectoryEntry_t* entry = &entries[entriesRead++];
+            strcpy(entry->name, node->name);
+            entry->type = DIRECTORY_ENTRY_FILE;
+            entry->size = node->size;
+        }
+    }
+    return entriesRead;
+}
+
+void tmpFs_closedir(int directory) {
+    // NO OP
+}
+
+int tmpFs_stat(void* mountData, const char* fileName, FileStatus_t* status) {
+    memset(status, 0, sizeof(FileStatus_t));
+    if (strcmp(fileName, "/") == 0) {
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        return 0;
+    }
+
+    TmpFsNode_t* node = findNode(fileName);
+    if (node == NULL) {
+        return FILE_NOT_FOUND;
+    }
+    // There is no clock, files have no modification time
+    status->type = DIRECTORY_ENTRY_FILE;
+    status->size = node->size;
+    status->fileId = node->fileId;
+    return 0;
+}
+
+int tmpFs_fstat(int fileDescriptor, FileStatus_t* status) {
+    TmpFsFile_t* file = getFile(fileDescriptor);
+    if (file == NULL) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    memset(status, 0, sizeof(FileStatus_t));
+    status->type = DIRECTORY_ENTRY_FILE;
+    status->size = file->node->size;
+    status->fileId = file->node->fileId;
+    return 0;
+}
+
+int tmpFs_unlink(void* mountData, const char* fileName) {
+    TmpFsNode_t* node = findNode(fileName);
+    if (node == NULL) {
+        return FILE_NOT_FOUND;
+    }
+
+    // Open files keep reading and writing the content, the name can be used for a new file right away
+    node->isLinked = 0;
+    releaseNode(node);
+    return 0;
+}
+
+void tmpFs_sync() {
+    // NO OP, nothing to write back
+}
+
+void tmpFs_init() {
+    // NO OP
+}
+
+FileSystem_t tmpFs = {
+        .close = tmpFs_close,
+        .open = tmpFs_open,
+        .read = tmpFs_read,
+        .write = tmpFs_write,
+        .lseek = tmpFs_lseek,
+        .pread = tmpFs_pread,
+        .opendir = tmpFs_opendir,
+        .getdents = tmpFs_getdents,
+        .closedir = tmpFs_closedir,
+        .stat = tmpFs_stat,
+        .fstat = tmpFs_fstat,
+        .unlink = tmpFs_unlink,
+        .sync = tmpFs_sync,
+        .init = tmpFs_init
+};
@@ -0,0 +1,16 @@
+/*
+ * tmpFs.h
+ *
+ *      Filesystem in RAM for scratch files and data exchanged between processes, mounted at "/tmp".
+ *      Files are kept in pages taken from the kernel heap and never touch the SD card. Their content is
+ *      lost on reset.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_FILESYSTEM_TMPFS_H_
+#define KERNEL_SYSTEMMODULES_FILESYSTEM_TMPFS_H_
+
+#include "vfs.h"
+
+extern FileSystem_t tmpFs;
+
+#endif /* KERNEL_SYSTEMMODULES_FILESYSTEM_TMPFS_H_ */
@@ -2,95 +2,543 @@
 #include "deviceDriverFs.h"
 #include "sdCardFs.h"
 #include "processFs.h"
+#include "tmpFs.h"
+#include "pageCache.h"
 #include <limits.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 
-#define MAX_FILESYSTEMS (10)
-#define DESCRIPTORS_PER_FS  (1024)
+#define MAX_MOUNTS (8)
+#define MAX_MOUNT_PATH (16)
+#define MAX_OPEN_FILES (64)
 
-static FileSystem_t* fileSystems[MAX_FILESYSTEMS];
-static unsigned int fileSystemCount;
+#define STD_STREAM_DEVICE "/dev/uart3"
 
 typedef struct {
-    int filesystem;
+    char path[MAX_MOUNT_PATH];
+    unsigned int pathLength;
+    FileSystem_t* fileSystem;
+    void* mountData;
+
+    // Number of open files on this mount, it can only be unmounted if there are none
+    unsigned int openFiles;
+    int isUsed;
+} Mount_t;
+
+// An open file, shared by all descriptors referring to it (e.g. after dup). Position and access mode
+// of the file are kept by the filesystem's descriptor, so they are shared as well.
+typedef struct {
+    Mount_t* mount;
     int concreteDescriptor;
-} ConcreteDescriptor_t;
 
+    // Identity of regular files in the page cache (see FileStatus_t), 0 for other files
+    uint32_t fileId;
+    // Set by writes. Filesystems may commit the new size of a file only when it is closed (FAT), so pages
+    // read through other descriptors meanwhile are dropped then, and files opened before keep their outdated
+    // view of the file out of the page cache (isStale).
+    int isWritten;
+    int isStale;
+
+    // Directories: cursor of the filesystem and the mount points (bit per mount) not listed yet
+    int isDirectory;
+    uint32_t directoryPosition;
+    uint8_t mountPointsToList;
+
+    // Number of references, the file is closed when the last one is released. 0 marks a free slot.
+    unsigned int referenceCount;
+} OpenFile_t;
+
+static Mount_t mounts[MAX_MOUNTS];
+
+// A virtual file descriptor is the index of the file in this table
+static OpenFile_t openFiles[MAX_OPEN_FILES];
+
+// Open file used as stdin/stdout/stderr of all processes
+static int stdStream = FILE_NOT_FOUND;
+
+/*
+ * Returns the mount with the longest path which is a prefix of fileName (on a path component boundary),
+ * or NULL if no filesystem is mounted there. relativeName is set to the part of fileName behind the mount
+ * path, which always starts with '/'.
+ */
+static Mount_t* findMount(const char* fileName, const char** relativeName) {
+    Mount_t* bestMount = NULL;
+    int i;
+    for (i = 0; i < MAX_MOUNTS; ++i) {
+        Mount_t* mount = &mounts[i];
+        if (!mount->isUsed || (bestMount && mount->pathLength <= bestMount->pathLength)) {
+            continue;
+        }
+
+        if (mount->pathLength == 1) {
+            // Root mount, matches every absolute path
+            if (fileName[0] == '/') {
+                bestMount = mount;
+            }
+        } else if (strncmp(fileName, mount->path, mount->pathLength) == 0
+                && (fileName[mount->pathLength] == '/' || fileName[mount->pathLength] == '\0')) {
+            bestMount = mount;
+        }
+    }
+
+    if (bestMount) {
+        *relativeName = bestMount->pathLength == 1 ? fileName : fileName + bestMount->pathLength;
+        if (**relativeName == '\0') {
+            *relativeName = "/";
+        }
+    }
+    return bestMount;
+}
+
+static Mount_t* findMountByPath(const char* path) {
+    int i;
+    for (i = 0; i < MAX_MOUNTS; ++i) {
+        if (mounts[i].isUsed && strcmp(mounts[i].path, path) == 0) {
+            return &mounts[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the device number of files on the mount, see FileStatus_t.
+ */
+static uint16_t getDevice(Mount_t* mount) {
+    return mount - mounts + 1;
+}
+
+/*
+ * Returns the open file of a virtual descriptor, or NULL if the descriptor is invalid.
+ */
+static OpenFile_t* getOpenFile(int fileDescriptor) {
+    if (fileDescriptor < 0 || fileDescriptor >= MAX_OPEN_FILES || openFiles[fileDescriptor].referenceCount == 0) {
+        return NULL;
+    }
+    return &openFiles[fileDescriptor];
+}
+
+int vfs_mount(const char* path, FileSystem_t* fileSystem, void* mountData) {
+    unsigned int pathLength = strlen(path);
+    if (path[0] != '/' || pathLength >= MAX_MOUNT_PATH || (pathLength > 1 && path[pathLength - 1] == '/')
+            || findMountByPath(path) != NULL) {
+        return MOUNT_FAILED;
+    }
+
+    int i;
+    for (i = 0; i < MAX_MOUNTS; ++i) {
+        if (!mounts[i].isUsed) {
+            strcpy(mounts[i].path, path);
+            mounts[i].pathLength = pathLength;
+            mounts[i].fileSystem = fileSystem;
+            mounts[i].mountData = mountData;
+            mounts[i].openFiles = 0;
+            mounts[i].isUsed = 1;
+            return 0;
+        }
+    }
+    return MOUNT_FAILED;
+}
+
+int vfs_unmount(const char* path) {
+    Mount_t* mount = findMountByPath(path);
+    if (mount == NULL || mount->openFiles > 0) {
+        return MOUNT_FAILED;
+    }
+
+    mount->fileSystem->sync();
+    mount->isUsed = 0;
+    return 0;
+}
+
+/*
+ * Returns the index of a free slot in the open file table, or -1 if too many files are open.
+ */
+static int allocateOpenFile(void) {
+    int i;
+    for (i = 0; i < MAX_OPEN_FILES; ++i) {
+        if (openFiles[i].referenceCount == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int vfs_open(const char* fileName, int flags) {
+    const char* relativeName;
+    Mount_t* mount = findMount(fileName, &relativeName);
+    if (mount == NULL) {
+        return FILE_NOT_FOUND;
+    }
 
-static ConcreteDescriptor_t virtualToConcreteDescriptor(int virtualDescriptor) {
-    ConcreteDescriptor_t descriptor = { virtualDescriptor / DESCRIPTORS_PER_FS,
-                                        virtualDescriptor % DESCRIPTORS_PER_FS };
-    return descriptor;
+    int i = allocateOpenFile();
+    if (i < 0) {
+        return FILE_NOT_FOUND;
+    }
+
+    int file = mount->fileSystem->open(mount->mountData, relativeName, flags);
+    if (!isValidFile(file)) {
+        return file;
+    }
+
+    openFiles[i].mount = mount;
+    openFiles[i].concreteDescriptor = file;
+    openFiles[i].referenceCount = 1;
+    openFiles[i].isDirectory = 0;
+    openFiles[i].isWritten = 0;
+    openFiles[i].isStale = 0;
+    mount->openFiles++;
+
+    FileStatus_t status;
+    int isRegularFile = mount->fileSystem->fstat(file, &status) == 0 && status.type == DIRECTORY_ENTRY_FILE;
+    openFiles[i].fileId = isRegularFile ? status.fileId : 0;
+    if ((flags & OPEN_TRUNCATE) && openFiles[i].fileId != 0) {
+        pageCache_invalidateFile(getDevice(mount), openFiles[i].fileId);
+    }
+    return i;
 }
 
-static int concreteToVirtualDescriptor(int concreteDescriptor, int fileSystem) {
-    return DESCRIPTORS_PER_FS * fileSystem + concreteDescriptor;
+int vfs_dup(int fileDescriptor) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    file->referenceCount++;
+    return fileDescriptor;
 }
 
-int vfs_open(const char* fileName) {
+int vfs_openStdStream(void) {
+    return vfs_dup(stdStream);
+}
+
+static void markStale(OpenFile_t* writtenFile) {
     int i;
-    for (i = 0; i < fileSystemCount; ++i) {
-        int file = fileSystems[i]->open(fileName);
-        if (isValidFile(file)) {
-            return concreteToVirtualDescriptor(file, i);
+    for (i = 0; i < MAX_OPEN_FILES; ++i) {
+        OpenFile_t* file = &openFiles[i];
+        if (file->referenceCount > 0 && file->mount == writtenFile->mount && file->fileId == writtenFile->fileId) {
+            file->isStale = 1;
         }
     }
-    return FILE_NOT_FOUND;
+    pageCache_invalidateFile(getDevice(writtenFile->mount), writtenFile->fileId);
 }
 
 void vfs_close(int fileDescriptor) {
-    ConcreteDescriptor_t descriptor = virtualToConcreteDescriptor(fileDescriptor);
-    fileSystems[descriptor.filesystem]->close(descriptor.concreteDescriptor);
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file && --file->referenceCount == 0) {
+        if (file->isDirectory) {
+            file->mount->fileSystem->closedir(file->concreteDescriptor);
+        } else {
+            file->mount->fileSystem->close(file->concreteDescriptor);
+            if (file->isWritten) {
+                markStale(file);
+            }
+        }
+        file->mount->openFiles--;
+    }
+}
+
+static int isPageCached(OpenFile_t* file) {
+    return file->fileId != 0 && !file->isStale && file->mount->fileSystem->isPageCached;
+}
+
+/*
+ * Reads from the given offset of the file through the page cache. Pages which are not cached are read with the
+ * pread operation of the filesystem. Returns the number of bytes read, or a negative number in case of error.
+ */
+static int readCached(OpenFile_t* file, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    FileSystem_t* fileSystem = file->mount->fileSystem;
+    unsigned int bytesRead = 0;
+    while (bytesRead < bufferSize) {
+        unsigned int position = offset + bytesRead;
+        unsigned int offsetInPage = position % PAGE_CACHE_PAGE_SIZE;
+        const uint8_t* page;
+        int length = pageCache_read(getDevice(file->mount), file->fileId, position / PAGE_CACHE_PAGE_SIZE,
+                                    fileSystem->pread, fileSystem->readahead, file->concreteDescriptor, &page);
+        if (length < 0) {
+            // No frame for the page (all pinned), the rest is read without the cache
+            int result = fileSystem->pread(file->concreteDescriptor, buffer + bytesRead, bufferSize - bytesRead, position);
+            if (result < 0) {
+                return bytesRead > 0 ? bytesRead : result;
+            }
+            return bytesRead + result;
+        }
+        if (length <= offsetInPage) {
+            // End of the file
+            break;
+        }
+
+        unsigned int bytesToCopy = length - offsetInPage;
+        if (bytesToCopy > bufferSize - bytesRead) {
+            bytesToCopy = bufferSize - bytesRead;
+        }
+        memcpy(buffer + bytesRead, page + offsetInPage, bytesToCopy);
+        bytesRead += bytesToCopy;
+
+        if (length < PAGE_CACHE_PAGE_SIZE) {
+            // Last page of the file
+            break;
+        }
+    }
+    return bytesRead;
 }
 
 int vfs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
-    ConcreteDescriptor_t descriptor = virtualToConcreteDescriptor(fileDescriptor);
-    return fileSystems[descriptor.filesystem]->read(descriptor.concreteDescriptor, buffer, bufferSize);
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+
+    FileSystem_t* fileSystem = file->mount->fileSystem;
+    if (isPageCached(file)) {
+        // The position is kept by the filesystem's descriptor
+        int position = fileSystem->lseek(file->concreteDescriptor, 0, SEEK_CUR);
+        if (position >= 0) {
+            int bytesRead = readCached(file, buffer, bufferSize, position);
+            if (bytesRead > 0) {
+                fileSystem->lseek(file->concreteDescriptor, position + bytesRead, SEEK_SET);
+            }
+            return bytesRead;
+        }
+    }
+    return fileSystem->read(file->concreteDescriptor, buffer, bufferSize);
 }
 
-void vfs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
-    ConcreteDescriptor_t descriptor = virtualToConcreteDescriptor(fileDescriptor);
-    fileSystems[descriptor.filesystem]->write(descriptor.concreteDescriptor, buffer, bufferSize);
+int vfs_readUncached(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    return file->mount->fileSystem->read(file->concreteDescriptor, buffer, bufferSize);
 }
 
-void vfs_addFileSystem(FileSystem_t* fileSystem) {
-    fileSystems[fileSystemCount++] = fileSystem;
+int vfs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+
+    FileSystem_t* fileSystem = file->mount->fileSystem;
+    int bytesWritten = fileSystem->write(file->concreteDescriptor, buffer, bufferSize);
+    if (bytesWritten > 0 && file->fileId != 0) {
+        file->isWritten = 1;
+        // The position is behind the written bytes, also when appending. Pages of all files with an identity
+        // are kept up to date, as they may be mapped.
+        int position = fileSystem->lseek(file->concreteDescriptor, 0, SEEK_CUR);
+        if (position >= bytesWritten) {
+            pageCache_update(getDevice(file->mount), file->fileId, position - bytesWritten, buffer, bytesWritten);
+        }
+    }
+    return bytesWritten;
 }
 
-const char* vfs_readdir(const char* dirName) {
-    static char previousDirectory[100];
-    static int currentFs;
+void vfs_sync(void) {
+    int i;
+    for (i = 0; i < MAX_MOUNTS; ++i) {
+        if (mounts[i].isUsed) {
+            mounts[i].fileSystem->sync();
+        }
+    }
+}
 
-    if (strcmp(dirName, previousDirectory) != 0) {
-        strncpy(previousDirectory, dirName, sizeof(previousDirectory) - 1);
-        currentFs = 0;
+int vfs_lseek(int fileDescriptor, int offset, int origin) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
     }
-    const char* dirEntry;
-    do {
-        dirEntry = fileSystems[currentFs]->readdir(previousDirectory);
-    } while (dirEntry == NULL && ++currentFs < fileSystemCount);
+    return file->mount->fileSystem->lseek(file->concreteDescriptor, offset, origin);
+}
 
-    if (dirEntry == NULL) {
-        previousDirectory[0] = '\0';
+int vfs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
     }
+    if (isPageCached(file)) {
+        return readCached(file, buffer, bufferSize, offset);
+    }
+    return file->mount->fileSystem->pread(file->concreteDescriptor, buffer, bufferSize, offset);
+}
 
-    return dirEntry;
+int vfs_preadUncached(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    return file->mount->fileSystem->pread(file->concreteDescriptor, buffer, bufferSize, offset);
 }
 
-static void initStdStreams() {
-    int stdout = vfs_open("/dev/uart3");
+int vfs_ioctl(int fileDescriptor, unsigned int request, void* argument) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    if (file->mount->fileSystem->ioctl == NULL) {
+        return UNKNOWN_REQUEST;
+    }
+    return file->mount->fileSystem->ioctl(file->concreteDescriptor, request, argument);
 }
 
-void vfs_init(void) {
-    vfs_addFileSystem(&deviceDriverFs);
-    vfs_addFileSystem(&sdCardFs);
-    //vfs_addFileSystem(&processFs);
+uint32_t vfs_acquirePage(int fileDescriptor, uint32_t pageIndex) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || file->isDirectory || file->fileId == 0 || file->isStale) {
+        return 0;
+    }
+    return pageCache_acquire(getDevice(file->mount), file->fileId, pageIndex, file->mount->fileSystem->pread,
+                             file->concreteDescriptor);
+}
+
+int vfs_stat(const char* fileName, FileStatus_t* status) {
+    const char* relativeName;
+    Mount_t* mount = findMount(fileName, &relativeName);
+    if (mount == NULL || status == NULL) {
+        return FILE_NOT_FOUND;
+    }
+    if (mount->fileSystem->stat(mount->mountData, relativeName, status) != 0) {
+        return FILE_NOT_FOUND;
+    }
+    status->device = getDevice(mount);
+    return 0;
+}
+
+int vfs_fstat(int fileDescriptor, FileStatus_t* status) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || status == NULL) {
+        return INVALID_FILE_DESCRIPTOR;
+    }
+    if (file->isDirectory) {
+        // Directory descriptors are not known to all filesystems, their status does not depend on it anyway
+        memset(status, 0, sizeof(FileStatus_t));
+        status->type = DIRECTORY_ENTRY_DIRECTORY;
+        status->device = getDevice(file->mount);
+        return 0;
+    }
+
+    int result = file->mount->fileSystem->fstat(file->concreteDescriptor, status);
+    if (result == 0) {
+        status->device = getDevice(file->mount);
+    }
+    return result;
+}
+
+int vfs_unlink(const char* fileName) {
+    const char* relativeName;
+    Mount_t* mount = findMount(fileName, &relativeName);
+    if (mount == NULL) {
+        return FILE_NOT_FOUND;
+    }
+
+    FileStatus_t status;
+    int hasStatus = mount->fileSystem->stat(mount->mountData, relativeName, &status) == 0;
+    int result = mount->fileSystem->unlink(mount->mountData, relativeName);
+    if (result != 0) {
+        return result;
+    }
+    if (hasStatus && status.fileId != 0) {
+        pageCache_invalidateFile(getDevice(mount), status.fileId);
+    }
+    return 0;
+}
+
+/*
+ * Returns whether the mount point is an entry of the directory dirName (e.g. the mount "/dev" is an entry
+ * of the directory "/").
+ */
+static int isMountPointInDirectory(Mount_t* mount, const char* dirName) {
+    unsigned int dirLength = strlen(dirName);
+    if (dirLength > 0 && dirName[dirLength - 1] == '/') {
+        dirLength--;
+    }
+
+    return mount->pathLength > dirLength + 1 && strncmp(mount->path, dirName, dirLength) == 0
+            && mount->path[dirLength] == '/' && strchr(mount->path + dirLength + 1, '/') == NULL;
+}
+
+int vfs_opendir(const char* dirName) {
+    const char* relativeName;
+    Mount_t* mount = findMount(dirName, &relativeName);
+    if (mount == NULL) {
+        return FILE_NOT_FOUND;
+    }
+
+    int file = allocateOpenFile();
+    if (file < 0) {
+        return FILE_NOT_FOUND;
+    }
+
+    int directory = mount->fileSystem->opendir(mount->mountData, relativeName);
+    if (!isValidFile(directory)) {
+        return FILE_NOT_FOUND;
+    }
+
+    OpenFile_t* openFile = &openFiles[file];
+    openFile->mount = mount;
+    openFile->concreteDescriptor = directory;
+    openFile->referenceCount = 1;
+    openFile->isDirectory = 1;
+    openFile->directoryPosition = 0;
+    openFile->mountPointsToList = 0;
 
     int i;
-    for (i = 0; i < fileSystemCount; ++i) {
-        fileSystems[i]->init();
+    for (i = 0; i < MAX_MOUNTS; ++i) {
+        if (mounts[i].isUsed && isMountPointInDirectory(&mounts[i], dirName)) {
+            openFile->mountPointsToList |= 1 << i;
+        }
+    }
+
+    mount->openFiles++;
+    return file;
+}
+
+int vfs_getdents(int fileDescriptor, DirectoryEntry_t* entries, unsigned int count) {
+    OpenFile_t* file = getOpenFile(fileDescriptor);
+    if (file == NULL || !file->isDirectory) {
+        return INVALID_FILE_DESCRIPTOR;
     }
 
+    // Mount points are listed first, then the entries of the filesystem containing the directory
+    unsigned int entriesRead = 0;
+    int i;
+    for (i = 0; i < MAX_MOUNTS && entriesRead < count; ++i) {
+        if (file->mountPointsToList & (1 << i)) {
+            file->mountPointsToList &= ~(1 << i);
+            if (mounts[i].isUsed) {
+                DirectoryEntry_t* entry = &entries[entriesRead++];
+                strcpy(entry->name, strrchr(mounts[i].path, '/') + 1);
+                entry->type = DIRECTORY_ENTRY_DIRECTORY;
+                entry->size = 0;
+            }
+        }
+    }
+
+    if (entriesRead < count) {
+        int result = file->mount->fileSystem->getdents(file->concreteDescriptor, &file->directoryPosition,
+                                                       entries + entriesRead, count - entriesRead);
+        if (result < 0 && entriesRead == 0) {
+            return result;
+        }
+        if (result > 0) {
+            entriesRead += result;
+        }
+    }
+
+    return entriesRead;
+}
+
+static void initStdStreams() {
+    stdStream = vfs_open(STD_STREAM_DEVICE, OPEN_READ | OPEN_WRITE);
+}
+
+void vfs_init(void) {
+    pageCache_init();
+
+    deviceDriverFs.init();
+    sdCardFs.init();
+    processFs.init();
+    tmpFs.init();
+
+    vfs_mount("/dev", &deviceDriverFs, NULL);
+    vfs_mount("/ipc", &processFs, NULL);
+    vfs_mount("/tmp", &tmpFs, NULL);
+
     initStdStreams();
 }
@@ -2,28 +2,90 @@
 #define KERNEL_SYSTEMMODULES_FILESYSTEM_VFS_H_
 
 #include <inttypes.h>
+#include "openFlags.h"
+#include "directoryEntry.h"
+#include "fileStatus.h"
 
 #define isValidFile(fileDescriptor) (fileDescriptor >= 0)
 #define FILE_NOT_FOUND (-1)
+// Returned by lseek/pread of files which are streams (devices, IPC)
+#define FILE_NOT_SEEKABLE (-2)
+// Returned by operations on descriptors which do not refer to an open file
+#define INVALID_FILE_DESCRIPTOR (-3)
+// Returned by ioctl for requests which the file does not support
+#define UNKNOWN_REQUEST (-4)
+// Returned by open of a device whose hardware another driver uses, e.g. a UART sending DMX
+#define DEVICE_BUSY (-5)
+// Returned by operations which the filesystem of an existing file does not provide, e.g. unlink on FAT volumes
+#define OPERATION_NOT_SUPPORTED (-6)
+#define MOUNT_FAILED (-1)
 
+// Operations on names get the mount data passed to vfs_mount, which tells filesystems mounted more than
+// once (e.g. one FAT volume per partition) which instance is meant
 typedef struct {
-    int (*open)(const char* fileName);
+    int (*open)(void* mountData, const char* fileName, int flags);
     void (*close)(const int fileDescriptor);
     int (*read)(const int fileDescriptor, uint8_t* buffer, unsigned int bufferSize);
-    void (*write)(const int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
-    const char* (*readdir)(const char* dirName);
+    int (*write)(const int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
+    int (*lseek)(const int fileDescriptor, int offset, int origin);
+    int (*pread)(const int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset);
+    int (*opendir)(void* mountData, const char* dirName);
+    int (*getdents)(const int directory, uint32_t* position, DirectoryEntry_t* entries, unsigned int count);
+    void (*closedir)(const int directory);
+    int (*stat)(void* mountData, const char* fileName, FileStatus_t* status);
+    int (*fstat)(const int fileDescriptor, FileStatus_t* status);
+    int (*unlink)(void* mountData, const char* fileName);
+    void (*sync)(void);
     void (*init)(void);
+
+    // Optional, for filesystems of devices
+    int (*ioctl)(const int fileDescriptor, unsigned int request, void* argument);
+
+    // Optional: size bytes at offset have just been read with pread to fill the page cache. The filesystem may
+    // prefetch the data following them if the file is read sequentially.
+    void (*readahead)(const int fileDescriptor, unsigned int offset, unsigned int size);
+
+    // Reads of files are served from the page cache, for filesystems on (slow) storage
+    int isPageCached;
 } FileSystem_t;
 
+/**
+ * Mounts the (initialized) filesystem at the given absolute path, e.g. "/dev". Files whose names start
+ * with the path are handled by this filesystem, unless a filesystem is mounted at a longer matching path.
+ * The filesystem gets the names relative to the mount path, e.g. "/uart3" for "/dev/uart3", and mountData.
+ * Returns 0 on success, or MOUNT_FAILED if the path is invalid, already used or the mount table is full.
+ */
+int vfs_mount(const char* path, FileSystem_t* fileSystem, void* mountData);
+
+/**
+ * Writes the cached modifications of the filesystem mounted at the given path to its storage and removes
+ * it from the mount table. Returns 0 on success, or MOUNT_FAILED if nothing is mounted at the path or
+ * files of the filesystem are still open.
+ */
+int vfs_unmount(const char* path);
+
 /**
  * Tries to open the file with the given absolute name and returns a file descriptor,
- * which should be used for further operations on this file.
+ * which should be used for further operations on this file. flags is a combination
+ * of the OPEN_* flags (openFlags.h).
+ */
+int vfs_open(const char* fileName, int flags);
+
+/**
+ * Adds a reference to an open file. Returns the descriptor, which has to be closed
+ * once more, or INVALID_FILE_DESCRIPTOR.
  */
-int vfs_open(const char* fileName);
+int vfs_dup(int fileDescriptor);
 
 /**
- * Closes the file by releasing any resources associated with it and destroying
- * the respective file descriptor.
+ * Returns a new reference to the open file used for the standard streams (uart3).
+ */
+int vfs_openStdStream(void);
+
+/**
+ * Releases a reference to the file. When the last reference is released, the file is
+ * closed by releasing any resources associated with it and destroying the respective
+ * file descriptor.
  */
 void vfs_close(int fileDescriptor);
 
@@ -36,18 +98,87 @@ int vfs_read(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize);
 
 /**
  * Writes the contents of the provided buffer to the specified file.
+ * Returns the number of actually written bytes.
+ */
+int vfs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
+
+/**
+ * Writes all cached modifications of all filesystems to their storage.
+ */
+void vfs_sync(void);
+
+/**
+ * Sets the position of the next read or write. The offset is relative to the beginning of the file,
+ * the current position or the end of the file, depending on origin (SEEK_SET, SEEK_CUR or SEEK_END).
+ * Returns the new position, or a negative number in case of error (FILE_NOT_SEEKABLE for streams).
+ */
+int vfs_lseek(int fileDescriptor, int offset, int origin);
+
+/**
+ * Reads like vfs_read, but starting at the given offset of the file. The current position of the
+ * file is not changed. Returns the number of actually read bytes, or FILE_NOT_SEEKABLE for streams.
+ */
+int vfs_pread(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset);
+
+/**
+ * Read like vfs_read and vfs_pread, but bypass the page cache: the filesystem reads no more than requested,
+ * where a page cache miss would read a whole page. A read of one sector of an SD card file reads at most that
+ * sector (and a sector of the FAT when the cluster chain is followed). For readers in the interrupt handler.
+ */
+int vfs_readUncached(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize);
+int vfs_preadUncached(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset);
+
+/**
+ * Passes a request, which only the device behind the file knows, and its argument to the device, e.g. to
+ * change a part of the DMX universe (dmxControl.h). Returns the result of the request, or UNKNOWN_REQUEST if
+ * the file does not support it.
+ */
+int vfs_ioctl(int fileDescriptor, unsigned int request, void* argument);
+
+/**
+ * Returns the frame holding the page pageIndex (of 4 KB) of the file in the page cache, e.g. to map it into
+ * a process. The page is pinned until it is released with pageCache_release. Returns 0 in case of error
+ * (e.g. the descriptor does not refer to a regular file, or the file has been written and closed through
+ * another descriptor since it was opened).
+ */
+uint32_t vfs_acquirePage(int fileDescriptor, uint32_t pageIndex);
+
+/**
+ * Opens the directory with the given absolute name for reading its entries with
+ * vfs_getdents. The returned descriptor is closed with vfs_close.
+ */
+int vfs_opendir(const char* dirName);
+
+/**
+ * Reads up to count entries of an opened directory into entries. The position within
+ * the directory is kept by the descriptor, so every call continues behind the entries
+ * returned by the previous one. Filesystems mounted in the directory are listed as
+ * entries as well. Returns the number of entries read, 0 at the end of the directory.
+ */
+int vfs_getdents(int fileDescriptor, DirectoryEntry_t* entries, unsigned int count);
+
+/**
+ * Fills status with size, type, modification time and identity of the file or directory with the given
+ * absolute name, without opening it. Returns 0 on success, or FILE_NOT_FOUND.
+ */
+int vfs_stat(const char* fileName, FileStatus_t* status);
+
+/**
+ * Same as vfs_stat, for an open file or directory. Returns 0 on success, or a negative number
+ * (INVALID_FILE_DESCRIPTOR if the descriptor does not refer to an open file).
  */
-void vfs_write(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
+int vfs_fstat(int fileDescriptor, FileStatus_t* status);
 
 /**
- * Reads the content of the directory with the specified name. Each call to this
- * function with the same arguments returns the next entry of the directory
- * until all entries have been read and NULL is returned.
+ * Removes the file with the given absolute name from its directory. Files which are still open keep
+ * their content until they are closed. Returns 0 on success, FILE_NOT_FOUND if the file does not exist,
+ * or OPERATION_NOT_SUPPORTED if its filesystem does not support removing files.
  */
-const char* vfs_readdir(const char* dirName);
+int vfs_unlink(const char* fileName);
 
 /**
- * Initializes the virtual filesystem and all known sub-filesystems.
+ * Initializes the page cache and all known sub-filesystems and mounts them at "/dev", "/ipc" and "/tmp". The SD card filesystem mounts
+ * its volumes itself, the first one at "/".
  */
 void vfs_init(void);
 
@@ -12,28 +12,29 @@ static uint32_t getNrOfBytesNecessary(IntelHexSet_t* intelHexSet);
 
 int8_t loader_loadProcess(const char* fileName, FileType_t fileType) {
 
-    int32_t fileHandle = sysCalls_openFile(fileName);
+    // Runs in the kernel (at boot or within a system call), so the file is opened through the VFS directly
+    int32_t fileHandle = vfs_open(fileName, OPEN_READ);
 
     if (fileHandle < 0) {
         return NOT_ABLE_TO_LOAD_FILE;
     }
 
+    // The size is known up front, so the whole file is read with a single call. The content is taken from the
+    // page cache, so loading a program again does not read it from the SD card.
+    FileStatus_t status;
+    if (vfs_fstat(fileHandle, &status) != 0 || status.type != DIRECTORY_ENTRY_FILE || status.size > BUFFER_SIZE) {
+        vfs_close(fileHandle);
+        return NOT_ABLE_TO_LOAD_FILE;
+    }
+
     uint8_t buffer[BUFFER_SIZE] = {0};
-    uint8_t readBuffer[1024] = {0};
-    uint32_t nrOfBytesInFile = 0;
-    int32_t nrOfBytesRead;
-    uint32_t* pBuffer = (uint32_t*)&buffer;
-
-    int i = 0;
-    do {
-        nrOfBytesRead = sysCalls_readFile(fileHandle, readBuffer, 1024);
-        if (nrOfBytesRead > 0) {
-            memcpy(pBuffer, readBuffer, nrOfBytesRead);
-        }
-        nrOfBytesInFile += nrOfBytesRead;
-        i++;
-        pBuffer = (uint32_t*)((uint8_t*)pBuffer + 1024);
-    } while (i < BUFFER_SIZE && nrOfBytesRead > 0);
+    int32_t nrOfBytesRead = vfs_read(fileHandle, buffer, status.size);
+    vfs_close(fileHandle);
+
+    if (nrOfBytesRead != status.size) {
+        return NOT_ABLE_TO_LOAD_FILE;
+    }
+    uint32_t nrOfBytesInFile = nrOfBytesRead;
 
     uint32_t* pAddress;
     uint32_t nrOfBytesNeeded;
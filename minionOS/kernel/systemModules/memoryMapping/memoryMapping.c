@@ -0,0 +1,267 @@
+/*
+ * memoryMapping.c
+ *
+ *      A mapped file keeps a table of the page cache frames holding its pages. The table is shared by all
+ *      mappings of the file, the frames are mapped into each process touching them. They stay pinned in the
+ *      page cache until the last mapping is removed.
+ */
+
+#include "memoryMapping.h"
+#include "kernel/systemModules/mmu/mmu.h"
+#include "kernel/systemModules/filesystem/vfs.h"
+#include "kernel/systemModules/filesystem/pageCache.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
+#include <stdlib.h>
+
+#define MMAP_REGION_END_ADDRESS (MMAP_REGION_START_ADDRESS + NR_OF_PAGES_IN_MMAP_REGION * SMALL_PAGE_SIZE)
+
+typedef struct {
+    // Identity of the file (see FileStatus_t). The size is part of it, so a file which changed its size
+    // while mapped is mapped with pages of its own.
+    uint16_t device;
+    uint32_t fileId;
+    uint32_t size;
+
+    // Own reference to the VFS file, the pages are read through it
+    int file;
+
+    // Frame holding page i of the file, 0 if the page has not been acquired from the page cache yet
+    uint32_t* frames;
+    uint32_t numberOfPages;
+
+    // Number of mappings of the file, the pages are released with the last one
+    unsigned int mappingCount;
+    int isUsed;
+} MappedFile_t;
+
+typedef struct {
+    ProcessId_t processId;
+    uint32_t vAddress;
+    uint32_t numberOfPages;
+
+    // Page of the file mapped at vAddress. file is NULL for frames of the kernel mapped with
+    // memoryMapping_mapFrames, which are mapped up front.
+    uint32_t firstPage;
+    MappedFile_t* file;
+    int isUsed;
+} Mapping_t;
+
+static MappedFile_t mappedFiles[MEMORY_MAPPING_MAX_FILES];
+static Mapping_t mappings[MEMORY_MAPPING_MAX_MAPPINGS];
+
+static uint32_t getNumberOfPages(uint32_t numberOfBytes) {
+    return (numberOfBytes + SMALL_PAGE_SIZE - 1) / SMALL_PAGE_SIZE;
+}
+
+/*
+ * Returns the mapped file with the identity of status, adding a reference to it. The file is added if it
+ * is not mapped yet. Returns NULL if the table is full.
+ */
+static MappedFile_t* getMappedFile(int file, const FileStatus_t* status) {
+    int i;
+    for (i = 0; i < MEMORY_MAPPING_MAX_FILES; ++i) {
+        MappedFile_t* mappedFile = &mappedFiles[i];
+        if (mappedFile->isUsed && mappedFile->device == status->device && mappedFile->fileId == status->fileId
+                && mappedFile->size == status->size) {
+            mappedFile->mappingCount++;
+            return mappedFile;
+        }
+    }
+
+    for (i = 0; i < MEMORY_MAPPING_MAX_FILES; ++i) {
+        MappedFile_t* mappedFile = &mappedFiles[i];
+        if (!mappedFile->isUsed) {
+            mappedFile->numberOfPages = getNumberOfPages(status->size);
+            mappedFile->frames = calloc(mappedFile->numberOfPages, sizeof(uint32_t));
+            if (mappedFile->frames == NULL) {
+                return NULL;
+            }
+            mappedFile->device = status->device;
+            mappedFile->fileId = status->fileId;
+            mappedFile->size = status->size;
+            mappedFile->file = vfs_dup(file);
+            mappedFile->mappingCount = 1;
+            mappedFile->isUsed = 1;
+            return mappedFile;
+        }
+    }
+    return NULL;
+}
+
+static void releaseMappedFile(MappedFile_t* mappedFile) {
+    if (--mappedFile->mappingCount > 0) {
+        return;
+    }
+
+    uint32_t i;
+    for (i = 0; i < mappedFile->numberOfPages; ++i) {
+        if (mappedFile->frames[i] != 0) {
+            pageCache_release(mappedFile->frames[i]);
+        }
+    }
+    free(mappedFile->frames);
+    vfs_close(mappedFile->file);
+    mappedFile->isUsed = 0;
+}
+
+/*
+ * Returns the first address of the mmap region of the process where numberOfPages pages are not mapped
+ * yet, or 0 if the region is full.
+ */
+static uint32_t findFreeAddress(ProcessId_t processId, uint32_t numberOfPages) {
+    uint32_t vAddress = MMAP_REGION_START_ADDRESS;
+    uint32_t size = numberOfPages * SMALL_PAGE_SIZE;
+
+    int isOverlapping = 1;
+    while (isOverlapping) {
+        if (size > MMAP_REGION_END_ADDRESS - vAddress) {
+            return 0;
+        }
+
+        // Continue behind any mapping overlapping the candidate until there is none
+        isOverlapping = 0;
+        int i;
+        for (i = 0; i < MEMORY_MAPPING_MAX_MAPPINGS; ++i) {
+            Mapping_t* mapping = &mappings[i];
+            uint32_t mappingEnd = mapping->vAddress + mapping->numberOfPages * SMALL_PAGE_SIZE;
+            if (mapping->isUsed && mapping->processId == processId && mapping->vAddress < vAddress + size
+                    && mappingEnd > vAddress) {
+                vAddress = mappingEnd;
+                isOverlapping = 1;
+            }
+        }
+    }
+    return vAddress;
+}
+
+static Mapping_t* getFreeMapping(void) {
+    int i;
+    for (i = 0; i < MEMORY_MAPPING_MAX_MAPPINGS; ++i) {
+        if (!mappings[i].isUsed) {
+            return &mappings[i];
+        }
+    }
+    return NULL;
+}
+
+static void removeMapping(Mapping_t* mapping) {
+    mmu_unmapSharedPages(mapping->processId, mapping->vAddress, mapping->numberOfPages);
+    if (mapping->file != NULL) {
+        releaseMappedFile(mapping->file);
+    }
+    mapping->isUsed = 0;
+}
+
+void* memoryMapping_map(PCB_t* process, int file, unsigned int length, unsigned int offset) {
+    FileStatus_t status;
+    if (length == 0 || offset % SMALL_PAGE_SIZE != 0 || vfs_fstat(file, &status) != 0
+            || status.type != DIRECTORY_ENTRY_FILE || status.fileId == 0) {
+        return NULL;
+    }
+
+    uint32_t firstPage = offset / SMALL_PAGE_SIZE;
+    uint32_t numberOfPages = getNumberOfPages(length);
+    if (firstPage + numberOfPages > getNumberOfPages(status.size)) {
+        return NULL;
+    }
+
+    Mapping_t* mapping = getFreeMapping();
+    uint32_t vAddress = findFreeAddress(process->processId, numberOfPages);
+    if (mapping == NULL || vAddress == 0) {
+        return NULL;
+    }
+
+    MappedFile_t* mappedFile = getMappedFile(file, &status);
+    if (mappedFile == NULL) {
+        return NULL;
+    }
+
+    // Nothing is mapped into the page tables yet, pages are mapped on the first access
+    mapping->processId = process->processId;
+    mapping->vAddress = vAddress;
+    mapping->numberOfPages = numberOfPages;
+    mapping->firstPage = firstPage;
+    mapping->file = mappedFile;
+    mapping->isUsed = 1;
+    return (void*) vAddress;
+}
+
+void* memoryMapping_mapFrames(PCB_t* process, const uint32_t* frames, uint32_t numberOfPages,
+                              uint8_t accessPermission) {
+    Mapping_t* mapping = getFreeMapping();
+    uint32_t vAddress = findFreeAddress(process->processId, numberOfPages);
+    if (mapping == NULL || vAddress == 0) {
+        return NULL;
+    }
+
+    uint32_t i;
+    for (i = 0; i < numberOfPages; ++i) {
+        if (mmu_mapSharedPage(process->processId, vAddress + i * SMALL_PAGE_SIZE, frames[i], accessPermission)
+                != MAP_REGION_OK) {
+            mmu_unmapSharedPages(process->processId, vAddress, i);
+            return NULL;
+        }
+    }
+
+    mapping->processId = process->processId;
+    mapping->vAddress = vAddress;
+    mapping->numberOfPages = numberOfPages;
+    mapping->firstPage = 0;
+    mapping->file = NULL;
+    mapping->isUsed = 1;
+    return (void*) vAddress;
+}
+
+int memoryMapping_unmap(PCB_t* process, void* address) {
+    int i;
+    for (i = 0; i < MEMORY_MAPPING_MAX_MAPPINGS; ++i) {
+        Mapping_t* mapping = &mappings[i];
+        if (mapping->isUsed && mapping->processId == process->processId && mapping->vAddress == (uint32_t) address
+                && mapping->file != NULL) {
+            removeMapping(mapping);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void memoryMapping_unmapAll(PCB_t* process) {
+    int i;
+    for (i = 0; i < MEMORY_MAPPING_MAX_MAPPINGS; ++i) {
+        if (mappings[i].isUsed && mappings[i].processId == process->processId) {
+            removeMapping(&mappings[i]);
+        }
+    }
+}
+
+int memoryMapping_handleFault(uint32_t faultAddress) {
+    ProcessId_t processId = scheduler_getCurrentProcess()->processId;
+    Mapping_t* mapping = NULL;
+    int i;
+    for (i = 0; i < MEMORY_MAPPING_MAX_MAPPINGS; ++i) {
+        Mapping_t* candidate = &mappings[i];
+        if (candidate->isUsed && candidate->processId == processId && faultAddress >= candidate->vAddress
+                && faultAddress < candidate->vAddress + candidate->numberOfPages * SMALL_PAGE_SIZE) {
+            mapping = candidate;
+            break;
+        }
+    }
+    if (mapping == NULL || mapping->file == NULL) {
+        return 0;
+    }
+
+    uint32_t pageInMapping = (faultAddress - mapping->vAddress) / SMALL_PAGE_SIZE;
+    uint32_t page = mapping->firstPage + pageInMapping;
+    MappedFile_t* mappedFile = mapping->file;
+
+    if (mappedFile->frames[page] == 0) {
+        // First access of any process to the page, it is read unless the page cache has it already
+        mappedFile->frames[page] = vfs_acquirePage(mappedFile->file, page);
+        if (mappedFile->frames[page] == 0) {
+            return 0;
+        }
+    }
+
+    return mmu_mapSharedPage(processId, mapping->vAddress + pageInMapping * SMALL_PAGE_SIZE,
+                             mappedFile->frames[page], RWRO) == MAP_REGION_OK;
+}
@@ -0,0 +1,55 @@
+/*
+ * memoryMapping.h
+ *
+ *      Files mapped read-only into the address space of processes (mmap). Mappings lie in the mmap region
+ *      of the process (MMAP_REGION_START_ADDRESS). A page is mapped when the process touches it for the first
+ *      time, so random access to a large file only costs the pages used. The pages are those of the page
+ *      cache, so they are shared by all processes mapping the file and with reads of the file.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_MEMORYMAPPING_MEMORYMAPPING_H_
+#define KERNEL_SYSTEMMODULES_MEMORYMAPPING_MEMORYMAPPING_H_
+
+#include <inttypes.h>
+#include "kernel/systemModules/processManagement/contextSwitch.h"
+
+// Files mapped at the same time (by any number of processes)
+#define MEMORY_MAPPING_MAX_FILES 8
+// Mappings of all processes together
+#define MEMORY_MAPPING_MAX_MAPPINGS 16
+
+/*
+ * Maps length bytes of the VFS file, starting at offset, into the process. offset has to be a multiple of
+ * the page size (4 KB) and the mapping has to lie within the file. Returns the address of the mapping,
+ * or NULL in case of error (not a regular file, invalid range, mmap region or tables full).
+ * Writes to the file are visible in the mapping. After the file is truncated or removed, the mapping keeps
+ * the old content.
+ */
+void* memoryMapping_map(PCB_t* process, int file, unsigned int length, unsigned int offset);
+
+/*
+ * Maps frames of the kernel into the process, e.g. memory shared between the kernel and the process, with
+ * RWRW or RWRO (read-only for the process). The frames stay owned by the caller, they are unmapped when the
+ * process exits. Returns the address of the mapping, or NULL if there is no room for it.
+ */
+void* memoryMapping_mapFrames(PCB_t* process, const uint32_t* frames, uint32_t numberOfPages,
+                              uint8_t accessPermission);
+
+/*
+ * Removes the file mapping starting at address from the process. Returns 0 on success, or -1 if there is none.
+ */
+int memoryMapping_unmap(PCB_t* process, void* address);
+
+/*
+ * Removes all mappings of the process, called when the process exits.
+ */
+void memoryMapping_unmapAll(PCB_t* process);
+
+/*
+ * Called on a page translation fault of the current process. Maps the page of the mapped file containing
+ * the fault address, which is read from the file if it is not in the page cache. Returns 1 if the page is mapped,
+ * 0 if the address does not belong to a mapping or the page could not be read.
+ */
+int memoryMapping_handleFault(uint32_t faultAddress);
+
+#endif /* KERNEL_SYSTEMMODULES_MEMORYMAPPING_MEMORYMAPPING_H_ */
@@ -9,6 +9,7 @@
 
 static Process_t g_processes[MAX_ALLOWED_PROCESSES];
 static Process_t* g_currentMMUProcess;
+static FrameReclaimer_t g_frameReclaimer;
 
 /* Page tables */
 /* VADDRESS, PTADDRESS, MasterPTADDRESS, PTTYPE, DOM */
@@ -29,6 +30,7 @@ static PageStatus_t g_bootRegionStatus[NR_OF_PAGES_IN_BOOT_REGION];
 static PageStatus_t g_kernelRegionStatus[NR_OF_PAGES_IN_KERNEL_REGION];               // 5 pages with 1 MB
 static PageStatus_t g_pageTableRegionStatus[NR_OF_PAGES_IN_PAGE_TABLE_REGION];        // 256 pages with 4 KB
 static PageStatus_t g_processMemoryRegionStatus[NR_OF_PAGES_IN_PROCESSMEMORY_REGION]; // 1018 pages with 1 MB
+static PageStatus_t g_framePoolStatus[NR_OF_FRAMES_IN_FRAME_POOL];                    // 512 pages with 4 KB
 
 /* Region tables */
 /* VADDRESS, PAGESIZE, NUMPAGES, AP, CB, nrOfReservedPages, PADDRESS, &PT, page status */
@@ -50,12 +52,19 @@ static Region_t g_processMemoryRegion = { .vAddress = PROCESSMEMORY_REGION_START
                                           .pAddress = PROCESSMEMORY_REGION_START_ADDRESS, .PT = NULL,
                                           .pageStatus = g_processMemoryRegionStatus};
 
+/* addresses are set when the frame pool is taken from the process memory region */
+static Region_t g_framePoolRegion = { .vAddress = 0, .pageSize = SMALL_PAGE, .numPages = NR_OF_FRAMES_IN_FRAME_POOL,
+                                      .AP = RWNA, .CB = WT, .reservedPages = 0, .pAddress = 0, .PT = NULL,
+                                      .pageStatus = g_framePoolStatus};
+
 /* declarations of static functions */
 static void mmu_initTTB(void);
 static void mmu_setDomainAccesses(void);
 static void mmu_initAllPT(void);
 static int8_t mmu_initPT(PageTable_t* pt);
 static void mmu_mapAllRegions(void);
+static void mmu_initFramePool(void);
+static int8_t mmu_initMmapPT(Process_t* process);
 static int8_t mmu_mapRegion(Region_t* region, uint16_t nrOfPages, int16_t processId);
 static int8_t mmu_mapSectionTableRegion(Region_t* region, uint16_t nrOfPages, int16_t processId);
 static int8_t mmu_mapCoarseTableRegion(Region_t* region, uint16_t nrOfPages, int16_t processId);
@@ -181,6 +190,7 @@ void mmu_killProcess(ProcessId_t processId) {
     Process_t* pProcess = &g_processes[processId];
     mmu_freePagesForProcess(pProcess);
     mmu_freePTOfProcess(pProcess);
+    pProcess->mmapPTAddress = 0;
 }
 
 void mmu_handleSectionTranslationFault(uint32_t faultAddress) {
@@ -211,6 +221,76 @@ uint32_t* mmu_getPhysicalMemoryForProcess(uint32_t nrOfNeededBytes) {
     return (uint32_t*)((uint32_t)g_processMemoryRegion.pAddress + pageIndex * SECTION_SIZE);
 }
 
+uint32_t mmu_allocateFrame(void) {
+
+    int16_t index = mmu_findFreePagesInRegion(&g_framePoolRegion, 1);
+    if (index == -1 && g_frameReclaimer != NULL && g_frameReclaimer()) {
+        /* the pool is exhausted, a frame has been given back by its user (the page cache) */
+        index = mmu_findFreePagesInRegion(&g_framePoolRegion, 1);
+    }
+    if (index == -1) {
+        return 0;
+    }
+
+    g_framePoolStatus[index].reserved = 1;
+    g_framePoolRegion.reservedPages++;
+    return g_framePoolRegion.pAddress + index * SMALL_PAGE_SIZE;
+}
+
+void mmu_freeFrame(uint32_t pAddress) {
+
+    uint16_t index = mmu_getPageIndexInRegion(&g_framePoolRegion, pAddress);
+    if (g_framePoolStatus[index].reserved) {
+        g_framePoolStatus[index].reserved = 0;
+        g_framePoolRegion.reservedPages--;
+    }
+}
+
+uint16_t mmu_getFrameIndex(uint32_t pAddress) {
+
+    return mmu_getPageIndexInRegion(&g_framePoolRegion, pAddress);
+}
+
+void mmu_setFrameReclaimer(FrameReclaimer_t reclaimer) {
+
+    g_frameReclaimer = reclaimer;
+}
+
+int8_t mmu_mapSharedPage(ProcessId_t processId, uint32_t vAddress, uint32_t pAddress, uint8_t accessPermission) {
+
+    Process_t* pProcess = &g_processes[processId];
+    if (vAddress < MMAP_REGION_START_ADDRESS || vAddress >= MMAP_REGION_START_ADDRESS + NR_OF_PAGES_IN_MMAP_REGION * SMALL_PAGE_SIZE) {
+        return MAP_REGION_NOT_OK;
+    }
+    if (pProcess->mmapPTAddress == 0 && mmu_initMmapPT(pProcess) != PT_INIT_OK) {
+        return MAP_REGION_NOT_OK;
+    }
+
+    uint16_t section = (vAddress - MMAP_REGION_START_ADDRESS) / SECTION_SIZE;
+    PageTable_t mmapPT = {MMAP_REGION_START_ADDRESS + section * SECTION_SIZE, pProcess->mmapPTAddress + section * COARSE_PT_SIZE,
+                          pProcess->pageTable.ptAddress, COARSE, MMAP_DOMAIN};
+
+    PageStatus_t pageStatus;    /* the status of the frame is kept by the frame pool */
+    Region_t sharedPage = {vAddress, SMALL_PAGE, 1, accessPermission, WT, 0, pAddress, &mmapPT, &pageStatus};
+    return mmu_mapRegion(&sharedPage, 1, processId);
+}
+
+void mmu_unmapSharedPages(ProcessId_t processId, uint32_t vAddress, uint16_t nrOfPages) {
+
+    Process_t* pProcess = &g_processes[processId];
+    if (pProcess->mmapPTAddress == 0) {
+        return;
+    }
+
+    /* the COARSE page tables of the mmap region are contiguous, so the entries of all its pages form one array */
+    uint32_t* pPTE = (uint32_t*)pProcess->mmapPTAddress + (vAddress - MMAP_REGION_START_ADDRESS) / SMALL_PAGE_SIZE;
+    int i;
+    for (i = 0; i < nrOfPages; i++) {
+        *pPTE++ = mmu_createSecondLevelFaultDescriptor();
+    }
+    mmu_flushTLB();
+}
+
 static void mmu_initTTB(void) {
     mmu_setTTBCR();
     mmu_setTTBR1(g_masterPTOS.ptAddress, TTBR1_BIT_MASK);          /* master PT for OS */
@@ -262,6 +342,54 @@ static void mmu_mapAllRegions(void) {
     mmu_mapRegion(&g_kernelRegion, g_kernelRegion.numPages, 0);
     mmu_attachPT(&g_pageTablePT, &g_masterPTOS);
     mmu_mapRegion(&g_pageTableRegion, 12, 0);
+    mmu_initFramePool();
+}
+
+/**
+ * takes the sections of the frame pool from the process memory region and maps them 1:1 for the kernel,
+ * so that frames can be filled before they are mapped into processes
+ */
+static void mmu_initFramePool(void) {
+
+    int16_t index = mmu_findFreePagesInRegion(&g_processMemoryRegion, NR_OF_SECTIONS_IN_FRAME_POOL);
+    uint32_t pAddress = g_processMemoryRegion.pAddress + index * SECTION_SIZE;
+    Region_t framePoolSections = {pAddress, SECTION, NR_OF_SECTIONS_IN_FRAME_POOL, RWNA, WT, 0, pAddress, &g_masterPTOS,
+                                  g_processMemoryRegionStatus + index};
+
+    mmu_mapRegion(&framePoolSections, framePoolSections.numPages, 0);
+    g_processMemoryRegion.reservedPages += framePoolSections.numPages;
+
+    g_framePoolRegion.vAddress = pAddress;
+    g_framePoolRegion.pAddress = pAddress;
+}
+
+/**
+ * allocates the page holding the COARSE page tables of the mmap region of a process
+ * and attaches them to its master page table
+ */
+static int8_t mmu_initMmapPT(Process_t* process) {
+
+    int16_t freePageIndexForPT = mmu_findFreePagesInRegion(&g_pageTableRegion, 1);
+    if (freePageIndexForPT == -1) {
+        return PT_INIT_NOT_OK;
+    }
+
+    uint32_t pPT = g_pageTableRegion.pAddress + freePageIndexForPT * SMALL_PAGE_SIZE;
+    PageStatus_t* pPTStatus = (PageStatus_t*)(g_pageTableRegionStatus + freePageIndexForPT);
+    Region_t mmapPTRegion = {pPT, SMALL_PAGE, 1, RWRW, WT, 0, pPT, &g_pageTablePT, pPTStatus};
+    g_pageTableRegion.reservedPages += 1;
+    mmu_mapRegion(&mmapPTRegion, mmapPTRegion.numPages, process->pcb->processId);
+
+    int i;
+    for (i = 0; i < NR_OF_SECTIONS_IN_MMAP_REGION; i++) {
+        PageTable_t mmapPT = {MMAP_REGION_START_ADDRESS + i * SECTION_SIZE, pPT + i * COARSE_PT_SIZE,
+                              process->pageTable.ptAddress, COARSE, MMAP_DOMAIN};
+        mmu_initPT(&mmapPT);
+        mmu_attachPT(&mmapPT, &process->pageTable);
+    }
+
+    process->mmapPTAddress = pPT;
+    return PT_INIT_OK;
 }
 
 static int8_t mmu_mapRegion(Region_t* region, uint16_t nrOfPages, int16_t processId) {
@@ -421,6 +549,8 @@ static void mmu_attachPT(PageTable_t* pt, PageTable_t* masterPT) {
 
 static void mmu_setDomainAccesses(void) {
     uint32_t right = MASK_ALL_DOM;
+    right &= ~(DOM_AP_MANAGER << (MMAP_DOMAIN * 2));
+    right |= DOM_AP_CLIENT << (MMAP_DOMAIN * 2);
     mmu_setDomainAccess(right, MASK_ALL_DOM);
 }
 
@@ -533,9 +663,10 @@ static void mmu_freePTOfProcess(Process_t* process) {
     int i;
     PageStatus_t* pStatus = g_pageTableRegion.pageStatus;
     for (i = 0; i < g_pageTableRegion.numPages; i++) {
-        if (pStatus->processId == process->pcb->processId) {
+        if (pStatus->reserved && pStatus->processId == process->pcb->processId) {
             pStatus->reserved = 0;
             pStatus->processId = 0;
+            g_pageTableRegion.reservedPages--;
         }
         pStatus++;
     }
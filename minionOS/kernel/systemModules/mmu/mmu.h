@@ -18,6 +18,7 @@
 #define VIRTUAL_MEMORY_STACK_POINTER            0x00140000
 #define VIRTUAL_MEMORY_START_ADDRESS            0x00100000
 #define VIRTUAL_PROCESS_START_ADDRESS           0x0014033C
+#define MMAP_REGION_START_ADDRESS               0x10000000
 #define BOOT_REGION_START_ADDRESS               0x40000000
 #define KERNEL_REGION_START_ADDRESS             0x80000000
 #define PAGE_TABLE_REGION_START_ADDRESS         0x80500000
@@ -31,6 +32,15 @@
 #define NR_OF_PAGES_IN_PAGE_TABLE_REGION        256
 #define NR_OF_PAGES_IN_PROCESSMEMORY_REGION     1018
 
+/* memory mapped files of a process: 4 MB, the 4 COARSE page tables fit into one page of the page table region */
+#define NR_OF_SECTIONS_IN_MMAP_REGION           4
+#define NR_OF_PAGES_IN_MMAP_REGION              (NR_OF_SECTIONS_IN_MMAP_REGION * 256)
+#define COARSE_PT_SIZE                          0x400
+
+/* 4 KB frames for pages shared between processes, taken from the process memory region at boot */
+#define NR_OF_SECTIONS_IN_FRAME_POOL            2
+#define NR_OF_FRAMES_IN_FRAME_POOL              (NR_OF_SECTIONS_IN_FRAME_POOL * 256)
+
 /* page table types */
 #define FAULT   0
 #define COARSE  1
@@ -84,10 +94,14 @@ typedef struct {
     PageStatus_t* pageStatus;   // holds the status for each page of the region: 0 - page is free, 1 - page is occupied
 } Region_t;
 
+/* gives a frame back to the frame pool (with mmu_freeFrame), returns 0 if there is none to give back */
+typedef int (*FrameReclaimer_t)(void);
+
 typedef struct {
     PCB_t* pcb;
     PageTable_t pageTable;
     Region_t region;
+    uint32_t mmapPTAddress;     // page holding the COARSE page tables of the mmap region, 0 until a page is mapped there
 } Process_t;
 
 /* functions for initializing MMU */
@@ -100,6 +114,14 @@ void mmu_killProcess(ProcessId_t processId);
 uint32_t* mmu_getPhysicalMemoryForProcess(uint32_t nrOfNeededBytes);
 int8_t mmu_mapRegionDirectly(uint32_t pAddress, uint32_t nrOfNeededBytes, uint16_t pageSize);
 
+/* functions for shared pages (frames are mapped 1:1 for the kernel) */
+uint32_t mmu_allocateFrame(void);
+void mmu_freeFrame(uint32_t pAddress);
+uint16_t mmu_getFrameIndex(uint32_t pAddress);
+void mmu_setFrameReclaimer(FrameReclaimer_t reclaimer);
+int8_t mmu_mapSharedPage(ProcessId_t processId, uint32_t vAddress, uint32_t pAddress, uint8_t accessPermission);
+void mmu_unmapSharedPages(ProcessId_t processId, uint32_t vAddress, uint16_t nrOfPages);
+
 /* functions for handling faults */
 void mmu_handleSectionTranslationFault(uint32_t faultAddress);
 
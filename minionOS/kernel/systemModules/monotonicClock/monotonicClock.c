@@ -0,0 +1,152 @@
+/*
+ * monotonicClock.c
+ *
+ *      The cycle counter runs at the CPU clock, whose frequency is only known from the calibration. So every
+ *      update continues the clock from the interpolated time, never from the sync counter directly, and
+ *      corrects the difference to the sync counter through the nanoseconds per cycle until the next update.
+ *      Only if the clock lags by more than CLOCK_MAX_LAG_NS it is set forward to the sync counter.
+ */
+
+#include "monotonicClock.h"
+#include "kernel/common/mmio.h"
+#include "kernel/devices/omap3530/includes/clock.h"
+#include "kernel/devices/omap3530/includes/timer.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "kernel/systemModules/mmu/mmu.h"
+#include "kernel/systemModules/memoryMapping/memoryMapping.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
+#include <string.h>
+
+#define CLOCK_UPDATE_INTERVAL_MS 1
+#define CLOCK_CALIBRATION_SYNC_TICKS 328
+
+// 10^9 / 32768 nanoseconds per tick of the sync counter
+#define NANOSECONDS_PER_64_SYNC_TICKS 1953125
+
+// Larger lags are caught up at once, smaller differences by a part per update
+#define CLOCK_MAX_LAG_NS 1000000
+#define CLOCK_CORRECTION_DIVISOR 8
+
+// Cycles counted since an update at most, so that a late update (or a process resetting the cycle counter)
+// lets the clock stand still until the update instead of jumping
+#define CLOCK_MAX_CYCLES_MS 8
+
+extern void asm_enableCycleCounter(void);
+extern uint32_t asm_readCycleCounter(void);
+
+// In a frame of the frame pool if one was available at boot, only then it can be mapped into processes
+static ClockPage_t g_kernelPage;
+static ClockPage_t* g_page = &g_kernelPage;
+static uint32_t g_pageFrame;
+
+static uint32_t g_nominalNanosecondsPerCycle;
+static uint32_t g_cyclesPerUpdate;
+
+// Sync counter extended to 64 bits, it wraps after 36 hours
+static uint32_t g_lastSyncTicks;
+static uint32_t g_syncTicksHigh;
+
+// Address of the clock page per process, NULL if not mapped
+static const ClockPage_t* g_mappedPages[MAX_ALLOWED_PROCESSES + 1];
+
+static uint64_t getSyncNanoseconds(void) {
+    uint32_t ticks = get32(SYNC_32K_COUNTER_CR);
+    if (ticks < g_lastSyncTicks) {
+        g_syncTicksHigh++;
+    }
+    g_lastSyncTicks = ticks;
+    uint64_t allTicks = ((uint64_t) g_syncTicksHigh << 32) | ticks;
+
+    // The middle of the current tick
+    return (allTicks * 2 + 1) * NANOSECONDS_PER_64_SYNC_TICKS / 128;
+}
+
+static uint64_t interpolate(uint32_t cycles) {
+    uint32_t elapsedCycles = cycles - g_page->baseCycles;
+    if (elapsedCycles > g_page->maxCycles) {
+        elapsedCycles = g_page->maxCycles;
+    }
+    return g_page->baseNanoseconds + (((uint64_t) elapsedCycles * g_page->nanosecondsPerCycle) >> CLOCK_PAGE_SHIFT);
+}
+
+static void update(PCB_t* currentPcb) {
+    uint32_t cycles = asm_readCycleCounter();
+    uint64_t now = interpolate(cycles);
+    int64_t difference = (int64_t) (getSyncNanoseconds() - now);
+    if (difference > CLOCK_MAX_LAG_NS) {
+        now += difference;
+        difference = 0;
+    }
+
+    int64_t nanosecondsPerCycle = g_nominalNanosecondsPerCycle
+            + difference / CLOCK_CORRECTION_DIVISOR * ((int64_t) 1 << CLOCK_PAGE_SHIFT) / g_cyclesPerUpdate;
+    if (nanosecondsPerCycle < g_nominalNanosecondsPerCycle / 2) {
+        nanosecondsPerCycle = g_nominalNanosecondsPerCycle / 2;
+    } else if (nanosecondsPerCycle > g_nominalNanosecondsPerCycle * 2) {
+        nanosecondsPerCycle = g_nominalNanosecondsPerCycle * 2;
+    }
+
+    // Processes are interrupted only, so they see the sequence change and never an odd one
+    g_page->sequence++;
+    g_page->baseCycles = cycles;
+    g_page->baseNanoseconds = now;
+    g_page->nanosecondsPerCycle = nanosecondsPerCycle;
+    g_page->sequence++;
+}
+
+static uint32_t waitForSyncTick(void) {
+    uint32_t ticks = get32(SYNC_32K_COUNTER_CR);
+    while (get32(SYNC_32K_COUNTER_CR) == ticks) {
+    }
+    return ticks + 1;
+}
+
+void monotonicClock_init(void) {
+    or32(WKUP_CM + CM_ICLKEN_WKUP, 1UL << EN_32KSYNC);
+    asm_enableCycleCounter();
+
+    unsigned int previousState = _disable_interrupts();
+    uint32_t startTicks = waitForSyncTick();
+    uint32_t startCycles = asm_readCycleCounter();
+    while (get32(SYNC_32K_COUNTER_CR) - startTicks < CLOCK_CALIBRATION_SYNC_TICKS) {
+    }
+    uint32_t calibrationCycles = asm_readCycleCounter() - startCycles;
+    _restore_interrupts(previousState);
+
+    g_nominalNanosecondsPerCycle = (((uint64_t) CLOCK_CALIBRATION_SYNC_TICKS * NANOSECONDS_PER_64_SYNC_TICKS)
+            << CLOCK_PAGE_SHIFT) / (64 * (uint64_t) calibrationCycles);
+    g_cyclesPerUpdate = (uint64_t) calibrationCycles * SYNC_32K_TICKS_PER_SECOND * CLOCK_UPDATE_INTERVAL_MS
+            / (1000 * CLOCK_CALIBRATION_SYNC_TICKS);
+
+    g_pageFrame = mmu_allocateFrame();
+    if (g_pageFrame != 0) {
+        g_page = (ClockPage_t*) g_pageFrame;
+    }
+    memset(g_page, 0, sizeof(ClockPage_t));
+    g_page->maxCycles = g_cyclesPerUpdate * CLOCK_MAX_CYCLES_MS / CLOCK_UPDATE_INTERVAL_MS;
+    g_page->nanosecondsPerCycle = g_nominalNanosecondsPerCycle;
+    g_page->baseCycles = asm_readCycleCounter();
+    g_page->baseNanoseconds = getSyncNanoseconds();
+
+    SubscriptionId_t subscription = systemTimer_subscribeCallback(CLOCK_UPDATE_INTERVAL_MS, &update);
+    systemTimer_enableSubscription(subscription);
+}
+
+uint64_t monotonicClock_getNanoseconds(void) {
+    unsigned int previousState = _disable_interrupts();
+    uint64_t nanoseconds = interpolate(asm_readCycleCounter());
+    _restore_interrupts(previousState);
+    return nanoseconds;
+}
+
+const ClockPage_t* monotonicClock_mapPage(PCB_t* process) {
+    ProcessId_t processId = process->processId;
+    if (g_mappedPages[processId] == NULL && g_pageFrame != 0) {
+        g_mappedPages[processId] = (const ClockPage_t*) memoryMapping_mapFrames(process, &g_pageFrame, 1, RWRO);
+    }
+    return g_mappedPages[processId];
+}
+
+void monotonicClock_release(PCB_t* process) {
+    g_mappedPages[process->processId] = NULL;
+}
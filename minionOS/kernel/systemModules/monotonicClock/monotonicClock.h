@@ -0,0 +1,38 @@
+/*
+ * monotonicClock.h
+ *
+ *      Nanoseconds since power-on, 64 bits. The 32 kHz sync counter is the reference, the cycle counter of the
+ *      Cortex-A8 interpolates between its ticks of 30.5 us. The clock is kept in a page (clockPage.h) which
+ *      processes map read-only, so they read the time without a system call.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_MONOTONICCLOCK_MONOTONICCLOCK_H_
+#define KERNEL_SYSTEMMODULES_MONOTONICCLOCK_MONOTONICCLOCK_H_
+
+#include <inttypes.h>
+#include "clockPage.h"
+#include "kernel/systemModules/processManagement/contextSwitch.h"
+
+/*
+ * Enables the counters, measures the frequency of the cycle counter against the sync counter (10 ms) and
+ * starts the updates of the clock. Called once at boot after the MMU and the system timer are initialized.
+ */
+void monotonicClock_init(void);
+
+/*
+ * Returns the time in nanoseconds. It never decreases, also if the cycle counter drifts from the sync counter.
+ */
+uint64_t monotonicClock_getNanoseconds(void);
+
+/*
+ * Maps the clock page read-only into the process, once. Returns its address in the process, or NULL if
+ * there is no room for it.
+ */
+const ClockPage_t* monotonicClock_mapPage(PCB_t* process);
+
+/*
+ * Forgets the mapping of the process, called when the process exits (the mapping is removed with the others).
+ */
+void monotonicClock_release(PCB_t* process);
+
+#endif /* KERNEL_SYSTEMMODULES_MONOTONICCLOCK_MONOTONICCLOCK_H_ */
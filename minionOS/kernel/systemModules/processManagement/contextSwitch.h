@@ -12,6 +12,9 @@
 
 typedef uint8_t ProcessId_t;
 
+// Maximum number of file descriptors per process
+#define MAX_FILES_PER_PROCESS 32
+
 struct Register
 {
     uint32_t R0;
@@ -45,6 +48,9 @@ typedef struct PCB
 
     ProcessId_t processId;
     ProcessStatus_t status;
+
+    // Maps the file descriptors of the process to VFS files (see processFiles.h)
+    int16_t files[MAX_FILES_PER_PROCESS];
 } PCB_t;
 
 void copyPcb(PCB_t * source, PCB_t * target);
@@ -6,9 +6,14 @@
  */
 
 #include "processManager.h"
+#include "kernel/systemModules/filesystem/processFiles.h"
+#include "kernel/systemModules/memoryMapping/memoryMapping.h"
+#include "kernel/systemModules/asyncIo/asyncIo.h"
+#include "kernel/systemModules/monotonicClock/monotonicClock.h"
 
 int8_t processManager_loadProcess(uint32_t physicalStartAddress, uint32_t nrOfNeededBytes, uint32_t stackPointer, uint32_t entryPoint){
     PCB_t* pPcb = scheduler_startProcess(entryPoint, stackPointer, 0x60000110);
+    processFiles_init(pPcb);
     return mmu_initProcess(physicalStartAddress, VIRTUAL_MEMORY_START_ADDRESS, nrOfNeededBytes, pPcb, 1);
 }
 
@@ -19,10 +24,18 @@ uint32_t* processManager_getPhysicalMemoryForProcess(uint32_t nrOfNeededBytes) {
 }
 
 void processManager_killProcess(ProcessId_t processId) {
+    memoryMapping_unmapAll(scheduler_getProcess(processId));
+    asyncIo_release(scheduler_getProcess(processId));
+    monotonicClock_release(scheduler_getProcess(processId));
+    processFiles_closeAll(scheduler_getProcess(processId));
     mmu_killProcess(processId);
     scheduler_stopProcess(processId);
 }
 
 void processManager_terminateCurrentProcess(PCB_t* pcb) {
+    memoryMapping_unmapAll(scheduler_getCurrentProcess());
+    asyncIo_release(scheduler_getCurrentProcess());
+    monotonicClock_release(scheduler_getCurrentProcess());
+    processFiles_closeAll(scheduler_getCurrentProcess());
     scheduler_terminateCurrentProcess(pcb);
 }
@@ -107,6 +107,10 @@ PCB_t * scheduler_getCurrentProcess(void) {
     return g_currentProcess;
 }
 
+PCB_t * scheduler_getProcess(ProcessId_t processId) {
+    return &g_processes[processId];
+}
+
 void scheduler_prepareSwitchToIdleProcess() {
     _call_swi(SWITCH_TO_IDLE_SWI_NUMBER);
 }
@@ -120,13 +124,42 @@ void scheduler_switchToIdleProcess(PCB_t* pcb) {
     pcb->status = idleProcess->status;
 }
 
+/*
+ * A blocked process keeps running until the next scheduler tick, which does not put it back into the ready queue.
+ */
 void scheduler_blockProcess(ProcessId_t processId) {
     g_processes[processId].status = BLOCKED;
 }
 
 void scheduler_unblockProcess(ProcessId_t processId) {
-    g_processes[processId].status = WAITING;
-    addReadyProcess(&g_processes[processId]);
+    PCB_t * process = &g_processes[processId];
+    if (process->status != BLOCKED || process->processId != processId)
+    {
+        // Not blocked, or killed meanwhile
+        return;
+    }
+
+    if (process == g_currentProcess)
+    {
+        // Unblocked before the scheduler tick took it off the CPU
+        process->status = RUNNING;
+        return;
+    }
+
+    process->status = WAITING;
+    addReadyProcess(process);
+    if (g_currentProcess == NULL || g_currentProcess->processId == 0)
+    {
+        scheduler_yield();
+    }
+}
+
+/*
+ * Has the scheduler tick run at the next system timer tick instead of at the end of the interval,
+ * e.g. after the current process has been blocked.
+ */
+void scheduler_yield(void) {
+    systemTimer_expediteSubscription(g_systemTimerId);
 }
 
 static void handleSchedulerTick(PCB_t * currentPcb)
@@ -141,7 +174,10 @@ static void handleSchedulerTick(PCB_t * currentPcb)
     }
     else if (g_queueReady.size > 0 && g_currentProcess != NULL)
     {
-        if (g_currentProcess->status != DEAD && g_currentProcess->processId > 0) {
+        if (g_currentProcess->status == BLOCKED) {
+            // Save old process, it is added to the ready queue when it is unblocked
+            copyPcb(currentPcb, g_currentProcess);
+        } else if (g_currentProcess->status != DEAD && g_currentProcess->processId > 0) {
             // Save old process and add to ready queue
             g_currentProcess->status = WAITING;
             copyPcb(currentPcb, g_currentProcess);
@@ -157,9 +193,11 @@ static void handleSchedulerTick(PCB_t * currentPcb)
         currentPcb->processId = g_currentProcess->processId;
         mmu_switchProcess(currentPcb);
     }
-    else if (g_currentProcess == NULL || g_currentProcess->status == DEAD)
+    else if (g_currentProcess == NULL || g_currentProcess->status == DEAD || g_currentProcess->status == BLOCKED)
     {
-        if (g_currentProcess != NULL) {
+        if (g_currentProcess != NULL && g_currentProcess->status == BLOCKED) {
+            copyPcb(currentPcb, g_currentProcess);
+        } else if (g_currentProcess != NULL) {
             g_currentProcess->processId = 0;
         }
 
@@ -26,6 +26,7 @@ void scheduler_start(void);
 void scheduler_stop(void);
 
 PCB_t * scheduler_getCurrentProcess(void);
+PCB_t * scheduler_getProcess(ProcessId_t processId);
 
 PCB_t* scheduler_startProcess(uint32_t startAddress, uint32_t stackPointer, uint32_t cpsr);
 void scheduler_stopProcess(ProcessId_t processId);
@@ -34,5 +35,6 @@ void scheduler_prepareSwitchToIdleProcess();
 void scheduler_switchToIdleProcess(PCB_t* pcb);
 void scheduler_blockProcess(ProcessId_t processId);
 void scheduler_unblockProcess(ProcessId_t processId);
+void scheduler_yield(void);
 
 #endif /* KERNEL_SYSTEMMODULES_SCHEDULER_SCHEDULER_H_ */
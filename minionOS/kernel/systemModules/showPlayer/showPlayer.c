@@ -0,0 +1,183 @@
+/*
+ * showPlayer.c
+ *
+ *      Each player reads its file into a ring buffer. Events are decoded from the bytes read so far while the
+ *      decoded bytes are replaced by the following ones, one sector per tick at most: the ticks run in the
+ *      timer interrupt, which must not wait for more than one polled read of the SD card. The reads bypass the
+ *      page cache, which would read a whole page on a miss. That is still 500 kB per second, far more than the
+ *      frames of a universe take. An event is applied once the
+ *      milliseconds since the start of the show reach its time, in the first tick after, so it is part of the
+ *      next DMX frame.
+ */
+
+#include "showPlayer.h"
+#include "showFile.h"
+#include "dmxControl.h"
+#include "kernel/hal/dmx/dmx.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "kernel/systemModules/filesystem/vfs.h"
+#include <string.h>
+
+// Bytes read per tick, one sector
+#define SHOW_READ_SIZE 512
+#define SHOW_BUFFER_SIZE (8 * SHOW_READ_SIZE)
+#define SHOW_TICK_INTERVAL_MS 1
+
+typedef struct {
+    // Bytes read ahead start at head and wrap around at the end
+    uint8_t buffer[SHOW_BUFFER_SIZE];
+    uint32_t head;
+    uint32_t count;
+    int isEndOfFile;
+
+    int file;
+    uint64_t startTime;
+    int isPlaying;
+} ShowPlayer_t;
+
+// Indexed by universe
+static ShowPlayer_t g_players[DMX_MAX_UNIVERSES];
+
+static uint16_t readUint16(const uint8_t* bytes) {
+    return bytes[0] | (bytes[1] << 8);
+}
+
+static uint32_t readUint32(const uint8_t* bytes) {
+    return readUint16(bytes) | ((uint32_t) readUint16(bytes + 2) << 16);
+}
+
+static void copyFromBuffer(const ShowPlayer_t* player, uint8_t* destination, uint32_t size) {
+    uint32_t i;
+    for (i = 0; i < size; ++i) {
+        destination[i] = player->buffer[(player->head + i) % SHOW_BUFFER_SIZE];
+    }
+}
+
+static void consume(ShowPlayer_t* player, uint32_t size) {
+    player->head = (player->head + size) % SHOW_BUFFER_SIZE;
+    player->count -= size;
+}
+
+/*
+ * Reads the next SHOW_READ_SIZE bytes of the file if there is room for them. They are read whole until the
+ * end of the file, so the free space always starts at a multiple of the read size and a read does not wrap.
+ */
+static void readAhead(ShowPlayer_t* player) {
+    if (player->isEndOfFile || player->count > SHOW_BUFFER_SIZE - SHOW_READ_SIZE) {
+        return;
+    }
+
+    uint32_t freePosition = (player->head + player->count) % SHOW_BUFFER_SIZE;
+    int bytesRead = vfs_readUncached(player->file, player->buffer + freePosition, SHOW_READ_SIZE);
+    if (bytesRead < SHOW_READ_SIZE) {
+        player->isEndOfFile = 1;
+    }
+    if (bytesRead > 0) {
+        player->count += bytesRead;
+    }
+}
+
+static void stopPlayer(ShowPlayer_t* player) {
+    if (player->isPlaying) {
+        vfs_close(player->file);
+        player->isPlaying = 0;
+    }
+}
+
+/*
+ * Applies the events whose time has come. Returns 0 if the show is over.
+ */
+static int playEvents(ShowPlayer_t* player, uint8_t universe) {
+    uint64_t showTime = systemTimer_getMilliseconds() - player->startTime;
+    while (player->count >= SHOW_EVENT_HEADER_SIZE) {
+        uint8_t header[SHOW_EVENT_HEADER_SIZE];
+        copyFromBuffer(player, header, SHOW_EVENT_HEADER_SIZE);
+        if (readUint32(header) > showTime) {
+            return 1;
+        }
+
+        uint16_t startSlot = readUint16(header + 4);
+        uint16_t length = readUint16(header + 6);
+        if (length > DMX_UNIVERSE_SIZE) {
+            // Not a show file after all
+            return 0;
+        }
+        if (player->count < SHOW_EVENT_HEADER_SIZE + length) {
+            // The rest of the event is read with the next tick
+            return !player->isEndOfFile;
+        }
+
+        // The values may wrap around the end of the buffer, then they are two patches of the same frame
+        uint32_t valuesPosition = (player->head + SHOW_EVENT_HEADER_SIZE) % SHOW_BUFFER_SIZE;
+        uint16_t firstLength = length;
+        if (firstLength > SHOW_BUFFER_SIZE - valuesPosition) {
+            firstLength = SHOW_BUFFER_SIZE - valuesPosition;
+        }
+        dmx_patch(universe, startSlot, player->buffer + valuesPosition, firstLength);
+        if (firstLength < length) {
+            dmx_patch(universe, startSlot + firstLength, player->buffer, length - firstLength);
+        }
+        consume(player, SHOW_EVENT_HEADER_SIZE + length);
+    }
+    return !player->isEndOfFile;
+}
+
+static void handleTick(PCB_t* currentPcb) {
+    uint8_t universe;
+    for (universe = 0; universe < DMX_MAX_UNIVERSES; ++universe) {
+        ShowPlayer_t* player = &g_players[universe];
+        if (!player->isPlaying) {
+            continue;
+        }
+        readAhead(player);
+        if (!playEvents(player, universe)) {
+            stopPlayer(player);
+        }
+    }
+}
+
+void showPlayer_init(void) {
+    SubscriptionId_t subscription = systemTimer_subscribeCallback(SHOW_TICK_INTERVAL_MS, &handleTick);
+    systemTimer_enableSubscription(subscription);
+}
+
+int showPlayer_play(uint8_t universe, const char* fileName) {
+    if (universe >= DMX_MAX_UNIVERSES) {
+        return DMX_INVALID_SHOW;
+    }
+    ShowPlayer_t* player = &g_players[universe];
+    stopPlayer(player);
+
+    player->file = vfs_open(fileName, OPEN_READ);
+    if (!isValidFile(player->file)) {
+        return DMX_INVALID_SHOW;
+    }
+    player->head = 0;
+    player->count = 0;
+    player->isEndOfFile = 0;
+
+    // Called by a process, so the buffer is filled at once rather than by the ticks
+    uint32_t i;
+    for (i = 0; i < SHOW_BUFFER_SIZE / SHOW_READ_SIZE; ++i) {
+        readAhead(player);
+    }
+
+    uint8_t header[SHOW_FILE_HEADER_SIZE];
+    copyFromBuffer(player, header, SHOW_FILE_HEADER_SIZE);
+    if (player->count < SHOW_FILE_HEADER_SIZE || memcmp(header, SHOW_FILE_MAGIC, 4) != 0
+            || readUint16(header + 4) != SHOW_FILE_VERSION) {
+        vfs_close(player->file);
+        return DMX_INVALID_SHOW;
+    }
+    consume(player, SHOW_FILE_HEADER_SIZE);
+
+    player->startTime = systemTimer_getMilliseconds();
+    player->isPlaying = 1;
+    return 0;
+}
+
+void showPlayer_stop(uint8_t universe) {
+    if (universe < DMX_MAX_UNIVERSES) {
+        stopPlayer(&g_players[universe]);
+    }
+}
@@ -0,0 +1,29 @@
+/*
+ * showPlayer.h
+ *
+ *      Plays show files (showFile.h) into DMX universes in the background. The file is streamed through a
+ *      small buffer while the show runs, events are applied as patches when their time has come.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_SHOWPLAYER_SHOWPLAYER_H_
+#define KERNEL_SYSTEMMODULES_SHOWPLAYER_SHOWPLAYER_H_
+
+#include <inttypes.h>
+
+/*
+ * Starts playing in the background, called once at boot after the system timer is initialized.
+ */
+void showPlayer_init(void);
+
+/*
+ * Plays the show file with the given absolute name into the universe, replacing the show playing there. The
+ * show starts now. Returns 0, or DMX_INVALID_SHOW if the file cannot be opened or is not a show file.
+ */
+int showPlayer_play(uint8_t universe, const char* fileName);
+
+/*
+ * Stops the show playing into the universe. The slots keep the values of the last event played.
+ */
+void showPlayer_stop(uint8_t universe);
+
+#endif /* KERNEL_SYSTEMMODULES_SHOWPLAYER_SHOWPLAYER_H_ */
@@ -3,29 +3,104 @@
 #include "kernel/systemModules/systemCalls/dispatcher.h"
 #include "kernel/hal/led/led.h"
 #include "kernel/systemModules/filesystem/vfs.h"
+#include "kernel/systemModules/filesystem/processFiles.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
 #include "kernel/hal/dmx/dmx.h"
 #include "drivers/dmx/tmh7/dmxTmh7.h"
 #include "drivers/dmx/mhx25/dmxMhx25.h"
 #include "kernel/systemModules/loader/loader.h"
+#include "kernel/systemModules/memoryMapping/memoryMapping.h"
+#include "kernel/systemModules/asyncIo/asyncIo.h"
+#include "kernel/systemModules/monotonicClock/monotonicClock.h"
 
 
-int dispatcher_dispatch(SysCallArgs_t args) {
+static PCB_t* g_callingProcess;
+
+/*
+ * Returns the VFS file of a file descriptor of the calling process.
+ */
+static int getFile(int fileDescriptor) {
+    return processFiles_get(scheduler_getCurrentProcess(), fileDescriptor);
+}
+
+/*
+ * Touches every page of a buffer the kernel reads from. Pages of mapped files are mapped by the abort handler
+ * now, not while the file system is in the middle of the request and reading the page would reenter it.
+ */
+static void prefault(const uint8_t* buffer, unsigned int bufferSize) {
+    if (bufferSize == 0) {
+        return;
+    }
+    uint32_t address = (uint32_t) buffer;
+    uint32_t end = address + bufferSize;
+    while (address < end) {
+        (void) *(volatile const uint8_t*) address;
+        address = (address & ~(SMALL_PAGE_SIZE - 1)) + SMALL_PAGE_SIZE;
+    }
+}
+
+PCB_t* dispatcher_getCallingProcess(void) {
+    return g_callingProcess;
+}
+
+static int dispatch(SysCallArgs_t args) {
     switch (args.systemCallNumber) {
     case SYSCALL_FILE_OPEN:
-        return vfs_open((const char*) args.a);
+        return processFiles_open(scheduler_getCurrentProcess(), (const char*) args.a, args.b);
     case SYSCALL_FILE_READ:
-        return vfs_read(args.a, (uint8_t*) args.b, args.c);
+        return vfs_read(getFile(args.a), (uint8_t*) args.b, args.c);
     case SYSCALL_FILE_WRITE:
-        vfs_write(args.a, (const uint8_t*) args.b, args.c);
-        break;
+        prefault((const uint8_t*) args.b, args.c);
+        return vfs_write(getFile(args.a), (const uint8_t*) args.b, args.c);
     case SYSCALL_FILE_CLOSE:
-        vfs_close(args.a);
+        processFiles_close(scheduler_getCurrentProcess(), args.a);
         break;
-    case SYSCALL_READDIR:
-        return (int) vfs_readdir((const char*) args.a);
+    case SYSCALL_FILE_DUP:
+        return processFiles_dup(scheduler_getCurrentProcess(), args.a);
+    case SYSCALL_OPENDIR:
+        return processFiles_openDirectory(scheduler_getCurrentProcess(), (const char*) args.a);
+    case SYSCALL_GETDENTS:
+        return vfs_getdents(getFile(args.a), (DirectoryEntry_t*) args.b, args.c);
+    case SYSCALL_STAT:
+        return vfs_stat((const char*) args.a, (FileStatus_t*) args.b);
+    case SYSCALL_FSTAT:
+        return vfs_fstat(getFile(args.a), (FileStatus_t*) args.b);
+    case SYSCALL_UNLINK:
+        return vfs_unlink((const char*) args.a);
     case SYSCALL_LOAD_PROGRAM:
         return loader_loadProcess((const char*) args.a, ELF);
+    case SYSCALL_SYNC:
+        vfs_sync();
+        break;
+    case SYSCALL_FILE_SEEK:
+        return vfs_lseek(getFile(args.a), args.b, args.c);
+    case SYSCALL_FILE_PREAD: {
+        const SysCallPositionedIoArgs_t* ioArgs = (const SysCallPositionedIoArgs_t*) args.b;
+        return vfs_pread(getFile(args.a), (uint8_t*) ioArgs->buffer, ioArgs->bufferSize, ioArgs->offset);
+    }
+    case SYSCALL_MMAP:
+        return (int) memoryMapping_map(scheduler_getCurrentProcess(), getFile(args.a), args.b, args.c);
+    case SYSCALL_MUNMAP:
+        return memoryMapping_unmap(scheduler_getCurrentProcess(), (void*) args.a);
+    case SYSCALL_ASYNC_IO_SETUP:
+        return (int) asyncIo_setup(scheduler_getCurrentProcess(), args.a, (uint8_t**) args.b);
+    case SYSCALL_ASYNC_IO_WAIT:
+        return asyncIo_wait(scheduler_getCurrentProcess(), args.a);
+    case SYSCALL_FILE_IOCTL:
+        return vfs_ioctl(getFile(args.a), args.b, (void*) args.c);
+    case SYSCALL_CLOCK_GET_TIME:
+        *(uint64_t*) args.a = monotonicClock_getNanoseconds();
+        return 0;
+    case SYSCALL_CLOCK_MAP_PAGE:
+        return (int) monotonicClock_mapPage(scheduler_getCurrentProcess());
     }
     return -1;
 }
 
+int dispatcher_dispatch(SysCallArgs_t args) {
+    g_callingProcess = scheduler_getCurrentProcess();
+    int result = dispatch(args);
+    g_callingProcess = NULL;
+    return result;
+}
+
@@ -2,7 +2,14 @@
 #define KERNEL_SYSTEMMODULES_SYSTEMCALLS_DISPATCHER_H_
 
 #include "systemCallArguments.h"
+#include "kernel/systemModules/processManagement/contextSwitch.h"
 
 int dispatcher_dispatch(SysCallArgs_t args);
 
+/*
+ * Returns the process whose system call the kernel is executing, or NULL outside of system calls
+ * (e.g. in interrupt handlers), where no process must be blocked.
+ */
+PCB_t* dispatcher_getCallingProcess(void);
+
 #endif /* KERNEL_SYSTEMMODULES_SYSTEMCALLS_DISPATCHER_H_ */
@@ -0,0 +1,318 @@
+/*
+ * tty.c
+ *
+ *      The bytes a read can return are kept in one buffer, in canonical mode whole lines only: the line being
+ *      edited is kept apart and appended with its EOL when it is complete. Reads and the receive interrupt
+ *      share the state, so reads change it with interrupts disabled.
+ */
+
+#include "tty.h"
+#include "ttyControl.h"
+#include "kernel/hal/timer/systemTimer.h"
+#include "kernel/systemModules/filesystem/vfs.h"
+#include "kernel/systemModules/scheduler/scheduler.h"
+#include "kernel/systemModules/systemCalls/dispatcher.h"
+#include <stdbool.h>
+
+#define ATOMIC_START()              (_disable_interrupts())
+#define ATOMIC_END(previousState)   (_restore_interrupts(previousState))
+
+#define TTY_BUFFER_SIZE 256
+#define TTY_LINE_SIZE 128
+#define TTY_TICK_INTERVAL_MS 10
+
+#define TTY_EOL         '\r'
+#define TTY_NEWLINE     '\n'
+#define TTY_BACKSPACE   '\b'
+#define TTY_DELETE      0x7f
+#define TTY_KILL_LINE   0x15    // ctrl-u
+
+static TtySettings_t g_settings = { .isCanonical = 1, .isEcho = 1, .minBytes = 1, .timeoutMs = 0 };
+
+// Bytes a read can return, starting at head and wrapping around at the end
+static uint8_t g_input[TTY_BUFFER_SIZE];
+static uint32_t g_head;
+static uint32_t g_count;
+static uint32_t g_lineCount;
+
+// Line being edited in canonical mode
+static uint8_t g_line[TTY_LINE_SIZE];
+static uint32_t g_lineLength;
+static bool g_isAfterCarriageReturn;
+
+// Process waiting for input, 0 if none (the idle process never reads), and the bytes it waits for in raw mode
+static ProcessId_t g_waitingReader;
+static uint32_t g_waitingMinimum = 1;
+
+// Timeout of raw mode in milliseconds of the system timer
+static bool g_isTimerRunning;
+static uint64_t g_deadline;
+
+static void echo(const char* bytes, uint32_t length) {
+    if (g_settings.isEcho) {
+        uart_transmit(TTY_UART, (const uint8_t*) bytes, length);
+    }
+}
+
+static void startTimer(void) {
+    g_deadline = systemTimer_getMilliseconds() + g_settings.timeoutMs;
+    g_isTimerRunning = true;
+}
+
+static bool isTimedOut(void) {
+    return g_isTimerRunning && systemTimer_getMilliseconds() >= g_deadline;
+}
+
+static bool appendInput(uint8_t byte) {
+    if (g_count == TTY_BUFFER_SIZE) {
+        return false;
+    }
+    g_input[(g_head + g_count) % TTY_BUFFER_SIZE] = byte;
+    g_count++;
+    return true;
+}
+
+static void finishLine(void) {
+    echo("\r\n", 2);
+    if (TTY_BUFFER_SIZE - g_count < g_lineLength + 1) {
+        // Reads are too far behind, the line is lost
+        echo("\a", 1);
+    } else {
+        uint32_t i;
+        for (i = 0; i < g_lineLength; ++i) {
+            appendInput(g_line[i]);
+        }
+        appendInput(TTY_EOL);
+        g_lineCount++;
+    }
+    g_lineLength = 0;
+}
+
+static void eraseCharacter(void) {
+    if (g_lineLength > 0) {
+        g_lineLength--;
+        echo("\b \b", 3);
+    }
+}
+
+static void editLine(uint8_t byte) {
+    // A terminal may send CR LF for enter, which is one line
+    bool isNewlineOfEnter = byte == TTY_NEWLINE && g_isAfterCarriageReturn;
+    g_isAfterCarriageReturn = byte == TTY_EOL;
+    if (isNewlineOfEnter) {
+        return;
+    }
+
+    switch (byte) {
+    case TTY_EOL:
+    case TTY_NEWLINE:
+        finishLine();
+        break;
+    case TTY_BACKSPACE:
+    case TTY_DELETE:
+        eraseCharacter();
+        break;
+    case TTY_KILL_LINE:
+        while (g_lineLength > 0) {
+            eraseCharacter();
+        }
+        break;
+    default:
+        if (g_lineLength < TTY_LINE_SIZE) {
+            g_line[g_lineLength++] = byte;
+            echo((const char*) &byte, 1);
+        } else {
+            echo("\a", 1);
+        }
+        break;
+    }
+}
+
+static void passRaw(uint8_t byte) {
+    if (appendInput(byte)) {
+        echo((const char*) &byte, 1);
+    }
+    if (g_settings.minBytes > 0 && g_settings.timeoutMs > 0) {
+        // The timeout runs from the last byte
+        startTimer();
+    }
+}
+
+/*
+ * Takes the bytes received by the UART. Called in the receive interrupt, and by reads in case the receive
+ * interrupt is disabled.
+ */
+static void receiveInput(void) {
+    uint8_t received[32];
+    uint32_t bytesReceived;
+    while ((bytesReceived = uart_receive(TTY_UART, received, sizeof(received))) > 0) {
+        uint32_t i;
+        for (i = 0; i < bytesReceived; ++i) {
+            if (g_settings.isCanonical) {
+                editLine(received[i]);
+            } else {
+                passRaw(received[i]);
+            }
+        }
+    }
+}
+
+/*
+ * Copies up to bufferSize bytes, in canonical mode up to the end of the first line.
+ */
+static int takeInput(uint8_t* buffer, unsigned int bufferSize) {
+    uint32_t i = 0;
+    while (i < bufferSize && i < g_count) {
+        uint8_t byte = g_input[(g_head + i) % TTY_BUFFER_SIZE];
+        buffer[i++] = byte;
+        if (g_settings.isCanonical && byte == TTY_EOL) {
+            g_lineCount--;
+            break;
+        }
+    }
+    g_head = (g_head + i) % TTY_BUFFER_SIZE;
+    g_count -= i;
+    g_isTimerRunning = false;
+    return i;
+}
+
+static bool canRead(void) {
+    return g_settings.isCanonical ? g_lineCount > 0 : g_count >= g_waitingMinimum;
+}
+
+static void wakeReader(void) {
+    if (g_waitingReader != 0) {
+        scheduler_unblockProcess(g_waitingReader);
+        g_waitingReader = 0;
+    }
+}
+
+/*
+ * Blocks the calling process until wakeReader. Only one reader waits, others keep polling. Returns false if
+ * the process is not blocked.
+ */
+static bool blockReader(void) {
+    PCB_t* reader = dispatcher_getCallingProcess();
+    if (reader == NULL || !uart_isReceiveInterruptEnabled(TTY_UART)) {
+        return false;
+    }
+    if (g_waitingReader == 0 || g_waitingReader == reader->processId
+            || scheduler_getProcess(g_waitingReader)->status != BLOCKED) {
+        g_waitingReader = reader->processId;
+        scheduler_blockProcess(reader->processId);
+        return true;
+    }
+    return false;
+}
+
+static void handleTick(PCB_t* currentPcb) {
+    if (g_waitingReader != 0 && isTimedOut()) {
+        wakeReader();
+    }
+}
+
+void tty_init(void) {
+    SubscriptionId_t subscription = systemTimer_subscribeCallback(TTY_TICK_INTERVAL_MS, &handleTick);
+    systemTimer_enableSubscription(subscription);
+}
+
+void tty_handleReceive(UartModule_t module) {
+    receiveInput();
+    if (canRead()) {
+        wakeReader();
+    }
+}
+
+/*
+ * Returns the bytes to read, 0 if the reader has to wait or TTY_TIMEOUT.
+ */
+static int readInput(uint8_t* buffer, unsigned int bufferSize) {
+    receiveInput();
+    if (g_settings.isCanonical) {
+        return g_lineCount > 0 ? takeInput(buffer, bufferSize) : 0;
+    }
+
+    uint32_t minimum = g_settings.minBytes < bufferSize ? g_settings.minBytes : bufferSize;
+    if (g_count >= minimum && (g_count > 0 || g_settings.timeoutMs == 0)) {
+        return takeInput(buffer, bufferSize);
+    }
+    if (isTimedOut()) {
+        if (g_count > 0) {
+            return takeInput(buffer, bufferSize);
+        }
+        g_isTimerRunning = false;
+        return TTY_TIMEOUT;
+    }
+    if (g_settings.timeoutMs > 0 && g_settings.minBytes == 0 && !g_isTimerRunning) {
+        // The timeout runs from the read
+        startTimer();
+    }
+    g_waitingMinimum = minimum > 0 ? minimum : 1;
+    return 0;
+}
+
+int tty_read(uint8_t* buffer, unsigned int bufferSize) {
+    if (bufferSize == 0) {
+        return 0;
+    }
+    int previousState = ATOMIC_START();
+    int bytesRead = readInput(buffer, bufferSize);
+    bool isBlocked = false;
+    bool isPolling = !g_settings.isCanonical && g_settings.minBytes == 0 && g_settings.timeoutMs == 0;
+    if (bytesRead == 0 && !isPolling) {
+        // Blocked before the interrupts are enabled again, so input arriving now wakes the reader
+        isBlocked = blockReader();
+    }
+    ATOMIC_END(previousState);
+
+    if (isBlocked) {
+        scheduler_yield();
+    }
+    return bytesRead;
+}
+
+static void setMode(const TtySettings_t* settings) {
+    if (g_settings.isCanonical && !settings->isCanonical) {
+        // The line edited so far is passed on as it is
+        uint32_t i;
+        for (i = 0; i < g_lineLength; ++i) {
+            appendInput(g_line[i]);
+        }
+        g_lineLength = 0;
+    } else if (!g_settings.isCanonical && settings->isCanonical) {
+        uint32_t i;
+        g_lineCount = 0;
+        for (i = 0; i < g_count; ++i) {
+            if (g_input[(g_head + i) % TTY_BUFFER_SIZE] == TTY_EOL) {
+                g_lineCount++;
+            }
+        }
+    }
+    g_settings = *settings;
+    g_isTimerRunning = false;
+    g_waitingMinimum = 1;
+
+    // The waiting reader reads again in the new mode
+    wakeReader();
+}
+
+int tty_control(unsigned int request, void* argument) {
+    switch (request) {
+    case TTY_CONTROL_SET_MODE: {
+        if (argument == NULL) {
+            return UNKNOWN_REQUEST;
+        }
+        int previousState = ATOMIC_START();
+        setMode((const TtySettings_t*) argument);
+        ATOMIC_END(previousState);
+        return 0;
+    }
+    case TTY_CONTROL_GET_MODE:
+        if (argument == NULL) {
+            return UNKNOWN_REQUEST;
+        }
+        *(TtySettings_t*) argument = g_settings;
+        return 0;
+    }
+    return UNKNOWN_REQUEST;
+}
@@ -0,0 +1,41 @@
+/*
+ * tty.h
+ *
+ *      Line discipline of the console on UART3 (ttyControl.h). Received bytes are taken from the UART in its
+ *      receive interrupt, edited and echoed there, so a reader is woken only when a read can return: in
+ *      canonical mode once per line instead of once per character.
+ */
+
+#ifndef KERNEL_SYSTEMMODULES_TTY_TTY_H_
+#define KERNEL_SYSTEMMODULES_TTY_TTY_H_
+
+#include "kernel/hal/uart/uart.h"
+#include <inttypes.h>
+
+// Module of the console
+#define TTY_UART UART3
+
+/*
+ * Starts the timer of the raw mode timeouts, called once at boot after the scheduler is initialized. The
+ * console is in canonical mode with echo before already.
+ */
+void tty_init(void);
+
+/*
+ * Receive callback of TTY_UART: takes the received bytes and wakes the waiting reader if it can read now.
+ */
+void tty_handleReceive(UartModule_t module);
+
+/*
+ * Reads according to the mode. If nothing can be returned yet, a process reading with a system call is
+ * blocked until something can be (read returns 0 then, as every UART read). Returns the number of bytes read
+ * or TTY_TIMEOUT.
+ */
+int tty_read(uint8_t* buffer, unsigned int bufferSize);
+
+/*
+ * Handles the TTY_CONTROL_ requests. Returns UNKNOWN_REQUEST for others.
+ */
+int tty_control(unsigned int request, void* argument);
+
+#endif /* KERNEL_SYSTEMMODULES_TTY_TTY_H_ */
@@ -7,6 +7,10 @@
 #include "kernel/systemModules/scheduler/scheduler.h"
 #include "kernel/systemModules/filesystem/vfs.h"
 #include "kernel/systemModules/loader/loader.h"
+#include "kernel/systemModules/asyncIo/asyncIo.h"
+#include "kernel/systemModules/showPlayer/showPlayer.h"
+#include "kernel/systemModules/tty/tty.h"
+#include "kernel/systemModules/monotonicClock/monotonicClock.h"
 #include "systemCallApi.h"
 
 int main(void)
@@ -17,10 +21,14 @@ int main(void)
 
     interrupts_initIrq();
 
-    dmx_init();
     vfs_init();
     systemTimer_init(1000);
+    monotonicClock_init();
+    dmx_init();
     scheduler_init();
+    asyncIo_init();
+    showPlayer_init();
+    tty_init();
 
     //loader_loadProcess("/LEDON.OUT", ELF);
     //loader_loadProcess("/LEDOFF.OUT", ELF);
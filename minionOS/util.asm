@@ -5,3 +5,31 @@ asm_dataSynchronizationBarrier
 	MCR P15, #0, R0, C7, C10, #4
 	mov pc, lr
 	; check omap tech. ref; page 1061
+
+	.global asm_enableCycleCounter
+	.global asm_readCycleCounter
+
+asm_enableCycleCounter
+	MRC P15, #0, R0, C9, C12, #0	; PMNC
+	BIC R0, R0, #8					; count every cycle, not every 64th
+	ORR R0, R0, #5					; enable the counters and reset the cycle counter
+	MCR P15, #0, R0, C9, C12, #0
+	MOV R0, #0x80000000
+	MCR P15, #0, R0, C9, C12, #1	; CNTENS: enable the cycle counter
+	MOV R0, #1
+	MCR P15, #0, R0, C9, C14, #0	; USEREN: processes may read the cycle counter
+	mov pc, lr
+
+asm_readCycleCounter
+	MRC P15, #0, R0, C9, C13, #0	; CCNT
+	mov pc, lr
+
+	.global asm_isInInterrupt
+
+asm_isInInterrupt
+	MRS R0, CPSR
+	AND R0, R0, #0x1F				; mode bits
+	CMP R0, #0x12					; IRQ mode, the mode of the interrupt handlers and timer callbacks
+	MOVEQ R0, #1
+	MOVNE R0, #0
+	mov pc, lr
@@ -3,11 +3,26 @@
 #include "minionIO.h"
 #include <stddef.h>
 
+// Number of entries read per system call
+#define ENTRIES_PER_READ 16
+
 int ls_main(int argc, char* argv[]) {
-    const char* dirName = argc > 1 ? argv[1] : "";
-    const char* dirEntry;
-    while ((dirEntry = sysCalls_readDirectory(dirName)) != NULL) {
-        minionIO_writeln(dirEntry);
+    const char* dirName = argc > 1 ? argv[1] : "/";
+    int directory = sysCalls_openDirectory(dirName);
+    if (directory < 0) {
+        minionIO_writeln("Specified directory could not be opened.");
+        return -1;
+    }
+
+    DirectoryEntry_t entries[ENTRIES_PER_READ];
+    int entriesRead;
+    while ((entriesRead = sysCalls_readDirectory(directory, entries, ENTRIES_PER_READ)) > 0) {
+        int i;
+        for (i = 0; i < entriesRead; ++i) {
+            minionIO_writeln(entries[i].name);
+        }
     }
+
+    sysCalls_closeDirectory(directory);
     return 0;
 }
@@ -0,0 +1,16 @@
+#include "rm.h"
+#include "minionIO.h"
+#include "systemCallApi.h"
+
+int rm_main(int argc, char* argv[]) {
+    if (argc != 2) {
+        minionIO_writeln("Incorrect usage. Use 'rm <file>'.");
+        return -1;
+    }
+
+    if (sysCalls_unlink(argv[1]) < 0) {
+        minionIO_writeln("Specified file could not be removed.");
+        return -1;
+    }
+    return 0;
+}
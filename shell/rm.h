@@ -0,0 +1,6 @@
+#ifndef RM_H_
+#define RM_H_
+
+int rm_main(int argc, char* argv[]);
+
+#endif /* RM_H_ */
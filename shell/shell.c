@@ -7,6 +7,7 @@
 #include "argv.h"
 #include "read.h"
 #include "write.h"
+#include "rm.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -74,6 +75,7 @@ static void initCommands() {
     registerCommand("argv", argv_main);
     registerCommand("clear", clear_main);
     registerCommand("write", write_main);
+    registerCommand("rm", rm_main);
 }
 
 void shell_loop() {
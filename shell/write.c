@@ -11,9 +11,9 @@ int write_main(int argc, char* argv[]) {
     const char* fileName = argv[1];
     const char* content = argv[2];
 
-    int file = sysCalls_openFile(fileName);
+    int file = sysCalls_openFileWithFlags(fileName, OPEN_WRITE | OPEN_CREATE | OPEN_TRUNCATE);
     if (file < 0) {
-        minionIO_writeln("Specified file does not exist.");
+        minionIO_writeln("Specified file could not be opened.");
         return -1;
     }
     sysCalls_writeFile(file, (const uint8_t*) content, strlen(content));
@@ -0,0 +1,54 @@
+#ifndef SYSTEMCALLS_ASYNCIORING_H_
+#define SYSTEMCALLS_ASYNCIORING_H_
+
+#include <inttypes.h>
+
+// Number of slots of each ring, a power of two
+#define ASYNC_IO_RING_ENTRIES 64
+
+// The ring and the buffer area together take at most 16 pages of 4 KB
+#define ASYNC_IO_MAX_BUFFER_SIZE (15 * 4096)
+
+// Result of a request whose buffer does not lie within the buffer area, or with an unknown operation
+#define ASYNC_IO_INVALID_REQUEST (-4)
+
+typedef enum {
+    ASYNC_IO_READ,          // Read at the position of the file, like sysCalls_readFile
+    ASYNC_IO_READ_AT,       // Read at offset, like sysCalls_readFileAt
+    ASYNC_IO_WRITE          // Write at the position of the file, like sysCalls_writeFile
+} AsyncIoOperation_t;
+
+typedef struct {
+    uint32_t operation;
+    int fileDescriptor;
+
+    // Has to lie within the buffer area returned by sysCalls_setupAsyncIo
+    uint8_t* buffer;
+    unsigned int bufferSize;
+    unsigned int offset;
+
+    // Passed back unchanged in the completion of the request
+    uint32_t userData;
+} AsyncIoRequest_t;
+
+typedef struct {
+    uint32_t userData;
+
+    // Number of bytes transferred, or a negative number in case of error
+    int result;
+} AsyncIoCompletion_t;
+
+// Shared by a process and the kernel. Indices count up forever, the slot of index i is i % ASYNC_IO_RING_ENTRIES.
+// Each index is written by one side only: the process adds requests at requestTail and collects completions at
+// completionHead, the kernel takes requests at requestHead and adds completions at completionTail.
+typedef struct {
+    volatile uint32_t requestHead;
+    volatile uint32_t requestTail;
+    volatile uint32_t completionHead;
+    volatile uint32_t completionTail;
+
+    AsyncIoRequest_t requests[ASYNC_IO_RING_ENTRIES];
+    AsyncIoCompletion_t completions[ASYNC_IO_RING_ENTRIES];
+} AsyncIoRing_t;
+
+#endif /* SYSTEMCALLS_ASYNCIORING_H_ */
@@ -0,0 +1,20 @@
+#ifndef SYSTEMCALLS_CLOCKPAGE_H_
+#define SYSTEMCALLS_CLOCKPAGE_H_
+
+#include <inttypes.h>
+
+// Fraction bits of nanosecondsPerCycle
+#define CLOCK_PAGE_SHIFT 24
+
+// Mapped read-only into every process asking for the time, written by the kernel every millisecond. The time
+// in nanoseconds is baseNanoseconds plus the cycles counted since baseCycles (at most maxCycles) times
+// nanosecondsPerCycle. sequence is odd while the kernel writes, a reader reads again if it has changed.
+typedef struct {
+    volatile uint32_t sequence;
+    volatile uint32_t baseCycles;
+    volatile uint64_t baseNanoseconds;
+    volatile uint32_t nanosecondsPerCycle;
+    volatile uint32_t maxCycles;
+} ClockPage_t;
+
+#endif /* SYSTEMCALLS_CLOCKPAGE_H_ */
@@ -0,0 +1,21 @@
+#ifndef SYSTEMCALLS_DIRECTORYENTRY_H_
+#define SYSTEMCALLS_DIRECTORYENTRY_H_
+
+#include <inttypes.h>
+
+// Types of directory entries
+#define DIRECTORY_ENTRY_FILE        0
+#define DIRECTORY_ENTRY_DIRECTORY   1
+#define DIRECTORY_ENTRY_DEVICE      2
+
+// Maximum length of an entry name, including the terminating '\0'
+#define DIRECTORY_ENTRY_NAME_LENGTH 27
+
+// An entry returned by reading a directory, 32 bytes
+typedef struct {
+    uint32_t size;
+    uint8_t type;
+    char name[DIRECTORY_ENTRY_NAME_LENGTH];
+} DirectoryEntry_t;
+
+#endif /* SYSTEMCALLS_DIRECTORYENTRY_H_ */
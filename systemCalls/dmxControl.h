@@ -0,0 +1,63 @@
+#ifndef SYSTEMCALLS_DMXCONTROL_H_
+#define SYSTEMCALLS_DMXCONTROL_H_
+
+#include <inttypes.h>
+
+// Requests of sysCalls_controlFile on /dev/dmx
+typedef enum {
+    DMX_CONTROL_PATCH = 1,          // argument: const DmxPatch_t*
+    DMX_CONTROL_SET_REFRESH_RATE,   // argument: const unsigned int*, frames per second of all universes
+    DMX_CONTROL_GET_STATISTICS,     // argument: DmxStatistics_t*
+    DMX_CONTROL_FADE,               // argument: const DmxFade_t*
+    DMX_CONTROL_PLAY_SHOW,          // argument: const char*, absolute name of a show file (showFile.h)
+    DMX_CONTROL_STOP_SHOW           // argument: none
+} DmxControlRequest_t;
+
+// Shape of a fade over its duration
+typedef enum {
+    DMX_CURVE_LINEAR,
+    DMX_CURVE_EASE_IN,          // slow start
+    DMX_CURVE_EASE_OUT,         // slow end
+    DMX_CURVE_EASE_IN_OUT       // slow start and end
+} DmxCurve_t;
+
+// Result of a patch or fade whose slots lie outside the universe
+#define DMX_INVALID_PATCH (-5)
+
+// Result of playing a file which cannot be opened or is not a show file
+#define DMX_INVALID_SHOW (-6)
+
+// Changes length slots starting with startSlot (slot 0 is the start code, slot n channel n), e.g. the channels
+// of one fixture. Slots which are not part of the patch keep their values.
+typedef struct {
+    uint16_t startSlot;
+    uint16_t length;
+    const uint8_t* data;
+} DmxPatch_t;
+
+// Moves length slots starting with startSlot from their current values to targets within durationMs, e.g. a
+// cue of one fixture. The kernel computes the values of every frame. A patch of a slot ends its fade, a new
+// fade of a slot replaces the running one.
+typedef struct {
+    uint16_t startSlot;
+    uint16_t length;
+    const uint8_t* targets;
+    uint32_t durationMs;
+    uint32_t curve;     // DmxCurve_t
+} DmxFade_t;
+
+// Counters of one universe since it was started
+typedef struct {
+    uint32_t framesSent;
+
+    // Frames sent with data changed since the frame before
+    uint32_t framesUpdated;
+
+    // Frames the universe missed because the previous frame was still leaving the UART
+    uint32_t underruns;
+
+    // Frames sent during the last second
+    uint32_t framesPerSecond;
+} DmxStatistics_t;
+
+#endif /* SYSTEMCALLS_DMXCONTROL_H_ */
@@ -0,0 +1,25 @@
+#ifndef SYSTEMCALLS_FILESTATUS_H_
+#define SYSTEMCALLS_FILESTATUS_H_
+
+#include <inttypes.h>
+#include "directoryEntry.h"
+
+// Information about a file, returned by stat/fstat
+typedef struct {
+    uint32_t size;
+
+    // One of the DIRECTORY_ENTRY_* types (directoryEntry.h)
+    uint8_t type;
+
+    // Time and date of the last modification in FAT format, 0 if unknown:
+    // time = hours << 11 | minutes << 5 | seconds / 2, date = (year - 1980) << 9 | month << 5 | day
+    uint16_t modifyTime;
+    uint16_t modifyDate;
+
+    // Identify the file: device is the mount holding it, fileId is a number unique within the mount
+    // (like an inode number), 0 if the filesystem has none. Used by the kernel to share pages of a file.
+    uint16_t device;
+    uint32_t fileId;
+} FileStatus_t;
+
+#endif /* SYSTEMCALLS_FILESTATUS_H_ */
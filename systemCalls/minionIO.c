@@ -13,11 +13,23 @@ void minionIO_skipLn(void){
     while ((c = minionIO_read()) != EOL) ;
 }
 
+/*
+ * The console returns at most one line per read (canonical mode of the kernel TTY), so a line usually takes a
+ * single read. The rest of a line longer than the buffer is left for the next call.
+ */
 int minionIO_readln(char* buffer, unsigned int bufferSize) {
     int i = 0;
-    char c;
-    while (((bufferSize - 1) > i) && ((c = minionIO_read()) != EOL)) {
-        buffer[i++] = c;
+    while ((bufferSize - 1) > i) {
+        int bytesRead = sysCalls_readFile(STDIN_FILENO, (uint8_t*) buffer + i, bufferSize - 1 - i);
+        if (bytesRead <= 0) {
+            continue;
+        }
+        char* end = memchr(buffer + i, EOL, bytesRead);
+        if (end != NULL) {
+            i = end - buffer;
+            break;
+        }
+        i += bytesRead;
     }
     buffer[i] = '\0';
     return i;
@@ -0,0 +1,11 @@
+#ifndef SYSTEMCALLS_OPENFLAGS_H_
+#define SYSTEMCALLS_OPENFLAGS_H_
+
+// Flags for opening files, can be combined. Without flags, files are opened for reading only.
+#define OPEN_READ       0x00
+#define OPEN_WRITE      0x01    // Allow writing
+#define OPEN_CREATE     0x02    // Create the file if it does not exist
+#define OPEN_TRUNCATE   0x04    // Discard the content of the file (requires OPEN_WRITE)
+#define OPEN_APPEND     0x08    // Every write goes to the end of the file
+
+#endif /* SYSTEMCALLS_OPENFLAGS_H_ */
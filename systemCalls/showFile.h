@@ -0,0 +1,18 @@
+#ifndef SYSTEMCALLS_SHOWFILE_H_
+#define SYSTEMCALLS_SHOWFILE_H_
+
+#include <inttypes.h>
+
+// Show files, played into a DMX universe with DMX_CONTROL_PLAY_SHOW (dmxControl.h). All numbers are little
+// endian. The file starts with a header:
+//   "MSHW", uint16 version (SHOW_FILE_VERSION), uint16 reserved (0)
+// followed by events ordered by time. An event changes slots of the universe, like a DmxPatch_t:
+//   uint32 time (milliseconds since the start of the show), uint16 start slot, uint16 length, length values
+// Only slots which change are stored, so a show takes little space however long it runs.
+
+#define SHOW_FILE_MAGIC "MSHW"
+#define SHOW_FILE_VERSION 1
+#define SHOW_FILE_HEADER_SIZE 8
+#define SHOW_EVENT_HEADER_SIZE 8
+
+#endif /* SYSTEMCALLS_SHOWFILE_H_ */
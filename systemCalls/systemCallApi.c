@@ -1,6 +1,8 @@
 #include "systemCallArguments.h"
 #include "systemCallNumber.h"
 #include "systemCallApi.h"
+#include "clockPage.h"
+#include <stddef.h>
 
 #pragma SWI_ALIAS(makeSysCall, SYSTEM_CALL_SWI_NUMBER);
 static int makeSysCall(SysCallArgs_t args);
@@ -10,14 +12,19 @@ int sysCalls_openFile(const char* fileName) {
     return makeSysCall(args);
 }
 
+int sysCalls_openFileWithFlags(const char* fileName, int flags) {
+    SysCallArgs_t args = { SYSCALL_FILE_OPEN, (int) fileName, flags };
+    return makeSysCall(args);
+}
+
 int sysCalls_readFile(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize) {
     SysCallArgs_t args = { SYSCALL_FILE_READ, fileDescriptor, (int) buffer, bufferSize };
     return makeSysCall(args);
 }
 
-void sysCalls_writeFile(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
+int sysCalls_writeFile(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize) {
     SysCallArgs_t args = { SYSCALL_FILE_WRITE, fileDescriptor, (int) buffer, bufferSize };
-    makeSysCall(args);
+    return makeSysCall(args);
 }
 
 void sysCalls_closeFile(int fileDescriptor) {
@@ -25,9 +32,130 @@ void sysCalls_closeFile(int fileDescriptor) {
     makeSysCall(args);
 }
 
-const char* sysCalls_readDirectory(const char* directoryName) {
-    SysCallArgs_t args = { SYSCALL_READDIR, (int) directoryName };
-    return (const char*) makeSysCall(args);
+int sysCalls_stat(const char* fileName, FileStatus_t* status) {
+    SysCallArgs_t args = { SYSCALL_STAT, (int) fileName, (int) status };
+    return makeSysCall(args);
+}
+
+int sysCalls_fstat(int fileDescriptor, FileStatus_t* status) {
+    SysCallArgs_t args = { SYSCALL_FSTAT, fileDescriptor, (int) status };
+    return makeSysCall(args);
+}
+
+int sysCalls_unlink(const char* fileName) {
+    SysCallArgs_t args = { SYSCALL_UNLINK, (int) fileName };
+    return makeSysCall(args);
+}
+
+int sysCalls_dupFile(int fileDescriptor) {
+    SysCallArgs_t args = { SYSCALL_FILE_DUP, fileDescriptor };
+    return makeSysCall(args);
+}
+
+int sysCalls_seekFile(int fileDescriptor, int offset, int origin) {
+    SysCallArgs_t args = { SYSCALL_FILE_SEEK, fileDescriptor, offset, origin };
+    return makeSysCall(args);
+}
+
+int sysCalls_readFileAt(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset) {
+    SysCallPositionedIoArgs_t ioArgs = { buffer, bufferSize, offset };
+    SysCallArgs_t args = { SYSCALL_FILE_PREAD, fileDescriptor, (int) &ioArgs };
+    return makeSysCall(args);
+}
+
+// Reads the cycle counter (cycleCounter.asm)
+extern uint32_t sysCalls_readCycleCounter(void);
+
+// Mapped with the first sysCalls_getTime
+static const ClockPage_t* g_clockPage;
+
+uint64_t sysCalls_getTime(void) {
+    if (g_clockPage == NULL) {
+        SysCallArgs_t args = { SYSCALL_CLOCK_MAP_PAGE };
+        g_clockPage = (const ClockPage_t*) makeSysCall(args);
+        if (g_clockPage == NULL) {
+            uint64_t nanoseconds;
+            SysCallArgs_t getArgs = { SYSCALL_CLOCK_GET_TIME, (int) &nanoseconds };
+            makeSysCall(getArgs);
+            return nanoseconds;
+        }
+    }
+
+    uint32_t sequence;
+    uint64_t nanoseconds;
+    do {
+        sequence = g_clockPage->sequence;
+        uint32_t elapsedCycles = sysCalls_readCycleCounter() - g_clockPage->baseCycles;
+        if (elapsedCycles > g_clockPage->maxCycles) {
+            elapsedCycles = g_clockPage->maxCycles;
+        }
+        nanoseconds = g_clockPage->baseNanoseconds
+                + (((uint64_t) elapsedCycles * g_clockPage->nanosecondsPerCycle) >> CLOCK_PAGE_SHIFT);
+    } while ((sequence & 1) || g_clockPage->sequence != sequence);
+    return nanoseconds;
+}
+
+int sysCalls_controlFile(int fileDescriptor, unsigned int request, void* argument) {
+    SysCallArgs_t args = { SYSCALL_FILE_IOCTL, fileDescriptor, request, (int) argument };
+    return makeSysCall(args);
+}
+
+const void* sysCalls_mapFile(int fileDescriptor, unsigned int length, unsigned int offset) {
+    SysCallArgs_t args = { SYSCALL_MMAP, fileDescriptor, length, offset };
+    return (const void*) makeSysCall(args);
+}
+
+int sysCalls_unmapFile(const void* address) {
+    SysCallArgs_t args = { SYSCALL_MUNMAP, (int) address };
+    return makeSysCall(args);
+}
+
+AsyncIoRing_t* sysCalls_setupAsyncIo(unsigned int bufferSize, uint8_t** buffer) {
+    SysCallArgs_t args = { SYSCALL_ASYNC_IO_SETUP, bufferSize, (int) buffer };
+    return (AsyncIoRing_t*) makeSysCall(args);
+}
+
+int sysCalls_submitAsyncIo(AsyncIoRing_t* ring, const AsyncIoRequest_t* request) {
+    if (ring->requestTail - ring->requestHead >= ASYNC_IO_RING_ENTRIES) {
+        return -1;
+    }
+    ring->requests[ring->requestTail % ASYNC_IO_RING_ENTRIES] = *request;
+    // The kernel may take the request as soon as the tail has moved
+    ring->requestTail++;
+    return 0;
+}
+
+int sysCalls_getAsyncIoCompletion(AsyncIoRing_t* ring, AsyncIoCompletion_t* completion) {
+    if (ring->completionHead == ring->completionTail) {
+        return 0;
+    }
+    *completion = ring->completions[ring->completionHead % ASYNC_IO_RING_ENTRIES];
+    ring->completionHead++;
+    return 1;
+}
+
+int sysCalls_waitAsyncIo(unsigned int minCompletions) {
+    SysCallArgs_t args = { SYSCALL_ASYNC_IO_WAIT, minCompletions };
+    return makeSysCall(args);
+}
+
+void sysCalls_sync(void) {
+    SysCallArgs_t args = { SYSCALL_SYNC };
+    makeSysCall(args);
+}
+
+int sysCalls_openDirectory(const char* directoryName) {
+    SysCallArgs_t args = { SYSCALL_OPENDIR, (int) directoryName };
+    return makeSysCall(args);
+}
+
+int sysCalls_readDirectory(int directory, DirectoryEntry_t* entries, unsigned int count) {
+    SysCallArgs_t args = { SYSCALL_GETDENTS, directory, (int) entries, count };
+    return makeSysCall(args);
+}
+
+void sysCalls_closeDirectory(int directory) {
+    sysCalls_closeFile(directory);
 }
 
 int sysCalls_loadProgramm(const char* fileName) {
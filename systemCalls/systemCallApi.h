@@ -3,6 +3,13 @@
 
 #include <stdbool.h>
 #include <inttypes.h>
+#include "openFlags.h"
+#include "directoryEntry.h"
+#include "fileStatus.h"
+#include "asyncIoRing.h"
+#include "dmxControl.h"
+#include "uartControl.h"
+#include "ttyControl.h"
 
 #define LED_0   0
 #define LED_1   1
@@ -13,14 +20,118 @@ void sysCalls_enableLed(bool turnOn, int led);
 
 int sysCalls_openFile(const char* fileName);
 
+/**
+ * Opens a file with a combination of the OPEN_* flags (openFlags.h), e.g. OPEN_WRITE | OPEN_CREATE.
+ * sysCalls_openFile opens files for reading only.
+ */
+int sysCalls_openFileWithFlags(const char* fileName, int flags);
+
 int sysCalls_readFile(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize);
 
-void sysCalls_writeFile(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
+int sysCalls_writeFile(int fileDescriptor, const uint8_t* buffer, unsigned int bufferSize);
+
+/**
+ * Opens a directory for reading its entries with sysCalls_readDirectory.
+ * Returns a descriptor, or a negative number if the directory does not exist.
+ */
+int sysCalls_openDirectory(const char* directoryName);
 
-const char* sysCalls_readDirectory(const char* directoryName);
+/**
+ * Reads up to count entries of an opened directory. Every call continues behind the entries
+ * returned by the previous one. Returns the number of entries read, 0 at the end of the directory.
+ */
+int sysCalls_readDirectory(int directory, DirectoryEntry_t* entries, unsigned int count);
+
+void sysCalls_closeDirectory(int directory);
 
 void sysCalls_closeFile(int fileDescriptor);
 
+/**
+ * Gets size, type and modification time of a file or directory without opening it.
+ * Returns 0 on success, or a negative number if the file does not exist.
+ */
+int sysCalls_stat(const char* fileName, FileStatus_t* status);
+
+/**
+ * Same as sysCalls_stat, for an open file. The size includes data written but not yet synced.
+ */
+int sysCalls_fstat(int fileDescriptor, FileStatus_t* status);
+
+/**
+ * Removes a file, e.g. a scratch file in "/tmp". Open descriptors of the file stay usable until they are closed.
+ * Returns 0 on success, or a negative number if the file does not exist or cannot be removed.
+ */
+int sysCalls_unlink(const char* fileName);
+
+/**
+ * Creates a new file descriptor (the lowest free one) referring to the same open file, sharing its position.
+ * The file is closed when all of its descriptors are closed. Returns the new descriptor, or a negative
+ * number in case of error.
+ */
+int sysCalls_dupFile(int fileDescriptor);
+
+/**
+ * Sets the position of the next read. origin is one of SEEK_SET, SEEK_CUR or SEEK_END (stdio.h).
+ * Returns the new position, or a negative number if the file is not seekable.
+ */
+int sysCalls_seekFile(int fileDescriptor, int offset, int origin);
+
+/**
+ * Reads from the given offset of the file without changing the position used by sysCalls_readFile.
+ */
+int sysCalls_readFileAt(int fileDescriptor, uint8_t* buffer, unsigned int bufferSize, unsigned int offset);
+
+/**
+ * Sends a request specific to the device behind the file, e.g. DMX_CONTROL_PATCH (dmxControl.h) to /dev/dmx.
+ * Returns the result of the request, or a negative number if the device does not support it.
+ */
+int sysCalls_controlFile(int fileDescriptor, unsigned int request, void* argument);
+
+/**
+ * Maps length bytes of an open file, starting at offset (a multiple of 4 KB), read-only into memory. Pages are
+ * read from the file when they are accessed for the first time and shared with other processes mapping the
+ * file. Writing to the mapping terminates the process. Returns the address of the mapping, or NULL in case of
+ * error. The mapping stays valid after the file is closed.
+ */
+const void* sysCalls_mapFile(int fileDescriptor, unsigned int length, unsigned int offset);
+
+/**
+ * Removes a mapping created by sysCalls_mapFile. Returns 0 on success, or a negative number if address is not
+ * the start of a mapping.
+ */
+int sysCalls_unmapFile(const void* address);
+
+/**
+ * Creates the rings for asynchronous I/O of the process and a buffer area of bufferSize bytes (at most
+ * ASYNC_IO_MAX_BUFFER_SIZE), which all requests have to use for their data. Returns the rings and sets *buffer
+ * to the buffer area, or returns NULL in case of error. A process has one pair of rings for its lifetime.
+ */
+AsyncIoRing_t* sysCalls_setupAsyncIo(unsigned int bufferSize, uint8_t** buffer);
+/**
+ * Adds a request to the submission ring without a system call, the kernel picks it up in the background.
+ * Returns 0, or -1 if the ring is full.
+ */
+int sysCalls_submitAsyncIo(AsyncIoRing_t* ring, const AsyncIoRequest_t* request);
+/**
+ * Takes the next completion from the completion ring without a system call. Returns 1 if there was one, else 0.
+ */
+int sysCalls_getAsyncIoCompletion(AsyncIoRing_t* ring, AsyncIoCompletion_t* completion);
+/**
+ * Waits until at least minCompletions completions can be taken (fewer if there are not enough requests).
+ * Returns the number of completions which can be taken, or a negative number if there are no rings.
+ */
+int sysCalls_waitAsyncIo(unsigned int minCompletions);
+/**
+ * Returns the nanoseconds since power-on. The time never decreases and has a resolution below a microsecond.
+ * Only the first call is a system call, it maps a page with the clock of the kernel into the process, later
+ * calls read the time from there.
+ */
+uint64_t sysCalls_getTime(void);
+/**
+ * Writes all cached file modifications to the storage.
+ */
+void sysCalls_sync(void);
+
 int sysCalls_loadProgramm(const char* fileName);
 
 #endif /* APPLICATIONS_SYSTEMCALLAPI_H_ */
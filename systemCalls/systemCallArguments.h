@@ -12,4 +12,11 @@ typedef struct {
     int c;
 } SysCallArgs_t;
 
+// Arguments are passed in registers, so system calls needing more than three arguments pass a pointer to this struct
+typedef struct {
+    void* buffer;
+    unsigned int bufferSize;
+    unsigned int offset;
+} SysCallPositionedIoArgs_t;
+
 #endif /* KERNEL_SYSTEMMODULES_SYSTEMCALLS_SYSTEMCALLARGUMENTS_H_ */
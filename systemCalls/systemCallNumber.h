@@ -6,8 +6,23 @@ typedef enum {
     SYSCALL_FILE_READ,
     SYSCALL_FILE_WRITE,
     SYSCALL_FILE_CLOSE,
-    SYSCALL_READDIR,
-    SYSCALL_LOAD_PROGRAM
+    SYSCALL_OPENDIR,
+    SYSCALL_LOAD_PROGRAM,
+    SYSCALL_FILE_SEEK,
+    SYSCALL_FILE_PREAD,
+    SYSCALL_SYNC,
+    SYSCALL_FILE_DUP,
+    SYSCALL_GETDENTS,
+    SYSCALL_STAT,
+    SYSCALL_FSTAT,
+    SYSCALL_UNLINK,
+    SYSCALL_MMAP,
+    SYSCALL_MUNMAP,
+    SYSCALL_ASYNC_IO_SETUP,
+    SYSCALL_ASYNC_IO_WAIT,
+    SYSCALL_FILE_IOCTL,
+    SYSCALL_CLOCK_GET_TIME,
+    SYSCALL_CLOCK_MAP_PAGE
 } SystemCallNumber;
 
 #endif /* KERNEL_SYSTEMMODULES_SYSTEMCALLS_SYSTEMCALLNUMBER_H_ */
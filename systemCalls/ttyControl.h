@@ -0,0 +1,31 @@
+#ifndef SYSTEMCALLS_TTYCONTROL_H_
+#define SYSTEMCALLS_TTYCONTROL_H_
+
+#include <inttypes.h>
+
+// Requests of sysCalls_controlFile on /dev/uart3, the console. They do not overlap the UART requests.
+typedef enum {
+    TTY_CONTROL_SET_MODE = 0x100,   // argument: const TtySettings_t*
+    TTY_CONTROL_GET_MODE            // argument: TtySettings_t*
+} TtyControlRequest_t;
+
+// Result of a read in raw mode whose timeout has passed without input
+#define TTY_TIMEOUT (-7)
+
+/*
+ * In canonical mode a read returns at most one line, ending with EOL ('\r'), once the line is complete. The
+ * line is edited in the kernel: backspace (0x08, 0x7f) erases the last character, ctrl-u the line.
+ *
+ * In raw mode the bytes are passed as received. A read returns once minBytes (at most the buffer size) have
+ * been received. With a timeout it also returns once timeoutMs have passed: with minBytes 0 since the read,
+ * returning TTY_TIMEOUT if nothing came, otherwise since the last byte, returning the bytes received so far.
+ * With neither, a read returns what is there, possibly nothing.
+ */
+typedef struct {
+    uint32_t isCanonical;
+    uint32_t isEcho;
+    uint32_t minBytes;
+    uint32_t timeoutMs;     // resolution 10 ms
+} TtySettings_t;
+
+#endif /* SYSTEMCALLS_TTYCONTROL_H_ */
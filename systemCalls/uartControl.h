@@ -0,0 +1,26 @@
+#ifndef SYSTEMCALLS_UARTCONTROL_H_
+#define SYSTEMCALLS_UARTCONTROL_H_
+
+#include <inttypes.h>
+
+// Requests of sysCalls_controlFile on /dev/uart1.../dev/uart3
+typedef enum {
+    UART_CONTROL_CONFIGURE = 1,     // argument: const UartSettings_t*
+    UART_CONTROL_GET_CONFIG,        // argument: UartSettings_t*
+    UART_CONTROL_RELOAD_CONFIG      // argument: none, reads /ETC/UART/UARTn.CFG again
+} UartControlRequest_t;
+
+// Result of a configuration with a value out of range, or of getting the configuration of a port which has none
+#define UART_INVALID_CONFIG (-5)
+
+// Same values as in the configuration files
+typedef struct {
+    uint32_t parityMode;        // 0-4: none, odd, even, forced 1, forced 0
+    uint32_t stopMode;          // 0-1: 1, 1.5 stop bits
+    uint32_t wordLength;        // 0-3: 5...8 bits
+    uint32_t baudRate;
+    uint32_t baudMultiple;      // 0-1: x16, x13
+    uint32_t rxTriggerLevel;    // 0-63, 0 polls the receive FIFO
+} UartSettings_t;
+
+#endif /* SYSTEMCALLS_UARTCONTROL_H_ */